@@ -0,0 +1,1272 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh_generation.h"
+#include "implicit_surface.h"
+#include "culling.h"
+#include "mesh_clusters.h"
+#include "mesh_optimization.h"
+#include "mesh_codec.h"
+#include "mesh_lod.h"
+#include "mesh_simplification.h"
+#include "parametric_generator.h"
+#include "parametric_kernels.h"
+
+/* Benchmark Helpers */
+struct MeshBuffers
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+
+	void Clear()
+	{
+		positions.clear();
+		normals.clear();
+		indices.clear();
+	}
+};
+
+// Best of several runs in milliseconds, the first run also warms up the allocations
+template <typename Function>
+static double MeasureMilliseconds(Function function, int repetitions = 5)
+{
+	auto best = std::numeric_limits<double>::max();
+	for (int i = 0; i < repetitions; ++i)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+		best = std::min(best, time.count());
+	}
+	return best;
+}
+
+static void PrintResult(const char* name, double milliseconds, double baseline_milliseconds)
+{
+	std::cout << "  " << std::left << std::setw(48) << name << std::right << std::setw(10) << std::fixed << std::setprecision(2)
+		<< milliseconds << " ms" << std::setw(8) << baseline_milliseconds / milliseconds << "x" << std::endl;
+}
+
+// Distance between two meshes with the same topology, normal deviation is the angle in degrees
+struct MeshDeviation
+{
+	double max_position = 0;
+	double mean_position = 0;
+	double max_normal = 0;
+	double mean_normal = 0;
+};
+
+static MeshDeviation MeasureMeshDeviation(const MeshBuffers& reference, const MeshBuffers& mesh)
+{
+	MeshDeviation deviation;
+	auto count = std::min(reference.positions.size(), mesh.positions.size());
+	if (count == 0)
+		return deviation;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		auto position = glm::distance(glm::dvec3(reference.positions[i]), glm::dvec3(mesh.positions[i]));
+		// atan2 stays accurate for tiny angles and does not need unit length normals, unlike acos of the dot product
+		auto reference_normal = glm::dvec3(reference.normals[i]);
+		auto mesh_normal = glm::dvec3(mesh.normals[i]);
+		auto normal = glm::degrees(std::atan2(glm::length(glm::cross(reference_normal, mesh_normal)), glm::dot(reference_normal, mesh_normal)));
+
+		deviation.max_position = std::max(deviation.max_position, position);
+		deviation.max_normal = std::max(deviation.max_normal, normal);
+		deviation.mean_position += position;
+		deviation.mean_normal += normal;
+	}
+	deviation.mean_position /= count;
+	deviation.mean_normal /= count;
+	return deviation;
+}
+
+static void PrintDeviation(const char* name, const MeshDeviation& deviation)
+{
+	std::cout << "  " << std::left << std::setw(48) << name << std::right << std::scientific << std::setprecision(3)
+		<< "position max " << deviation.max_position << " mean " << deviation.mean_position
+		<< ", normal max " << deviation.max_normal << " mean " << deviation.mean_normal << " deg" << std::endl;
+}
+
+static bool CheckError(const char* name, double max_error, double tolerance)
+{
+	auto passed = max_error <= tolerance;
+	std::cout << "  " << std::left << std::setw(48) << name << std::right << std::setw(12) << std::scientific << std::setprecision(3)
+		<< max_error << (passed ? "  ok" : "  FAILED") << std::endl;
+	return passed;
+}
+
+/* Benchmarks */
+static void BenchmarkCallables(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Function pointer vs. callable, " << segments << "x" << segments << std::endl;
+
+	// The wrappers would otherwise switch to the SIMD kernels
+	auto simd_enabled = GetMeshGenerationSimdEnabled();
+	SetMeshGenerationSimdEnabled(false);
+
+	auto pointer_2d = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2D(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2D, function pointer", pointer_2d, pointer_2d);
+
+	auto callable_2d = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		SeparateArraysLayout layout(mesh.positions, mesh.normals, mesh.indices);
+		GenerateRevolutionSurfaceMesh([](double t) { return ParametricSpikes(t); }, segments, segments, layout);
+	});
+	PrintResult("From2D, inlined callable", callable_2d, pointer_2d);
+
+	auto pointer_v2 = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, function pointer", pointer_v2, pointer_v2);
+
+	auto callable_v2 = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		SeparateArraysLayout layout(mesh.positions, mesh.normals, mesh.indices);
+		auto surface = [](double t, double r) { return ParametricSurfacev2(ParametricSpikes(t), r); };
+		GenerateParametricSurfaceMesh(surface, segments, segments, layout);
+	});
+	PrintResult("From2Dv2, inlined callable", callable_v2, pointer_v2);
+
+	SetMeshGenerationSimdEnabled(simd_enabled);
+}
+
+static void BenchmarkSimd(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Scalar vs. SIMD evaluation (" << SimdDouble::lane_count << " lanes), " << segments << "x" << segments << std::endl;
+
+	auto simd_enabled = GetMeshGenerationSimdEnabled();
+
+	SetMeshGenerationSimdEnabled(false);
+	auto scalar = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, scalar", scalar, scalar);
+
+	SetMeshGenerationSimdEnabled(true);
+	auto simd = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, SIMD", simd, scalar);
+
+	SetMeshGenerationSimdEnabled(simd_enabled);
+}
+
+static void BenchmarkPrecision(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Double vs. float generation (" << SimdDouble::lane_count << " vs. " << SimdFloat::lane_count << " lanes), "
+		<< segments << "x" << segments << std::endl;
+
+	MeshBuffers reference;
+	auto double_v2 = MeasureMilliseconds([&]()
+	{
+		reference.Clear();
+		GenerateParametricShapeFrom2Dv2<double>(reference.positions, reference.normals, reference.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, double", double_v2, double_v2);
+
+	auto float_v2 = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2Dv2<float>(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, float", float_v2, double_v2);
+	PrintDeviation("From2Dv2, float", MeasureMeshDeviation(reference, mesh));
+
+	reference.Clear();
+	GenerateParametricShapeFrom2D<double>(reference.positions, reference.normals, reference.indices, ParametricSpikes, segments, segments);
+	mesh.Clear();
+	GenerateParametricShapeFrom2D<float>(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	PrintDeviation("From2D, float", MeasureMeshDeviation(reference, mesh));
+}
+
+// Normal of the ParametricSpikes surface of revolution from the derivative of the profile worked out by hand
+static glm::dvec3 SpikesRevolutionNormal(double t, double r)
+{
+	auto angle = (t - 0.5) * glm::two_pi<double>();
+	auto a = 2 + 4 * 2;
+	auto dx = (-std::sin(angle) + std::cos(a * angle)) * 0.3 * glm::two_pi<double>();
+	auto dy = (std::cos(angle) - std::sin(a * angle)) * 0.3 * glm::two_pi<double>();
+	auto normal = glm::normalize(glm::dvec2(dy, -dx));
+
+	auto rotation = r * glm::two_pi<double>();
+	return glm::dvec3(normal.x * std::cos(rotation), normal.y, -normal.x * std::sin(rotation));
+}
+
+static void BenchmarkNormals(MeshBuffers& mesh)
+{
+	struct Method
+	{
+		const char* name;
+		NormalMethod method;
+	};
+	const Method methods[] = {
+		{ "Finite differences", NormalMethod::FiniteDifference },
+		{ "Sampled grid", NormalMethod::SampledGrid },
+		{ "Dual numbers", NormalMethod::DualNumbers }
+	};
+
+	// The surface of revolution has exact normals to compare with, the error of a method shows at coarse grids
+	for (auto segments : { 16, 64, 256, 1024 })
+	{
+		std::cout << "Normals, ParametricSpikes revolution " << segments << "x" << segments << std::endl;
+
+		MeshBuffers reference;
+		GenerateParametricShapeFrom2D(reference.positions, reference.normals, reference.indices, ParametricSpikes, segments, segments);
+		for (int r = 0; r < segments; ++r)
+			for (int v = 0; v < segments; ++v)
+				reference.normals[size_t(r) * segments + v] = SpikesRevolutionNormal(v / double(segments - 1), r / double(segments));
+
+		double baseline_time = 0;
+		for (auto& method : methods)
+		{
+			auto time = MeasureMilliseconds([&]()
+			{
+				mesh.Clear();
+				GenerateParametricShapeFrom2D(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments, method.method);
+			});
+			if (method.method == NormalMethod::FiniteDifference)
+				baseline_time = time;
+			PrintResult(method.name, time, baseline_time);
+			PrintDeviation(method.name, MeasureMeshDeviation(reference, mesh));
+		}
+	}
+
+	// The twisted surface has no closed form normals, the deviation from the dual numbers is the error of the others
+	const int segments = 1024;
+	std::cout << "Normals, ParametricSpikes v2 " << segments << "x" << segments << std::endl;
+
+	MeshBuffers reference;
+	GenerateParametricShapeFrom2Dv2(reference.positions, reference.normals, reference.indices, ParametricSpikes, segments, segments, NormalMethod::DualNumbers);
+
+	double baseline_time = 0;
+	for (auto& method : methods)
+	{
+		auto time = MeasureMilliseconds([&]()
+		{
+			mesh.Clear();
+			GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments, method.method);
+		}, 1);
+		if (method.method == NormalMethod::FiniteDifference)
+			baseline_time = time;
+		PrintResult(method.name, time, baseline_time);
+		PrintDeviation(method.name, MeasureMeshDeviation(reference, mesh));
+	}
+}
+
+static void BenchmarkOutput(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Vectors and copy vs. caller-provided span, " << segments << "x" << segments << std::endl;
+
+	auto plan = PlanGridMesh(segments, segments);
+	auto vertex_count = plan.vertex_count;
+	auto index_count = plan.index_count;
+
+	// Stands in for the GL buffers, the vector path copies into it like glBufferData does
+	std::vector<glm::vec3> buffer_positions(vertex_count);
+	std::vector<glm::vec3> buffer_normals(vertex_count);
+	std::vector<GLuint> buffer_indices(index_count);
+
+	auto vectors = MeasureMilliseconds([&]()
+	{
+		mesh.Clear();
+		GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+		std::copy(mesh.positions.begin(), mesh.positions.end(), buffer_positions.begin());
+		std::copy(mesh.normals.begin(), mesh.normals.end(), buffer_normals.begin());
+		std::copy(mesh.indices.begin(), mesh.indices.end(), buffer_indices.begin());
+	});
+	PrintResult("From2Dv2, vectors and copy", vectors, vectors);
+
+	auto span = MeasureMilliseconds([&]()
+	{
+		MeshSpan output = { buffer_positions.data(), buffer_normals.data(), buffer_indices.data(), vertex_count, index_count };
+		GenerateParametricShapeFrom2Dv2(output, ParametricSpikes, segments, segments);
+	});
+	PrintResult("From2Dv2, span", span, vectors);
+
+	auto copy_bytes = vertex_count * 2 * sizeof(glm::vec3) + index_count * sizeof(GLuint);
+	std::cout << "  Client memory saved by the span: " << std::fixed << std::setprecision(1) << copy_bytes / (1024. * 1024.) << " MB" << std::endl;
+}
+
+// Reads a vertex back from an encoded span, the inverse of EncodePosition and EncodeNormal
+static void DecodeVertex(const MeshSpan& span, size_t vertex, glm::vec3& position, glm::vec3& normal)
+{
+	auto& format = span.format;
+	auto position_data = static_cast<const char*>(span.positions) + vertex * format.PositionStride();
+	auto normal_data = static_cast<const char*>(span.normals) + vertex * format.NormalStride();
+
+	glm::uint64 packed_position;
+	glm::uint32 packed_normal;
+	switch (format.position)
+	{
+	case PositionFormat::Float3:
+		std::memcpy(&position, position_data, sizeof(position));
+		break;
+	case PositionFormat::Half4:
+		std::memcpy(&packed_position, position_data, sizeof(packed_position));
+		position = glm::vec3(glm::unpackHalf4x16(packed_position));
+		break;
+	case PositionFormat::Snorm16x4:
+		std::memcpy(&packed_position, position_data, sizeof(packed_position));
+		position = span.quantization.center + glm::vec3(glm::unpackSnorm4x16(packed_position)) * span.quantization.extent;
+		break;
+	}
+	switch (format.normal)
+	{
+	case NormalFormat::Float3:
+		std::memcpy(&normal, normal_data, sizeof(normal));
+		break;
+	case NormalFormat::Int2101010:
+		std::memcpy(&packed_normal, normal_data, sizeof(packed_normal));
+		normal = glm::vec3(glm::unpackSnorm3x10_1x2(packed_normal));
+		break;
+	}
+}
+
+static void BenchmarkVertexFormats(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Vertex formats, " << segments << "x" << segments << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+
+	struct NamedFormat
+	{
+		const char* name;
+		VertexFormat format;
+	};
+	const NamedFormat formats[] = {
+		{ "Float3 + Float3, separate", { PositionFormat::Float3, NormalFormat::Float3, false } },
+		{ "Float3 + Int2101010, interleaved", { PositionFormat::Float3, NormalFormat::Int2101010, true } },
+		{ "Half4 + Int2101010, interleaved", { PositionFormat::Half4, NormalFormat::Int2101010, true } },
+		{ "Snorm16x4 + Int2101010, interleaved", { PositionFormat::Snorm16x4, NormalFormat::Int2101010, true } },
+	};
+
+	auto plan = PlanGridMesh(segments, segments);
+	auto vertex_count = plan.vertex_count;
+	auto index_count = plan.index_count;
+	std::vector<GLuint> indices(index_count);
+
+	double baseline = 0;
+	for (auto& named : formats)
+	{
+		auto& format = named.format;
+		std::vector<char> vertices(vertex_count * format.VertexSize());
+		MeshSpan span = { vertices.data(), vertices.data() + (format.interleaved ? format.PositionSize() : vertex_count * format.PositionSize()),
+			indices.data(), vertex_count, index_count, format };
+
+		auto time = MeasureMilliseconds([&]()
+		{
+			GenerateParametricShapeFrom2Dv2(span, ParametricSpikes, segments, segments);
+		});
+		baseline = baseline == 0 ? time : baseline;
+		PrintResult(named.name, time, baseline);
+
+		MeshBuffers decoded;
+		decoded.positions.resize(vertex_count);
+		decoded.normals.resize(vertex_count);
+		for (size_t i = 0; i < vertex_count; ++i)
+			DecodeVertex(span, i, decoded.positions[i], decoded.normals[i]);
+
+		std::cout << "  " << std::left << std::setw(48) << "" << std::right << format.VertexSize() << " bytes per vertex, "
+			<< std::fixed << std::setprecision(1) << vertex_count * format.VertexSize() / (1024. * 1024.) << " MB" << std::endl;
+		PrintDeviation(named.name, MeasureMeshDeviation(mesh, decoded));
+	}
+}
+
+static void BenchmarkIndexFormats(int segments)
+{
+	std::cout << "Index formats, " << segments << "x" << segments << std::endl;
+
+	struct NamedOptions
+	{
+		const char* name;
+		bool strips;
+		bool short_indices;
+	};
+	const NamedOptions options[] = {
+		{ "GLuint triangles", false, false },
+		{ "GLushort triangles", false, true },
+		{ "GLuint strips", true, false },
+		{ "GLushort strips", true, true },
+	};
+
+	const VertexFormat format = { PositionFormat::Snorm16x4, NormalFormat::Int2101010, true };
+	double baseline = 0;
+	for (auto& named : options)
+	{
+		GridIndexOptions index_options;
+		index_options.strips = named.strips;
+		index_options.short_indices = named.short_indices;
+		auto plan = PlanGridMesh(segments, segments, index_options);
+
+		std::vector<char> vertices(plan.vertex_count * format.VertexSize());
+		std::vector<char> indices(plan.index_count * plan.index_format.IndexSize());
+		MeshSpan span = { vertices.data(), vertices.data() + format.PositionSize(), indices.data(),
+			plan.vertex_count, plan.index_count, format, index_options };
+
+		auto time = MeasureMilliseconds([&]()
+		{
+			GenerateParametricShapeFrom2Dv2(span, ParametricSpikes, segments, segments);
+		});
+		baseline = baseline == 0 ? time : baseline;
+		PrintResult(named.name, time, baseline);
+
+		auto draws = std::max<size_t>(1, plan.index_format.ranges.size());
+		std::cout << "  " << std::left << std::setw(48) << "" << std::right << std::fixed << std::setprecision(1)
+			<< indices.size() / (1024. * 1024.) << " MB of indices, " << draws << " draw(s)" << std::endl;
+	}
+}
+
+static void BenchmarkVertexCacheOptimization(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Vertex cache optimization, " << segments << "x" << segments << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	auto before = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+
+	// Optimizing an already optimized mesh would not measure the same work, so this is a single run
+	auto time = MeasureMilliseconds([&]()
+	{
+		OptimizeVertexCache(mesh.indices, mesh.positions.size());
+		OptimizeVertexFetch(mesh.positions, mesh.normals, mesh.indices);
+	}, 1);
+	auto after = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+
+	PrintResult("OptimizeVertexCache + OptimizeVertexFetch", time, time);
+	std::cout << "  " << std::fixed << std::setprecision(3) << "ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << " (16 entry FIFO)" << std::endl;
+}
+
+static void BenchmarkOverdrawOptimization(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Overdraw optimization, ParametricSpikes v2 " << segments << "x" << segments << ", 14 views at 256x256" << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	auto PrintOrder = [&mesh](const char* name)
+	{
+		auto overdraw = AnalyzeOverdraw(mesh.positions, mesh.indices);
+		auto cache = AnalyzeVertexCache(mesh.indices, mesh.positions.size());
+		std::cout << "  " << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(3) << "overdraw " << overdraw.overdraw
+			<< ", ACMR " << cache.acmr << std::endl;
+	};
+
+	PrintOrder("Row by row");
+	OptimizeVertexCache(mesh.indices, mesh.positions.size());
+	PrintOrder("OptimizeVertexCache");
+
+	auto optimized = mesh.indices;
+	for (auto threshold : { 1.05f, 1.5f })
+	{
+		auto time = MeasureMilliseconds([&]()
+		{
+			mesh.indices = optimized;
+			OptimizeOverdraw(mesh.positions, mesh.normals, mesh.indices, threshold);
+		});
+		auto name = "OptimizeOverdraw, threshold " + std::to_string(threshold).substr(0, 4);
+		PrintResult(name.c_str(), time, time);
+		PrintOrder(name.c_str());
+	}
+}
+
+static bool BenchmarkWelding(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Vertex welding, " << segments << "x" << segments << ", 12 byte vertices" << std::endl;
+
+	struct Profile
+	{
+		const char* name;
+		glm::dvec2(*line)(double);
+	};
+	const Profile profiles[] = {
+		{ "ParametricHalfCircle", ParametricHalfCircle },
+		{ "ParametricCircle", ParametricCircle },
+		{ "ParametricSpikes", ParametricSpikes }
+	};
+
+	for (auto& profile : profiles)
+	{
+		// The scene meshes use the revolution generator, its pole rows have matching normals
+		mesh.Clear();
+		GenerateParametricShapeFrom2D(mesh.positions, mesh.normals, mesh.indices, profile.line, segments, segments);
+
+		// Welding a welded mesh finds nothing to merge, so this is a single run
+		WeldStatistics statistics;
+		auto time = MeasureMilliseconds([&]()
+		{
+			statistics = WeldVertices(mesh.positions, mesh.normals, mesh.indices);
+		}, 1);
+
+		auto welded = statistics.vertices_before - statistics.vertices_after;
+		PrintResult(profile.name, time, time);
+		std::cout << "  " << statistics.vertices_before << " -> " << statistics.vertices_after << " vertices, "
+			<< welded * 12 / 1024 << " KB saved" << std::endl;
+	}
+
+	// Two vertices within the tolerance merge in either order, wherever they are against the cell borders
+	WeldTolerance tolerance;
+	auto merged_pairs = 0;
+	auto pairs = 0;
+	for (int step = 0; step < 100; ++step)
+	{
+		auto first = glm::vec3(float(step) * 0.37e-5f, 0, 0);
+		auto second = first + glm::vec3(0.9f * tolerance.position, 0, 0);
+		for (auto reversed : { false, true })
+		{
+			MeshBuffers pair;
+			pair.positions = reversed ? std::vector<glm::vec3>{ second, first } : std::vector<glm::vec3>{ first, second };
+			pair.normals.assign(2, glm::vec3(0, 0, 1));
+			pair.indices = { 0, 1, 1 };
+			merged_pairs += WeldVertices(pair.positions, pair.normals, pair.indices, tolerance).vertices_after == 1 ? 1 : 0;
+			++pairs;
+		}
+	}
+	auto passed = merged_pairs == pairs;
+	std::cout << "  " << std::left << std::setw(48) << "Pairs within the tolerance merged in both orders" << std::right << std::setw(12)
+		<< merged_pairs << " of " << pairs << (passed ? "  ok" : "  FAILED") << std::endl;
+	return passed;
+}
+
+static void BenchmarkPoleFans(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Pole fans, ParametricHalfCircle " << segments << "x" << segments << std::endl;
+
+	for (auto pole_fans : { false, true })
+	{
+		auto time = MeasureMilliseconds([&]()
+		{
+			mesh.Clear();
+			SeparateArraysLayout layout(mesh.positions, mesh.normals, mesh.indices);
+			layout.index_options.pole_fans = pole_fans;
+			GenerateRevolutionSurfaceMesh(ParametricHalfCircle, segments, segments, layout);
+		});
+
+		auto statistics = RemoveDegenerateTriangles(mesh.positions, mesh.indices);
+		PrintResult(pole_fans ? "Pole fans" : "Quads at the poles", time, time);
+		std::cout << "  " << statistics.triangles_before << " triangles, " << statistics.repeated_index + statistics.zero_area
+			<< " degenerate" << std::endl;
+	}
+}
+
+// The round trip passes with identical indices, positions within one quantization step of the bounds and normals
+// within the error of the octahedral grid
+static bool BenchmarkMeshCodec(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Mesh codec, ParametricSpikes " << segments << "x" << segments << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	auto raw_size = mesh.positions.size() * sizeof(glm::vec3) * 2 + mesh.indices.size() * sizeof(GLuint);
+
+	// Positions round to steps of the largest half size over 2^(bits - 1) - 1 on every axis, at most half a step each.
+	// The octahedral map stretches a normal step up to 3 times along the diagonal of a cell, the rounding stays
+	// within half that diagonal, 3 / sqrt(2) steps.
+	MeshCodecOptions default_options;
+	auto bounds = EmptyBounds();
+	for (auto& position : mesh.positions)
+		ExtendBounds(bounds, glm::dvec3(position));
+	auto half_size = (bounds.max - bounds.min) / 2.;
+	auto position_step = std::max({ half_size.x, half_size.y, half_size.z }) / ((1 << (default_options.position_bits - 1)) - 1);
+	auto normal_step = 1. / ((1 << (default_options.normal_bits - 1)) - 1);
+	auto normal_tolerance = glm::degrees(3 / std::sqrt(2.) * normal_step) * (1 + 1e-3);
+
+	auto passed = true;
+
+	// The grid as generated, and after the vertex cache optimization as an example of a mesh without grid structure
+	for (auto grid : { true, false })
+	{
+		MeshBuffers reference = mesh;
+		MeshCodecOptions options;
+		if (grid)
+			options.grid_width = segments;
+		else
+			OptimizeMesh(reference.positions, reference.normals, reference.indices);
+
+		std::vector<std::uint8_t> encoded;
+		auto encode_time = MeasureMilliseconds([&]() { encoded = EncodeMesh(reference.positions, reference.normals, reference.indices, options); }, 1);
+
+		// The baseline reads the uncompressed float arrays, a copy of the same vectors
+		MeshBuffers decoded;
+		auto copy_time = MeasureMilliseconds([&]() { decoded = reference; });
+		auto decoded_ok = true;
+		auto decode_time = MeasureMilliseconds([&]() { decoded_ok = DecodeMesh(encoded.data(), encoded.size(), decoded.positions, decoded.normals, decoded.indices); });
+
+		std::cout << (grid ? "  Grid mesh" : "  Reordered mesh") << ", " << std::fixed << std::setprecision(1) << raw_size / 1048576. << " MB of float arrays -> "
+			<< encoded.size() / 1048576. << " MB (" << double(raw_size) / encoded.size() << "x), encoded in " << encode_time << " ms" << std::endl;
+		PrintResult("Copy of the float arrays", copy_time, copy_time);
+		PrintResult("DecodeMesh", decode_time, copy_time);
+		auto identical = decoded_ok && decoded.indices == reference.indices && decoded.positions.size() == reference.positions.size()
+			&& decoded.normals.size() == reference.normals.size();
+		std::cout << "  " << std::setprecision(2) << raw_size / decode_time / 1e6 << " GB/s decoded" << std::endl;
+		std::cout << "  " << std::left << std::setw(48) << "Decoded, indices and vertex count identical" << std::right << (identical ? "  ok" : "  FAILED") << std::endl;
+		passed &= identical;
+		if (!identical)
+			continue;
+
+		auto deviation = MeasureMeshDeviation(reference, decoded);
+		PrintDeviation("DecodeMesh", deviation);
+		passed &= CheckError("Position deviation, within a step", deviation.max_position, position_step);
+		passed &= CheckError("Normal deviation in degrees, within the grid", deviation.max_normal, normal_tolerance);
+	}
+	return passed;
+}
+
+static void BenchmarkLodChain(int segments)
+{
+	std::cout << "Level of detail chain, ParametricSpikes " << segments << "x" << segments << std::endl;
+
+	auto levels = PlanLodChain(segments, segments);
+	auto time = MeasureMilliseconds([&]()
+	{
+		MeasureLodErrors(levels, [](int v, int r, auto&... output)
+		{
+			GenerateParametricShapeFrom2Dv2(output..., ParametricSpikes, v, r);
+		});
+	}, 1);
+	PrintResult("MeasureLodErrors", time, time);
+
+	// The scale a level is drawn up to, in pixels per unit, at the default threshold
+	LodSelectionOptions options;
+	for (auto& level : levels)
+	{
+		auto triangles = size_t(level.vertical_segments - 1) * level.rotation_segments * 2;
+		std::cout << "  " << level.vertical_segments << "x" << level.rotation_segments << ", " << triangles << " triangles, error "
+			<< std::scientific << std::setprecision(2) << level.geometric_error << ", drawn up to " << std::fixed
+			<< std::setprecision(0) << options.pixel_error / level.geometric_error << " pixels per unit" << std::endl;
+	}
+}
+
+// Closest point to point on the triangle abc
+static glm::dvec3 ClosestPointOnTriangle(const glm::dvec3& point, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+{
+	auto ab = b - a;
+	auto ac = c - a;
+	auto ap = point - a;
+	auto d1 = glm::dot(ab, ap);
+	auto d2 = glm::dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0)
+		return a;
+
+	auto bp = point - b;
+	auto d3 = glm::dot(ab, bp);
+	auto d4 = glm::dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3)
+		return b;
+
+	auto vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		return a + ab * (d1 / (d1 - d3));
+
+	auto cp = point - c;
+	auto d5 = glm::dot(ab, cp);
+	auto d6 = glm::dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6)
+		return c;
+
+	auto vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		return a + ac * (d2 / (d2 - d6));
+
+	auto va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	auto denominator = 1 / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Largest distance from a sample grid on the surface to the triangles of a grid mesh with the grid lines t and r.
+// Only the triangles of the 3x3 quads around the parameters of a sample are searched, they hold the closest
+// point unless the mesh folds over.
+template <typename Surface>
+static double MaxGridSurfaceDistance(const Surface& surface, const std::vector<glm::vec3>& positions, const std::vector<double>& t, const std::vector<double>& r)
+{
+	// Prime sample counts, so that the samples do not line up with the grid lines of either mesh
+	const int t_samples = 1021;
+	const int r_samples = 509;
+	auto vertical_segments = int(t.size());
+	auto rotation_segments = int(r.size());
+	auto PositionAt = [&](int v, int j)
+	{
+		return glm::dvec3(positions[size_t((j + rotation_segments) % rotation_segments) * vertical_segments + v]);
+	};
+
+	double error = 0;
+	for (int k = 0; k < r_samples; ++k)
+	{
+		auto rs = (k + 0.5) / r_samples;
+		auto j = int(std::upper_bound(r.begin(), r.end(), rs) - r.begin()) - 1;
+
+		for (int i = 0; i < t_samples; ++i)
+		{
+			auto ts = (i + 0.5) / t_samples;
+			auto v = std::min(int(std::upper_bound(t.begin(), t.end(), ts) - t.begin()) - 1, vertical_segments - 2);
+
+			// The diagonal of every quad runs from (v + 1, j) to (v, j + 1), like GenerateGridIndices splits it
+			auto point = surface(ts, rs);
+			auto distance = std::numeric_limits<double>::max();
+			for (int quad_j = j - 1; quad_j <= j + 1; ++quad_j)
+				for (int quad_v = std::max(v - 1, 0); quad_v <= std::min(v + 1, vertical_segments - 2); ++quad_v)
+				{
+					auto p00 = PositionAt(quad_v, quad_j);
+					auto p10 = PositionAt(quad_v + 1, quad_j);
+					auto p01 = PositionAt(quad_v, quad_j + 1);
+					auto p11 = PositionAt(quad_v + 1, quad_j + 1);
+					distance = std::min(distance, glm::distance(point, ClosestPointOnTriangle(point, p10, p01, p00)));
+					distance = std::min(distance, glm::distance(point, ClosestPointOnTriangle(point, p10, p11, p01)));
+				}
+			error = std::max(error, distance);
+		}
+	}
+	return error;
+}
+
+// The adaptive meshes pass when the largest distance to the surface is within their tolerance
+template <typename Surface>
+static bool BenchmarkAdaptiveSurface(MeshBuffers& mesh, const char* name, const Surface& surface)
+{
+	std::cout << "Adaptive tessellation, " << name << std::endl;
+
+	auto PrintMesh = [&](const std::string& mesh_name, double time, const AdaptiveGrid& grid, double tolerance)
+	{
+		auto error = MaxGridSurfaceDistance(surface, mesh.positions, grid.t, grid.r);
+		PrintResult(mesh_name.c_str(), time, time);
+		std::cout << "  " << mesh.indices.size() / 3 << " triangles, " << mesh.positions.size() << " vertices, max error "
+			<< std::scientific << std::setprecision(2) << error << std::fixed;
+		if (tolerance > 0)
+			std::cout << (error <= tolerance ? "  ok" : "  FAILED");
+		std::cout << std::endl;
+		return error <= tolerance;
+	};
+
+	for (auto segments : { 64, 128, 256, 512, 1024 })
+	{
+		AdaptiveGrid grid;
+		for (int v = 0; v < segments; ++v)
+			grid.t.push_back(v / double(segments - 1));
+		for (int r = 0; r < segments; ++r)
+			grid.r.push_back(r / double(segments));
+
+		auto time = MeasureMilliseconds([&]()
+		{
+			mesh.Clear();
+			SeparateArraysLayout layout(mesh.positions, mesh.normals, mesh.indices);
+			GenerateParametricSurfaceMesh(surface, segments, segments, layout);
+		}, 1);
+		PrintMesh("Uniform " + std::to_string(segments) + "x" + std::to_string(segments), time, grid, 0);
+	}
+
+	auto passed = true;
+
+	for (auto tolerance : { 1e-2, 1e-3, 1e-4, 1e-5 })
+	{
+		AdaptiveSamplingOptions options;
+		options.tolerance = tolerance;
+		// The spikes of the v2 surface need intervals narrower than 1 / 4096 at 1e-5
+		options.max_segments = 8192;
+
+		AdaptiveGrid grid;
+		auto time = MeasureMilliseconds([&]()
+		{
+			mesh.Clear();
+			SeparateArraysLayout layout(mesh.positions, mesh.normals, mesh.indices);
+			grid = PlanAdaptiveGrid(surface, options);
+			GenerateAdaptiveSurfaceMesh(surface, grid, layout);
+		}, 1);
+
+		std::ostringstream mesh_name;
+		mesh_name << "Adaptive, tolerance " << std::scientific << std::setprecision(0) << tolerance << ", " << grid.t.size() << "x" << grid.r.size();
+		passed &= PrintMesh(mesh_name.str(), time, grid, tolerance);
+	}
+	return passed;
+}
+
+static bool BenchmarkAdaptiveTessellation(MeshBuffers& mesh)
+{
+	auto passed = BenchmarkAdaptiveSurface(mesh, "ParametricCircle revolution", [](double t, double r)
+	{
+		return glm::rotateY(glm::dvec3(ParametricCircle(t), 0), r * glm::two_pi<double>());
+	});
+	passed &= BenchmarkAdaptiveSurface(mesh, "ParametricSpikes revolution", [](double t, double r)
+	{
+		return glm::rotateY(glm::dvec3(ParametricSpikes(t), 0), r * glm::two_pi<double>());
+	});
+	passed &= BenchmarkAdaptiveSurface(mesh, "ParametricSpikes v2 surface", [](double t, double r)
+	{
+		return ParametricSurfacev2(ParametricSpikes(t), r);
+	});
+	return passed;
+}
+
+static bool PositionLess(const glm::vec3& a, const glm::vec3& b)
+{
+	return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z;
+}
+
+// Positions SimplifyMesh never moves, those of vertices on a boundary edge or shared with another vertex, sorted
+static std::vector<glm::vec3> LockedPositions(const MeshBuffers& mesh)
+{
+	std::vector<char> locked(mesh.positions.size(), 0);
+
+	std::vector<GLuint> order(mesh.positions.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = GLuint(i);
+	std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b) { return PositionLess(mesh.positions[a], mesh.positions[b]); });
+	for (size_t i = 1; i < order.size(); ++i)
+		if (mesh.positions[order[i - 1]] == mesh.positions[order[i]])
+			locked[order[i - 1]] = locked[order[i]] = 1;
+
+	// An edge of a single triangle is a boundary edge
+	std::vector<std::pair<GLuint, GLuint>> edges;
+	edges.reserve(mesh.indices.size());
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		for (int k = 0; k < 3; ++k)
+		{
+			auto a = mesh.indices[i + k];
+			auto b = mesh.indices[i + (k + 1) % 3];
+			edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+		}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();)
+	{
+		auto end = i + 1;
+		while (end < edges.size() && edges[end] == edges[i])
+			++end;
+		if (end - i == 1)
+			locked[edges[i].first] = locked[edges[i].second] = 1;
+		i = end;
+	}
+
+	std::vector<glm::vec3> positions;
+	for (size_t i = 0; i < locked.size(); ++i)
+		if (locked[i])
+			positions.push_back(mesh.positions[i]);
+	std::sort(positions.begin(), positions.end(), PositionLess);
+	positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+	return positions;
+}
+
+// Every run has to reach its target, keep the locked positions and index only existing vertices
+static bool BenchmarkSimplification(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Mesh simplification, ParametricSpikes v2 " << segments << "x" << segments << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+	auto locked = LockedPositions(mesh);
+
+	// One slab is the serial baseline, the default is one slab per thread and only runs with more than one thread
+	auto passed = true;
+	for (auto target : { 200000, 20000, 5000 })
+	{
+		double baseline_time = 0;
+		for (auto partitions : { 1, 0 })
+		{
+			if (partitions == 0 && GetMeshGenerationThreadCount() == 1)
+				continue;
+
+			MeshBuffers simplified;
+			SimplificationOptions options;
+			options.target_triangles = target;
+			options.partitions = partitions;
+
+			SimplificationStatistics statistics;
+			auto time = MeasureMilliseconds([&]()
+			{
+				simplified = mesh;
+				statistics = SimplifyMesh(simplified.positions, simplified.normals, simplified.indices, options);
+			}, 1);
+			if (partitions == 1)
+				baseline_time = time;
+
+			auto name = std::to_string(target) + " triangles, " + std::to_string(statistics.partitions) + (statistics.partitions == 1 ? " slab" : " slabs");
+			PrintResult(name.c_str(), time, baseline_time);
+			std::cout << "  " << statistics.triangles_before << " -> " << statistics.triangles_after << " triangles, " << statistics.vertices_after
+				<< " vertices, error " << std::scientific << std::setprecision(2) << statistics.error << std::fixed << std::endl;
+
+			auto indices_valid = std::all_of(simplified.indices.begin(), simplified.indices.end(),
+				[&](GLuint index) { return index < simplified.positions.size(); });
+			auto remaining = simplified.positions;
+			std::sort(remaining.begin(), remaining.end(), PositionLess);
+			auto locked_kept = std::all_of(locked.begin(), locked.end(),
+				[&](const glm::vec3& position) { return std::binary_search(remaining.begin(), remaining.end(), position, PositionLess); });
+			auto valid = statistics.triangles_after <= size_t(target) && simplified.indices.size() / 3 == statistics.triangles_after
+				&& indices_valid && locked_kept;
+			std::cout << "  " << std::left << std::setw(48) << "Target reached, locked vertices kept" << std::right << (valid ? "  ok" : "  FAILED") << std::endl;
+			passed &= valid;
+		}
+	}
+	return passed;
+}
+
+static bool BenchmarkFrustumCulling(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Bounds and frustum culling, ParametricSpikes v2 " << segments << "x" << segments << std::endl;
+
+	// The generators return the bounds through a span, the VAO keeps them from there
+	auto plan = PlanGridMesh(segments, segments, GridIndexOptions());
+	mesh.positions.resize(plan.vertex_count);
+	mesh.normals.resize(plan.vertex_count);
+	mesh.indices.resize(plan.index_count);
+	MeshSpan span = { mesh.positions.data(), mesh.normals.data(), mesh.indices.data(), plan.vertex_count, plan.index_count, VertexFormat(), GridIndexOptions() };
+	GenerateParametricShapeFrom2Dv2(span, ParametricSpikes, segments, segments);
+	auto& bounds = span.bounds;
+
+	double farthest = 0;
+	for (auto& position : mesh.positions)
+		farthest = std::max(farthest, glm::distance(bounds.center, glm::dvec3(position)));
+	std::cout << "  Sphere radius " << std::fixed << std::setprecision(4) << bounds.radius << ", farthest vertex " << farthest
+		<< ", sphere around the box " << glm::distance(bounds.min, bounds.max) / 2 << std::endl;
+
+	// The bounds are those of the double positions, the float ones may round past them
+	auto slack = bounds.radius * 1e-6;
+	auto passed = farthest <= bounds.radius + slack;
+	for (auto& position : mesh.positions)
+		passed &= glm::all(glm::greaterThanEqual(glm::dvec3(position), bounds.min - slack)) && glm::all(glm::lessThanEqual(glm::dvec3(position), bounds.max + slack));
+	std::cout << "  " << std::left << std::setw(48) << "Vertices inside the bounds" << std::right << (passed ? "  ok" : "  FAILED") << std::endl;
+
+	// Objects scattered around the view, a quarter of the scene width in size
+	std::vector<glm::mat4> transforms;
+	unsigned int seed = 1;
+	auto Random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / double(1 << 24);
+	};
+	for (int i = 0; i < 100000; ++i)
+	{
+		auto transform = glm::translate(glm::vec3(Random() * 6 - 3, Random() * 6 - 3, Random() * 2 - 1));
+		transform = glm::scale(transform, glm::vec3(0.25f));
+		transform = glm::rotate(transform, float(Random() * glm::two_pi<double>()), glm::normalize(glm::vec3(Random(), Random(), Random()) + 0.1f));
+		transforms.push_back(transform);
+	}
+
+	CullingOptions options;
+	CullingStatistics statistics;
+	std::vector<char> culled(transforms.size());
+	auto time = MeasureMilliseconds([&]()
+	{
+		statistics = CullingStatistics();
+		for (size_t i = 0; i < transforms.size(); ++i)
+			culled[i] = CullDraw(transforms[i], bounds, options, statistics);
+	});
+	std::cout << "  " << std::left << std::setw(48) << "100000 draws tested" << std::right << std::setw(10) << std::setprecision(2) << time
+		<< " ms, " << statistics.culled_draws << " culled" << std::endl;
+
+	// A culled draw must not have a single vertex inside the clip volume
+	size_t wrongly_culled = 0;
+	for (size_t i = 0; i < transforms.size(); i += 97)
+	{
+		if (!culled[i])
+			continue;
+		for (size_t v = 0; v < mesh.positions.size(); v += 7)
+		{
+			auto clip = transforms[i] * glm::vec4(mesh.positions[v], 1);
+			if (glm::all(glm::lessThanEqual(glm::abs(glm::vec3(clip)), glm::vec3(clip.w))))
+			{
+				++wrongly_culled;
+				break;
+			}
+		}
+	}
+	std::cout << "  " << std::left << std::setw(48) << "Culled draws with a visible vertex" << std::right << std::setw(12) << wrongly_culled
+		<< (wrongly_culled == 0 ? "  ok" : "  FAILED") << std::endl;
+	return passed && wrongly_culled == 0;
+}
+
+static bool BenchmarkMeshlets(MeshBuffers& mesh, int segments)
+{
+	std::cout << "Meshlets and cluster culling, ParametricSpikes v2 " << segments << "x" << segments << std::endl;
+
+	mesh.Clear();
+	GenerateParametricShapeFrom2Dv2(mesh.positions, mesh.normals, mesh.indices, ParametricSpikes, segments, segments);
+
+	// Building rewrites the mesh, so this is a single run
+	MeshletOptions options;
+	std::vector<DrawRange> ranges;
+	std::vector<ClusterBounds> clusters;
+	MeshletStatistics statistics;
+	auto time = MeasureMilliseconds([&]()
+	{
+		statistics = BuildMeshlets(mesh.positions, mesh.normals, mesh.indices, ranges, clusters, options);
+	}, 1);
+	PrintResult("BuildMeshlets", time, time);
+	std::cout << "  " << statistics.meshlets << " meshlets, " << std::setprecision(1) << double(statistics.triangles) / statistics.meshlets
+		<< " triangles each, " << statistics.vertices_before << " -> " << statistics.vertices_after << " vertices"
+		<< (statistics.closed ? ", closed" : ", open") << std::endl;
+
+	size_t triangles = 0;
+	auto passed = statistics.closed;
+	for (auto& range : ranges)
+	{
+		auto first = mesh.indices.begin() + range.first_index;
+		std::vector<GLuint> vertices(first, first + range.index_count);
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+		passed &= vertices.size() <= size_t(options.max_vertices) && vertices.back() <= 0xFFFF && range.index_count <= options.max_triangles * 3;
+		triangles += size_t(range.index_count) / 3;
+	}
+	passed &= triangles == statistics.triangles;
+	std::cout << "  " << std::left << std::setw(48) << "Every triangle in a meshlet within the limits" << std::right << (passed ? "  ok" : "  FAILED") << std::endl;
+
+	// Cameras around the shape at several distances, looking at its middle
+	unsigned int seed = 1;
+	auto Random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / double(1 << 24);
+	};
+	auto projection = glm::perspective(glm::radians(60.f), 1.f, 0.1f, 100.f);
+
+	CullingOptions culling_options;
+	CullingStatistics culling_statistics;
+	size_t wrongly_culled = 0;
+	std::vector<char> visible;
+	for (int view = 0; view < 64; ++view)
+	{
+		auto direction = glm::normalize(glm::vec3(Random() * 2 - 1, Random() * 2 - 1, Random() * 2 - 1));
+		auto eye = direction * float(1.5 + Random() * 3);
+		auto target = glm::vec3(Random() - 0.5, Random() - 0.5, Random() - 0.5) * 0.5f;
+		auto transform = projection * glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+		CullClusters(transform, clusters, ranges, culling_options, culling_statistics, visible);
+
+		// A culled cluster must not have a triangle that faces the eye with a corner inside the clip volume
+		for (size_t i = 0; i < ranges.size(); ++i)
+		{
+			if (visible[i])
+				continue;
+			auto& range = ranges[i];
+			for (GLsizei k = 0; k < range.index_count; k += 3)
+			{
+				glm::vec3 corners[3];
+				glm::vec3 normal_sum(0);
+				auto inside = false;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					auto vertex = size_t(range.base_vertex) + mesh.indices[range.first_index + k + corner];
+					corners[corner] = mesh.positions[vertex];
+					normal_sum += mesh.normals[vertex];
+					auto clip = transform * glm::vec4(corners[corner], 1);
+					inside |= glm::all(glm::lessThanEqual(glm::abs(glm::vec3(clip)), glm::vec3(clip.w)));
+				}
+				auto normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				if (glm::dot(normal, normal_sum) < 0)
+					normal = -normal;
+				if (inside && glm::dot(normal, eye - corners[0]) > 0)
+				{
+					++wrongly_culled;
+					break;
+				}
+			}
+		}
+	}
+
+	auto cluster_triangles = double(culling_statistics.cluster_triangles);
+	std::cout << "  64 views, " << std::setprecision(1) << 100 * culling_statistics.triangles_back_facing / cluster_triangles << "% of the triangles back-facing, "
+		<< 100 * culling_statistics.triangles_outside / cluster_triangles << "% outside the frustum" << std::endl;
+	std::cout << "  " << std::left << std::setw(48) << "Culled clusters with a visible front" << std::right << std::setw(12) << wrongly_culled
+		<< (wrongly_culled == 0 ? "  ok" : "  FAILED") << std::endl;
+	return passed && wrongly_culled == 0;
+}
+
+// Every directed edge of a closed, consistently wound triangle mesh is used once, and its reverse once
+static bool IsWatertight(const std::vector<GLuint>& indices)
+{
+	std::map<std::pair<GLuint, GLuint>, int> edges;
+	for (size_t i = 0; i < indices.size(); i += 3)
+		for (int k = 0; k < 3; ++k)
+			++edges[std::make_pair(indices[i + k], indices[i + (k + 1) % 3])];
+
+	for (auto& edge : edges)
+	{
+		auto reverse = edges.find(std::make_pair(edge.first.second, edge.first.first));
+		if (edge.second != 1 || reverse == edges.end() || reverse->second != 1)
+			return false;
+	}
+	return true;
+}
+
+static bool BenchmarkImplicitSurface(MeshBuffers& mesh)
+{
+	std::cout << "Implicit surfaces, TorusField" << std::endl;
+
+	// The torus is a distance field, Lipschitz 1 skips the blocks far from the surface without sampling them
+	auto passed = true;
+	for (auto resolution : { 128, 256, 512 })
+	{
+		double baseline_time = 0;
+		for (auto lipschitz : { 0., 1. })
+		{
+			ImplicitSurfaceOptions options;
+			options.resolution = glm::ivec3(resolution);
+			options.lipschitz = lipschitz;
+
+			ImplicitSurfaceStatistics statistics;
+			auto time = MeasureMilliseconds([&]()
+			{
+				mesh.Clear();
+				statistics = GenerateImplicitSurface(mesh.positions, mesh.normals, mesh.indices, TorusField, glm::dvec3(-1.1), glm::dvec3(1.1), options);
+			}, resolution < 512 ? 3 : 1);
+			if (lipschitz == 0)
+				baseline_time = time;
+
+			auto name = std::to_string(resolution) + "^3, " + (lipschitz == 0 ? "min-max blocks" : "Lipschitz and min-max blocks");
+			PrintResult(name.c_str(), time, baseline_time);
+			std::cout << "  " << mesh.indices.size() / 3 << " triangles, " << statistics.blocks_bounded << " of " << statistics.blocks
+				<< " blocks bounded, " << statistics.blocks_uniform << " uniform, " << statistics.samples << " samples" << std::endl;
+		}
+
+		// The vertices interpolate the distance linearly along the grid edges, a quarter cell is far more than that
+		if (resolution == 128)
+		{
+			double max_distance = 0;
+			for (auto& position : mesh.positions)
+				max_distance = std::max(max_distance, std::abs(TorusField(glm::dvec3(position))));
+			passed &= CheckError("Torus vertex distance", max_distance, 0.25 * 2.2 / resolution);
+
+			auto watertight = IsWatertight(mesh.indices);
+			std::cout << "  " << std::left << std::setw(48) << "Torus watertight" << std::right << (watertight ? "  ok" : "  FAILED") << std::endl;
+			passed &= watertight;
+		}
+	}
+	return passed;
+}
+
+/* Validation */
+// Largest absolute difference between the SIMD lanes and the scalar double kernel over samples in [-0.5, 1.5]
+template <typename Precision = double, typename Kernel>
+static double MaxSimdLineError(const Kernel& kernel, int samples)
+{
+	using Simd = typename SimdType<Precision>::type;
+	const int lanes = Simd::lane_count;
+	Precision t[lanes], x[lanes], y[lanes];
+	double max_error = 0;
+	for (int i = 0; i < samples; i += lanes)
+	{
+		for (int lane = 0; lane < lanes; ++lane)
+			t[lane] = Precision(-0.5 + 2. * (i + lane) / samples);
+
+		Simd simd_x, simd_y;
+		kernel(Simd::Load(t), simd_x, simd_y);
+		simd_x.Store(x);
+		simd_y.Store(y);
+
+		for (int lane = 0; lane < lanes; ++lane)
+		{
+			double scalar_x, scalar_y;
+			kernel(double(t[lane]), scalar_x, scalar_y);
+			max_error = std::max({ max_error, std::abs(x[lane] - scalar_x), std::abs(y[lane] - scalar_y) });
+		}
+	}
+	return max_error;
+}
+
+template <typename Precision = double, typename Kernel>
+static double MaxSimdSurfaceError(const Kernel& kernel, int samples)
+{
+	using Simd = typename SimdType<Precision>::type;
+	const int lanes = Simd::lane_count;
+	Precision t[lanes], x[lanes], y[lanes], z[lanes];
+	double max_error = 0;
+	for (int j = 0; j < samples; ++j)
+	{
+		auto r = Precision(-0.5 + 2. * j / samples);
+		for (int i = 0; i < samples; i += lanes)
+		{
+			for (int lane = 0; lane < lanes; ++lane)
+				t[lane] = Precision(-0.5 + 2. * (i + lane) / samples);
+
+			Simd simd_x, simd_y, simd_z;
+			kernel(Simd::Load(t), Simd(r), simd_x, simd_y, simd_z);
+			simd_x.Store(x);
+			simd_y.Store(y);
+			simd_z.Store(z);
+
+			for (int lane = 0; lane < lanes; ++lane)
+			{
+				double scalar_x, scalar_y, scalar_z;
+				kernel(double(t[lane]), double(r), scalar_x, scalar_y, scalar_z);
+				max_error = std::max({ max_error, std::abs(x[lane] - scalar_x), std::abs(y[lane] - scalar_y), std::abs(z[lane] - scalar_z) });
+			}
+		}
+	}
+	return max_error;
+}
+
+bool ValidateSimdKernels()
+{
+	std::cout << "SIMD kernels, max error against double precision" << std::endl;
+
+	// The surface goes through float rounding like glm::length does, one float ulp of slack covers that
+	auto passed = true;
+	passed &= CheckError("ParametricHalfCircle", MaxSimdLineError(ParametricHalfCircleKernel(), 1 << 16), 1e-14);
+	passed &= CheckError("ParametricCircle", MaxSimdLineError(ParametricCircleKernel(), 1 << 16), 1e-14);
+	passed &= CheckError("ParametricSpikes", MaxSimdLineError(ParametricSpikesKernel(), 1 << 16), 1e-14);
+	passed &= CheckError("ParametricSpikyv2", MaxSimdLineError(ParametricSpikyv2Kernel(), 1 << 16), 1e-14);
+	passed &= CheckError("ParametricSurfacev2 of ParametricSpikes",
+		MaxSimdSurfaceError(ParametricSurfacev2FromLineKernel<ParametricSpikesKernel>(), 512), 1e-6);
+	passed &= CheckError("ParametricSurfacev2 of ParametricSpikyv2",
+		MaxSimdSurfaceError(ParametricSurfacev2FromLineKernel<ParametricSpikyv2Kernel>(), 512), 1e-6);
+
+	// Float lanes are checked against double evaluated at the same (float) parameters
+	std::cout << "SIMD float kernels, max error against double precision" << std::endl;
+	passed &= CheckError("ParametricSpikes, float", MaxSimdLineError<float>(ParametricSpikesKernel(), 1 << 16), 1e-5);
+	passed &= CheckError("ParametricSurfacev2 of ParametricSpikes, float",
+		MaxSimdSurfaceError<float>(ParametricSurfacev2FromLineKernel<ParametricSpikesKernel>(), 512), 1e-4);
+	return passed;
+}
+
+bool RunMeshGenerationBenchmarks()
+{
+	auto passed = ValidateSimdKernels();
+
+	std::cout << "Mesh generation benchmarks, " << GetMeshGenerationThreadCount() << " thread(s)" << std::endl;
+
+	MeshBuffers mesh;
+	BenchmarkCallables(mesh, 1024);
+	BenchmarkSimd(mesh, 1024);
+	BenchmarkPrecision(mesh, 1024);
+	BenchmarkNormals(mesh);
+	BenchmarkOutput(mesh, 1024);
+	BenchmarkVertexFormats(mesh, 1024);
+	BenchmarkIndexFormats(1024);
+	BenchmarkVertexCacheOptimization(mesh, 1024);
+	BenchmarkOverdrawOptimization(mesh, 512);
+	passed &= BenchmarkWelding(mesh, 1024);
+	BenchmarkPoleFans(mesh, 1024);
+	passed &= BenchmarkMeshCodec(mesh, 1024);
+	BenchmarkLodChain(1024);
+	passed &= BenchmarkAdaptiveTessellation(mesh);
+	passed &= BenchmarkSimplification(mesh, 1024);
+	passed &= BenchmarkImplicitSurface(mesh);
+	passed &= BenchmarkFrustumCulling(mesh, 1024);
+	passed &= BenchmarkMeshlets(mesh, 1024);
+
+	return passed;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Benchmarks */
+// Times the mesh generators and prints the results to stdout, run with --benchmark.
+// Returns false when one of the accuracy checks fails.
+bool RunMeshGenerationBenchmarks();
+
+/* Validation */
+// Compares the SIMD kernels of parametric_kernels.h with their double precision versions
+bool ValidateSimdKernels();
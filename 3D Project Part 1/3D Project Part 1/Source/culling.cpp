@@ -0,0 +1,134 @@
+#include "culling.h"
+
+#include <cmath>
+
+/* View Frustum */
+Frustum ExtractFrustum(const glm::mat4& transform)
+{
+	// glm matrices are column major, row i of the matrix is transform[0][i], transform[1][i], ...
+	auto Row = [&transform](int i)
+	{
+		return glm::dvec4(transform[0][i], transform[1][i], transform[2][i], transform[3][i]);
+	};
+
+	Frustum frustum;
+	auto w = Row(3);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		frustum.planes[axis * 2] = w + Row(axis);
+		frustum.planes[axis * 2 + 1] = w - Row(axis);
+	}
+	return frustum;
+}
+
+FrustumTest TestSphere(const Frustum& frustum, const glm::dvec3& center, double radius)
+{
+	auto result = FrustumTest::Inside;
+	for (auto& plane : frustum.planes)
+	{
+		// The plane normal scales the distance, the radius is scaled along with it
+		auto distance = glm::dot(glm::dvec3(plane), center) + plane.w;
+		auto scaled_radius = radius * glm::length(glm::dvec3(plane));
+		if (distance < -scaled_radius)
+			return FrustumTest::Outside;
+		if (distance < scaled_radius)
+			result = FrustumTest::Intersecting;
+	}
+	return result;
+}
+
+FrustumTest TestBox(const Frustum& frustum, const glm::dvec3& min, const glm::dvec3& max)
+{
+	auto result = FrustumTest::Inside;
+	for (auto& plane : frustum.planes)
+	{
+		// The corners furthest along and against the plane normal
+		auto normal = glm::dvec3(plane);
+		auto positive = glm::mix(min, max, glm::greaterThanEqual(normal, glm::dvec3(0)));
+		auto negative = glm::mix(max, min, glm::greaterThanEqual(normal, glm::dvec3(0)));
+		if (glm::dot(normal, positive) + plane.w < 0)
+			return FrustumTest::Outside;
+		if (glm::dot(normal, negative) + plane.w < 0)
+			result = FrustumTest::Intersecting;
+	}
+	return result;
+}
+
+/* Culling */
+bool CullDraw(const glm::mat4& transform, const MeshBounds& bounds, const CullingOptions& options, CullingStatistics& statistics)
+{
+	++statistics.draws;
+	if (!options.frustum || IsEmpty(bounds))
+		return false;
+
+	auto frustum = ExtractFrustum(transform);
+	auto result = TestSphere(frustum, bounds.center, bounds.radius);
+	if (result == FrustumTest::Intersecting)
+		result = TestBox(frustum, bounds.min, bounds.max);
+
+	if (result != FrustumTest::Outside)
+		return false;
+
+	++statistics.culled_draws;
+	return true;
+}
+
+/* Cluster Culling */
+glm::dvec4 ExtractEye(const glm::mat4& transform)
+{
+	// The eye is the point clip space moves to infinity against the viewing direction
+	auto eye = glm::inverse(glm::dmat4(transform)) * glm::dvec4(0, 0, -1, 0);
+	auto direction = glm::dvec3(eye);
+	if (std::abs(eye.w) <= 1e-12 * glm::length(direction))
+		return glm::dvec4(glm::normalize(direction), 0);
+	return glm::dvec4(direction / eye.w, 1);
+}
+
+bool IsClusterBackFacing(const ClusterBounds& cluster, const glm::dvec4& eye)
+{
+	if (cluster.cone_cutoff >= 1)
+		return false;
+
+	// Every view direction within 90 degrees minus the cone angle of the axis sees only backs, the sphere covers the
+	// directions from the eye to the rest of the cluster
+	auto axis = glm::dvec3(cluster.cone_axis);
+	if (eye.w == 0)
+		return glm::dot(-glm::dvec3(eye), axis) >= cluster.cone_cutoff;
+
+	auto to_center = glm::dvec3(cluster.center) - glm::dvec3(eye);
+	return glm::dot(to_center, axis) >= cluster.cone_cutoff * glm::length(to_center) + cluster.radius;
+}
+
+size_t CullClusters(const glm::mat4& transform, const std::vector<ClusterBounds>& clusters, const std::vector<DrawRange>& ranges,
+	const CullingOptions& options, CullingStatistics& statistics, std::vector<char>& visible)
+{
+	visible.assign(ranges.size(), 1);
+	size_t triangle_count = 0;
+	for (auto& range : ranges)
+		triangle_count += size_t(range.index_count) / 3;
+	statistics.cluster_triangles += triangle_count;
+	if (!options.clusters || clusters.size() != ranges.size())
+		return triangle_count;
+
+	auto frustum = ExtractFrustum(transform);
+	auto eye = ExtractEye(transform);
+	size_t visible_triangles = 0;
+	for (size_t i = 0; i < ranges.size(); ++i)
+	{
+		auto& cluster = clusters[i];
+		auto triangles = size_t(ranges[i].index_count) / 3;
+		if (TestSphere(frustum, glm::dvec3(cluster.center), cluster.radius) == FrustumTest::Outside)
+		{
+			statistics.triangles_outside += triangles;
+			visible[i] = 0;
+		}
+		else if (options.back_faces && IsClusterBackFacing(cluster, eye))
+		{
+			statistics.triangles_back_facing += triangles;
+			visible[i] = 0;
+		}
+		else
+			visible_triangles += triangles;
+	}
+	return visible_triangles;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+
+#include "mesh_bounds.h"
+#include "vertex_format.h"
+
+/*
+	View frustum culling of whole draws on the CPU, before anything is submitted. The planes are taken from the
+	rows of the matrix that maps object space to clip space (Gribb and Hartmann), so they are in object space and
+	the mesh bounds are tested as they are, without transforming them. The bounding sphere goes first, the box is
+	only tested for the draws the sphere cannot decide.
+
+	Draws split in meshlets are culled once more cluster by cluster, by the sphere and by the normal cone of every
+	cluster, see mesh_clusters.h. The clusters that are left are drawn with one glMultiDrawElementsBaseVertex.
+*/
+
+/* View Frustum */
+// Six planes with the inside where dot(plane, vec4(point, 1)) >= 0, the normals are not normalized
+struct Frustum
+{
+	glm::dvec4 planes[6];
+};
+
+// Frustum of the clip volume -w <= x, y, z <= w of transform, which maps object space to clip space
+Frustum ExtractFrustum(const glm::mat4& transform);
+
+enum class FrustumTest
+{
+	Outside,
+	Intersecting,
+	Inside
+};
+
+FrustumTest TestSphere(const Frustum& frustum, const glm::dvec3& center, double radius);
+FrustumTest TestBox(const Frustum& frustum, const glm::dvec3& min, const glm::dvec3& max);
+
+/* Culling */
+struct CullingOptions
+{
+	// Skip draws whose bounds are outside the view frustum, --no-culling draws everything
+	bool frustum = true;
+
+	// Skip the meshlets of a draw that are outside the frustum or only show their back, --no-cluster-culling
+	bool clusters = true;
+
+	// Skip the meshlets that only show their back, off for wireframes, whose backs no filled front hides
+	bool back_faces = true;
+};
+
+struct CullingStatistics
+{
+	size_t draws = 0;
+	size_t culled_draws = 0;
+
+	// Triangles of the meshlets of the draws that were not culled as a whole
+	size_t cluster_triangles = 0;
+	size_t triangles_outside = 0;
+	size_t triangles_back_facing = 0;
+};
+
+// True when the draw of a mesh with these bounds can be skipped, every call counts as a draw.
+// Empty bounds are unknown bounds, those draws are never culled.
+bool CullDraw(const glm::mat4& transform, const MeshBounds& bounds, const CullingOptions& options, CullingStatistics& statistics);
+
+/* Cluster Culling */
+// Object space eye of transform, a point with w = 1 for perspective projections, the direction towards it with w = 0
+// for orthographic ones
+glm::dvec4 ExtractEye(const glm::mat4& transform);
+
+// True when the eye sees the back of every triangle of the cluster
+bool IsClusterBackFacing(const ClusterBounds& cluster, const glm::dvec4& eye);
+
+// Sets visible[i] for the clusters of ranges[i] that have to be drawn and returns how many triangles those have.
+// Back faces are only skipped for closed meshes drawn filled with the depth test, they are hidden by the fronts then,
+// options.back_faces keeps them for the other draws.
+size_t CullClusters(const glm::mat4& transform, const std::vector<ClusterBounds>& clusters, const std::vector<DrawRange>& ranges,
+	const CullingOptions& options, CullingStatistics& statistics, std::vector<char>& visible);
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "simd_math.h"
+
+/*
+	Forward mode automatic differentiation. Dual<T, N> carries a value and its partial derivatives with respect
+	to N parameters through every operation, so evaluating a kernel from parametric_kernels.h once with T = Dual
+	gives the point and the exact tangents of the surface there. The functions of simd_math.h are overloaded with
+	their chain rule, T is any number type they support.
+*/
+
+/* Dual Numbers */
+template <typename T, int N>
+struct Dual
+{
+	T value;
+	T derivatives[N];
+
+	Dual() = default;
+
+	// Constants do not change with the parameters
+	Dual(double constant) : value(constant)
+	{
+		for (int i = 0; i < N; ++i)
+			derivatives[i] = T(0.);
+	}
+
+	// The parameter with the given index, its derivative with respect to itself is 1
+	static Dual Parameter(T value, int index)
+	{
+		Dual parameter = Dual(0.);
+		parameter.value = value;
+		parameter.derivatives[index] = T(1.);
+		return parameter;
+	}
+};
+
+// The result has the value f and the derivatives f'(a) * da
+template <typename T, int N>
+inline Dual<T, N> ChainRule(const Dual<T, N>& a, const T& f, const T& f_prime)
+{
+	Dual<T, N> result;
+	result.value = f;
+	for (int i = 0; i < N; ++i)
+		result.derivatives[i] = f_prime * a.derivatives[i];
+	return result;
+}
+
+/* Arithmetic */
+template <typename T, int N>
+inline Dual<T, N> operator+(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> result;
+	result.value = a.value + b.value;
+	for (int i = 0; i < N; ++i)
+		result.derivatives[i] = a.derivatives[i] + b.derivatives[i];
+	return result;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator-(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> result;
+	result.value = a.value - b.value;
+	for (int i = 0; i < N; ++i)
+		result.derivatives[i] = a.derivatives[i] - b.derivatives[i];
+	return result;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator*(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> result;
+	result.value = a.value * b.value;
+	for (int i = 0; i < N; ++i)
+		result.derivatives[i] = a.derivatives[i] * b.value + a.value * b.derivatives[i];
+	return result;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator/(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+	Dual<T, N> result;
+	auto inverse = T(1.) / b.value;
+	result.value = a.value * inverse;
+	for (int i = 0; i < N; ++i)
+		result.derivatives[i] = (a.derivatives[i] - result.value * b.derivatives[i]) * inverse;
+	return result;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator-(const Dual<T, N>& a)
+{
+	return ChainRule(a, -a.value, T(-1.));
+}
+
+// Constants on either side skip the products with their zero derivatives
+template <typename T, int N>
+inline Dual<T, N> operator+(const Dual<T, N>& a, double b)
+{
+	auto result = a;
+	result.value = a.value + b;
+	return result;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator+(double a, const Dual<T, N>& b)
+{
+	return b + a;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator-(const Dual<T, N>& a, double b)
+{
+	return a + -b;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator-(double a, const Dual<T, N>& b)
+{
+	return -b + a;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator*(const Dual<T, N>& a, double b)
+{
+	return ChainRule(a, a.value * b, T(b));
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator*(double a, const Dual<T, N>& b)
+{
+	return b * a;
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator/(const Dual<T, N>& a, double b)
+{
+	return a * (1. / b);
+}
+
+template <typename T, int N>
+inline Dual<T, N> operator/(double a, const Dual<T, N>& b)
+{
+	auto inverse = T(1.) / b.value;
+	return ChainRule(b, a * inverse, -a * inverse * inverse);
+}
+
+/* Functions */
+template <typename T, int N>
+inline Dual<T, N> Sin(const Dual<T, N>& x)
+{
+	return ChainRule(x, Sin(x.value), Cos(x.value));
+}
+
+template <typename T, int N>
+inline Dual<T, N> Cos(const Dual<T, N>& x)
+{
+	return ChainRule(x, Cos(x.value), -Sin(x.value));
+}
+
+template <typename T, int N>
+inline Dual<T, N> Sqrt(const Dual<T, N>& x)
+{
+	auto root = Sqrt(x.value);
+	return ChainRule(x, root, T(0.5) / root);
+}
+
+// x^y for x > 0, the derivative with respect to y is left out
+template <typename T, int N>
+inline Dual<T, N> Pow(const Dual<T, N>& x, double y)
+{
+	auto power = Pow(x.value, T(y - 1));
+	return ChainRule(x, power * x.value, T(y) * power);
+}
+
+template <typename T, int N>
+inline Dual<T, N> PowInt(const Dual<T, N>& x, int n)
+{
+	if (n == 0)
+		return Dual<T, N>(1.);
+	auto power = PowInt(x.value, n - 1);
+	return ChainRule(x, power * x.value, T(double(n)) * power);
+}
+
+// Only the value is rounded, the rounding is not part of the function that is differentiated
+template <typename T, int N>
+inline Dual<T, N> RoundToFloat(const Dual<T, N>& x)
+{
+	auto result = x;
+	result.value = RoundToFloat(x.value);
+	return result;
+}
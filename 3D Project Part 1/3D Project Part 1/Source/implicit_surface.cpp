@@ -0,0 +1,183 @@
+#include "implicit_surface.h"
+
+#include <array>
+#include <limits>
+
+/* Marching Cubes */
+int MarchingCubesEdgeOrigin(int edge)
+{
+	// The rank of an edge is its origin without the bit of its axis
+	int axis = edge / 4;
+	int rank = edge % 4;
+	int low_bits = rank & ((1 << axis) - 1);
+	return low_bits | ((rank >> axis) << (axis + 1));
+}
+
+static int MarchingCubesEdge(int corner_a, int corner_b)
+{
+	int axis = (corner_a ^ corner_b) == 1 ? 0 : (corner_a ^ corner_b) == 2 ? 1 : 2;
+	int origin = corner_a & corner_b;
+	int low_bits = origin & ((1 << axis) - 1);
+	return axis * 4 + (low_bits | ((origin >> (axis + 1)) << axis));
+}
+
+// Instead of the usual typed in table the cases are built from the faces of the cube. Every face cuts the surface
+// in segments between its crossed edges, and walking around the face, each crossing from an inside corner to an
+// outside one is joined with the crossing before it. On a face with two diagonal inside corners this keeps the
+// inside corners apart, and as the neighbouring cell sees the same face, the cells agree on every face they share.
+// The segments of the six faces close into loops around the inside corners, which are split in triangle fans.
+static std::array<MarchingCubesCase, 256> BuildMarchingCubesCases()
+{
+	std::array<MarchingCubesCase, 256> cases;
+	for (int case_index = 0; case_index < 256; ++case_index)
+	{
+		int next_edge[12];
+		std::fill(next_edge, next_edge + 12, -1);
+
+		for (int axis = 0; axis < 3; ++axis)
+			for (int side = 0; side < 2; ++side)
+			{
+				// Counterclockwise seen from outside the cube
+				int u = (axis + 1) % 3, v = (axis + 2) % 3;
+				int corners[4] = {
+					side << axis,
+					(side << axis) | (1 << u),
+					(side << axis) | (1 << u) | (1 << v),
+					(side << axis) | (1 << v)
+				};
+				if (side == 0)
+					std::swap(corners[1], corners[3]);
+
+				bool inside[4];
+				for (int i = 0; i < 4; ++i)
+					inside[i] = (case_index >> corners[i]) & 1;
+
+				for (int i = 0; i < 4; ++i)
+				{
+					if (!inside[i] || inside[(i + 1) % 4])
+						continue;
+
+					int j = (i + 3) % 4;
+					while (inside[j] || !inside[(j + 1) % 4])
+						j = (j + 3) % 4;
+
+					int from = MarchingCubesEdge(corners[j], corners[(j + 1) % 4]);
+					next_edge[from] = MarchingCubesEdge(corners[i], corners[(i + 1) % 4]);
+				}
+			}
+
+		auto& cube_case = cases[case_index];
+		cube_case.triangle_count = 0;
+		bool visited[12] = {};
+		for (int start = 0; start < 12; ++start)
+		{
+			if (next_edge[start] < 0 || visited[start])
+				continue;
+
+			int loop[12];
+			int length = 0;
+			for (int edge = start; !visited[edge]; edge = next_edge[edge])
+			{
+				visited[edge] = true;
+				loop[length++] = edge;
+			}
+
+			for (int i = 1; i + 1 < length; ++i)
+			{
+				auto triangle = cube_case.edges + cube_case.triangle_count * 3;
+				triangle[0] = loop[0];
+				triangle[1] = loop[i];
+				triangle[2] = loop[i + 1];
+				++cube_case.triangle_count;
+			}
+		}
+	}
+	return cases;
+}
+
+const MarchingCubesCase& GetMarchingCubesCase(int case_index)
+{
+	static const std::array<MarchingCubesCase, 256> cases = BuildMarchingCubesCases();
+	return cases[case_index];
+}
+
+/* Blocks */
+ImplicitGrid::ImplicitGrid(const glm::dvec3& min, const glm::dvec3& max, const glm::ivec3& resolution, int block_size)
+	: min(min), cell_size((max - min) / glm::dvec3(resolution)), resolution(resolution), block_size(block_size)
+{
+	blocks = (resolution + block_size - 1) / block_size;
+}
+
+size_t AssembleImplicitBlocks(
+	const ImplicitGrid& grid,
+	const std::vector<std::unique_ptr<ImplicitBlock>>& blocks,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices
+)
+{
+	// Blocks keep their order in the arrays, whichever thread finished them first
+	std::vector<size_t> vertex_offsets(blocks.size() + 1, 0);
+	std::vector<size_t> index_offsets(blocks.size() + 1, 0);
+	for (size_t block = 0; block < blocks.size(); ++block)
+	{
+		vertex_offsets[block + 1] = vertex_offsets[block] + (blocks[block] ? blocks[block]->positions.size() : 0);
+		index_offsets[block + 1] = index_offsets[block] + (blocks[block] ? blocks[block]->corners.size() : 0);
+	}
+
+	auto position_offset = positions.size();
+	auto normal_offset = normals.size();
+	positions.resize(position_offset + vertex_offsets.back());
+	normals.resize(normal_offset + vertex_offsets.back());
+
+	const auto unresolved = std::numeric_limits<GLuint>::max();
+	std::vector<GLuint> corners(index_offsets.back());
+	ParallelForRows(int(blocks.size()), [&](int begin, int end)
+	{
+		for (int block = begin; block < end; ++block)
+		{
+			auto& data = blocks[block];
+			if (!data)
+				continue;
+
+			std::copy(data->positions.begin(), data->positions.end(), positions.begin() + position_offset + vertex_offsets[block]);
+			std::copy(data->normals.begin(), data->normals.end(), normals.begin() + normal_offset + vertex_offsets[block]);
+
+			for (size_t i = 0; i < data->corners.size(); ++i)
+			{
+				auto corner = data->corners[i];
+				auto& output = corners[index_offsets[block] + i];
+				if (!(corner & ImplicitBlock::foreign_corner))
+				{
+					output = GLuint(vertex_offsets[block] + corner);
+					continue;
+				}
+
+				// The owner was skipped when its Lipschitz bound was too optimistic
+				auto key = corner & ~ImplicitBlock::foreign_corner;
+				auto owner = grid.OwnerBlock(grid.EdgeOrigin(key));
+				output = unresolved;
+				if (!blocks[owner])
+					continue;
+
+				auto& edges = blocks[owner]->edges;
+				auto found = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, GLuint(0)));
+				if (found != edges.end() && found->first == key)
+					output = GLuint(vertex_offsets[owner] + found->second);
+			}
+		}
+	});
+
+	size_t unresolved_triangles = 0;
+	indices.reserve(indices.size() + corners.size());
+	for (size_t i = 0; i < corners.size(); i += 3)
+	{
+		if (corners[i] == unresolved || corners[i + 1] == unresolved || corners[i + 2] == unresolved)
+		{
+			++unresolved_triangles;
+			continue;
+		}
+		indices.insert(indices.end(), corners.begin() + i, corners.begin() + i + 3);
+	}
+	return unresolved_triangles;
+}
@@ -0,0 +1,326 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "mesh_generation.h"
+
+/*
+	Marching cubes of the surface field(p) == iso_value inside an axis aligned box, into the position, normal and
+	index vectors VAO consumes. The sampling grid is split into blocks of block_size cells per axis, which the worker
+	threads sample and triangulate one at a time, so no array of the whole grid is ever allocated. A block is skipped
+	before sampling when the Lipschitz bound of the field proves the surface does not reach it, and after sampling
+	when all of its samples are on the same side of the iso value.
+
+	Every vertex sits on a grid edge and belongs to the block that holds the lower end of the edge. Triangles that use
+	a vertex of the next block find it after all blocks are done, so the mesh is connected across the blocks and the
+	output does not depend on the thread count. Normals are the normalized field gradient, from central differences.
+*/
+
+/* Implicit Surface Options */
+struct ImplicitSurfaceOptions
+{
+	// Cells of the sampling grid along x, y and z
+	glm::ivec3 resolution = glm::ivec3(128);
+
+	// Inside is where the field is below iso_value, the normals point to where it grows
+	double iso_value = 0;
+
+	// Cells per block edge, blocks are sampled, triangulated and skipped as a whole
+	int block_size = 8;
+
+	// Largest length of the field gradient. Blocks whose center value is further from iso_value than lipschitz times
+	// their half diagonal are skipped without sampling, 1 for signed distance fields, 0 samples every block.
+	// A bound that is too small skips blocks the surface reaches, their triangles are left out.
+	double lipschitz = 0;
+};
+
+struct ImplicitSurfaceStatistics
+{
+	size_t blocks;
+	size_t blocks_bounded;		// Skipped by the Lipschitz bound, without sampling
+	size_t blocks_uniform;		// Sampled, but every sample was on the same side of the iso value
+	size_t samples;				// Field evaluations on the grid, the normals take six more per vertex
+
+	// Triangles left out because a block they reach into was skipped, 0 unless lipschitz is too small
+	size_t unresolved_triangles;
+};
+
+/* Marching Cubes */
+// Corner c of a cell is at (c & 1, (c >> 1) & 1, (c >> 2) & 1), edge e runs along axis e / 4 from the corner
+// MarchingCubesEdgeOrigin(e). Case index bit c is set when corner c is inside.
+struct MarchingCubesCase
+{
+	int triangle_count;
+	int edges[15];
+};
+
+const MarchingCubesCase& GetMarchingCubesCase(int case_index);
+int MarchingCubesEdgeOrigin(int edge);
+
+/* Blocks */
+// Lattice points, edges and blocks of the sampling grid
+struct ImplicitGrid
+{
+	glm::dvec3 min;
+	glm::dvec3 cell_size;
+	glm::ivec3 resolution;
+	int block_size;
+	glm::ivec3 blocks;
+
+	ImplicitGrid(const glm::dvec3& min, const glm::dvec3& max, const glm::ivec3& resolution, int block_size);
+
+	size_t BlockCount() const
+	{
+		return size_t(blocks.x) * blocks.y * blocks.z;
+	}
+
+	glm::ivec3 BlockCoordinates(size_t block) const
+	{
+		return glm::ivec3(int(block % blocks.x), int(block / blocks.x % blocks.y), int(block / blocks.x / blocks.y));
+	}
+
+	glm::dvec3 Point(const glm::ivec3& lattice_point) const
+	{
+		return min + glm::dvec3(lattice_point) * cell_size;
+	}
+
+	// Edges are keyed by their lower lattice point and their axis
+	std::uint64_t EdgeKey(const glm::ivec3& lattice_point, int axis) const
+	{
+		auto x = std::uint64_t(lattice_point.x), y = std::uint64_t(lattice_point.y), z = std::uint64_t(lattice_point.z);
+		return ((z * (resolution.y + 1) + y) * (resolution.x + 1) + x) * 3 + axis;
+	}
+
+	glm::ivec3 EdgeOrigin(std::uint64_t key) const
+	{
+		auto point = key / 3;
+		auto x = int(point % (resolution.x + 1));
+		auto y = int(point / (resolution.x + 1) % (resolution.y + 1));
+		auto z = int(point / (resolution.x + 1) / (resolution.y + 1));
+		return glm::ivec3(x, y, z);
+	}
+
+	// Block that owns the edges starting at lattice_point, the points on the upper grid faces go to the last blocks
+	size_t OwnerBlock(const glm::ivec3& lattice_point) const
+	{
+		auto block = glm::min(lattice_point / block_size, blocks - 1);
+		return (size_t(block.z) * blocks.y + block.y) * blocks.x + block.x;
+	}
+};
+
+// Triangles of one block. Corners below foreign_corner are vertices of the block, the others are
+// foreign_corner | EdgeKey of a vertex owned by another block.
+struct ImplicitBlock
+{
+	static const std::uint64_t foreign_corner = std::uint64_t(1) << 63;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<std::uint64_t> corners;
+
+	// Edge key and vertex of every vertex of the block, sorted by key
+	std::vector<std::pair<std::uint64_t, GLuint>> edges;
+};
+
+enum class ImplicitBlockResult
+{
+	Bounded,
+	Uniform,
+	Triangulated
+};
+
+// Samples and triangulates one block, output stays NULL when the block has no triangles.
+// samples and edge_vertices are scratch memory that the calls of a worker thread reuse.
+template <typename Field>
+ImplicitBlockResult TriangulateImplicitBlock(
+	const Field& field,
+	const ImplicitGrid& grid,
+	const ImplicitSurfaceOptions& options,
+	size_t block,
+	std::vector<double>& samples,
+	std::unordered_map<std::uint64_t, GLuint>& edge_vertices,
+	std::unique_ptr<ImplicitBlock>& output
+)
+{
+	auto iso_value = options.iso_value;
+	auto low = grid.BlockCoordinates(block) * grid.block_size;
+	auto high = glm::min(low + grid.block_size, grid.resolution);
+
+	if (options.lipschitz > 0)
+	{
+		auto low_point = grid.Point(low);
+		auto high_point = grid.Point(high);
+		auto center_value = field((low_point + high_point) / 2.);
+		if (std::abs(center_value - iso_value) > options.lipschitz * glm::length(high_point - low_point) / 2.)
+			return ImplicitBlockResult::Bounded;
+	}
+
+	// The lattice points of the block, including those on its upper faces
+	auto size = high - low + 1;
+	samples.resize(size_t(size.x) * size.y * size.z);
+	auto SampleAt = [&samples, size](int x, int y, int z) -> double&
+	{
+		return samples[(size_t(z) * size.y + y) * size.x + x];
+	};
+
+	auto inside = false;
+	auto outside = false;
+	for (int z = 0; z < size.z; ++z)
+		for (int y = 0; y < size.y; ++y)
+			for (int x = 0; x < size.x; ++x)
+			{
+				auto value = field(grid.Point(low + glm::ivec3(x, y, z)));
+				SampleAt(x, y, z) = value;
+				if (value < iso_value)
+					inside = true;
+				else
+					outside = true;
+			}
+
+	if (!inside || !outside)
+		return ImplicitBlockResult::Uniform;
+
+	// Central differences a small fraction of a cell wide
+	auto step = std::min({ grid.cell_size.x, grid.cell_size.y, grid.cell_size.z }) * 1e-2;
+	auto Gradient = [&field, step](const glm::dvec3& p)
+	{
+		return glm::dvec3(
+			field(p + glm::dvec3(step, 0, 0)) - field(p - glm::dvec3(step, 0, 0)),
+			field(p + glm::dvec3(0, step, 0)) - field(p - glm::dvec3(0, step, 0)),
+			field(p + glm::dvec3(0, 0, step)) - field(p - glm::dvec3(0, 0, step))
+		);
+	};
+
+	std::unique_ptr<ImplicitBlock> result(new ImplicitBlock());
+	edge_vertices.clear();
+	for (int z = 0; z < size.z - 1; ++z)
+		for (int y = 0; y < size.y - 1; ++y)
+			for (int x = 0; x < size.x - 1; ++x)
+			{
+				double values[8];
+				int case_index = 0;
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					values[corner] = SampleAt(x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1));
+					if (values[corner] < iso_value)
+						case_index |= 1 << corner;
+				}
+
+				auto& cube_case = GetMarchingCubesCase(case_index);
+				for (int i = 0; i < cube_case.triangle_count * 3; ++i)
+				{
+					auto edge = cube_case.edges[i];
+					auto axis = edge / 4;
+					auto from = MarchingCubesEdgeOrigin(edge);
+					auto to = from | (1 << axis);
+
+					auto lattice_point = low + glm::ivec3(x + (from & 1), y + ((from >> 1) & 1), z + ((from >> 2) & 1));
+					auto key = grid.EdgeKey(lattice_point, axis);
+					if (grid.OwnerBlock(lattice_point) != block)
+					{
+						result->corners.push_back(ImplicitBlock::foreign_corner | key);
+						continue;
+					}
+
+					auto inserted = edge_vertices.emplace(key, GLuint(result->positions.size()));
+					if (inserted.second)
+					{
+						auto end_point = lattice_point;
+						end_point[axis] += 1;
+						auto t = (iso_value - values[from]) / (values[to] - values[from]);
+						auto position = glm::mix(grid.Point(lattice_point), grid.Point(end_point), t);
+						result->positions.push_back(position);
+						result->normals.push_back(glm::normalize(Gradient(position)));
+					}
+					result->corners.push_back(inserted.first->second);
+				}
+			}
+
+	result->edges.assign(edge_vertices.begin(), edge_vertices.end());
+	std::sort(result->edges.begin(), result->edges.end());
+	output = std::move(result);
+	return ImplicitBlockResult::Triangulated;
+}
+
+// Appends the vertices of the blocks in block order and resolves the corners that point into other blocks
+size_t AssembleImplicitBlocks(
+	const ImplicitGrid& grid,
+	const std::vector<std::unique_ptr<ImplicitBlock>>& blocks,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices
+);
+
+/* Generator Functions */
+// field(glm::dvec3) -> double is sampled on the grid of options.resolution cells between min and max, it is called
+// from the worker threads. The mesh is a triangle list appended to the vectors, like SeparateArraysLayout its
+// indices count from the first appended vertex.
+template <typename Field>
+ImplicitSurfaceStatistics GenerateImplicitSurface(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	const Field& field,
+	const glm::dvec3& min,
+	const glm::dvec3& max,
+	const ImplicitSurfaceOptions& options = ImplicitSurfaceOptions()
+)
+{
+	ImplicitGrid grid(min, max, options.resolution, options.block_size);
+	std::vector<std::unique_ptr<ImplicitBlock>> blocks(grid.BlockCount());
+	std::vector<ImplicitBlockResult> results(blocks.size());
+
+	ParallelForRows(int(blocks.size()), [&](int begin, int end)
+	{
+		std::vector<double> samples;
+		std::unordered_map<std::uint64_t, GLuint> edge_vertices;
+		for (int block = begin; block < end; ++block)
+			results[block] = TriangulateImplicitBlock(field, grid, options, size_t(block), samples, edge_vertices, blocks[block]);
+	});
+
+	ImplicitSurfaceStatistics statistics = {};
+	statistics.blocks = blocks.size();
+	for (size_t block = 0; block < blocks.size(); ++block)
+	{
+		if (results[block] == ImplicitBlockResult::Bounded)
+		{
+			++statistics.blocks_bounded;
+			continue;
+		}
+
+		auto low = grid.BlockCoordinates(block) * grid.block_size;
+		auto size = glm::min(low + grid.block_size, grid.resolution) - low + 1;
+		statistics.samples += size_t(size.x) * size.y * size.z;
+		if (results[block] == ImplicitBlockResult::Uniform)
+			++statistics.blocks_uniform;
+	}
+
+	statistics.unresolved_triangles = AssembleImplicitBlocks(grid, blocks, positions, normals, indices);
+	return statistics;
+}
+
+/* Example Fields */
+// Signed distance of a torus around the Y axis, the same shape as the ParametricCircle revolution
+inline double TorusField(const glm::dvec3& p)
+{
+	auto ring = glm::length(glm::dvec2(p.x, p.z)) - 0.7;
+	return glm::length(glm::dvec2(ring, p.y)) - 0.3;
+}
+
+// Sphere of radius 0.6 smoothly blended with a torus of radius 0.9, not a distance but 1-Lipschitz
+inline double BlobField(const glm::dvec3& p)
+{
+	auto sphere = glm::length(p) - 0.6;
+	auto torus = glm::length(glm::dvec2(glm::length(glm::dvec2(p.x, p.z)) - 0.9, p.y)) - 0.15;
+	auto k = 0.2;
+	auto h = glm::clamp(0.5 + 0.5 * (torus - sphere) / k, 0., 1.);
+	return glm::mix(torus, sphere, h) - k * h * (1 - h);
+}
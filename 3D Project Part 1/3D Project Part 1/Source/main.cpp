@@ -1,4 +1,10 @@
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include "GLM/glm.hpp"
@@ -9,6 +15,15 @@
 
 #include "opengl_utilities.h"
 #include "mesh_generation.h"
+#include "mesh_optimization.h"
+#include "mesh_simplification.h"
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "topology_registry.h"
+#include "procedural_surface.h"
+#include "culling.h"
+#include "mesh_clusters.h"
+#include "benchmark.h"
 
 /* Keep the global state inside this struct */
 static struct 
@@ -46,9 +61,576 @@ static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, i
 }
 
 /* Scene Generation Functions*/
+// How the meshes are stored and post-processed, set from the command line
+struct MeshSettings
+{
+	VertexFormat vertex_format;
+	GridIndexOptions index_options;
+
+	// Normals of the generators, --dual-normals takes the exact derivatives of the example functions
+	NormalMethod normal_method = NormalMethod::SampledGrid;
+
+	// Post-processing passes, they go through client memory and triangle lists
+	bool weld = false;
+	bool remove_degenerates = false;
+	bool optimize = false;
+
+	// Sorts the clusters of the optimized triangle order against overdraw, the ACMR may grow by this factor, 0 leaves it out
+	float overdraw_threshold = 0;
+
+	// Split the triangles in meshlets that are culled one by one, after the other passes
+	bool meshlets = false;
+
+	// Simplify to this many triangles or this error in object units, 0 leaves the count or the error open
+	size_t simplify_triangles = 0;
+	double simplify_error = 0;
+
+	// Load the meshes from mesh_cache/ when an earlier run stored them, --no-mesh-cache always generates
+	bool cache = true;
+
+	// Generate coarser levels of detail next to every mesh, --no-lod only generates full detail
+	bool lod = true;
+
+	// Grid meshes of the same topology draw from one element array buffer, --no-shared-topology gives each its own
+	bool shared_topology = true;
+
+	bool PostProcessing() const
+	{
+		return weld || remove_degenerates || simplify_triangles > 0 || simplify_error > 0 || optimize || meshlets;
+	}
+};
+
+// Generates the VAO of a vertical_segments x rotation_segments mesh. generate(vertical_segments, rotation_segments, output...)
+// calls a generator function with either a MeshSpan or the position, normal and index vectors as output.
+// poles are the pole columns of the grid, when the mesh was generated into the mapped buffers.
+template <typename Generate>
+static VAO GenerateParametricVAO(const MeshSettings& settings, int vertical_segments, int rotation_segments, const Generate& generate,
+	bool& generated, GridPoles& poles)
+{
+	auto& format = settings.vertex_format;
+	generated = true;
+	auto simplify = settings.simplify_triangles > 0 || settings.simplify_error > 0;
+	if (settings.PostProcessing())
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<GLuint> indices;
+		generate(vertical_segments, rotation_segments, positions, normals, indices);
+
+		if (settings.weld)
+		{
+			auto statistics = WeldVertices(positions, normals, indices);
+			auto welded = statistics.vertices_before - statistics.vertices_after;
+			std::cout << "Vertex welding of a " << vertical_segments << "x" << rotation_segments << " mesh: " << statistics.vertices_before
+				<< " -> " << statistics.vertices_after << " vertices, " << welded * format.VertexSize() << " bytes saved" << std::endl;
+		}
+
+		// The generators only leave out the pole triangles, welding can collapse others
+		if (settings.remove_degenerates)
+		{
+			auto statistics = RemoveDegenerateTriangles(positions, indices);
+			std::cout << "Degenerate triangles of a " << vertical_segments << "x" << rotation_segments << " mesh: "
+				<< statistics.repeated_index << " with a repeated index, " << statistics.zero_area << " without area, of "
+				<< statistics.triangles_before << std::endl;
+		}
+
+		// Before the optimization, which orders the triangles that are left
+		if (simplify)
+		{
+			SimplificationOptions options;
+			options.target_triangles = settings.simplify_triangles;
+			options.max_error = settings.simplify_error;
+			auto statistics = SimplifyMesh(positions, normals, indices, options);
+			std::cout << "Simplification of a " << vertical_segments << "x" << rotation_segments << " mesh: " << statistics.triangles_before
+				<< " -> " << statistics.triangles_after << " triangles, " << statistics.vertices_before << " -> " << statistics.vertices_after
+				<< " vertices, error " << statistics.error << std::endl;
+		}
+
+		if (settings.optimize)
+			OptimizeMesh(positions, normals, indices, true, settings.overdraw_threshold);
+
+		if (settings.meshlets)
+		{
+			std::vector<DrawRange> ranges;
+			std::vector<ClusterBounds> clusters;
+			auto statistics = BuildMeshlets(positions, normals, indices, ranges, clusters);
+			std::cout << "Meshlets of a " << vertical_segments << "x" << rotation_segments << " mesh: " << statistics.meshlets
+				<< " meshlets, " << statistics.vertices_before << " -> " << statistics.vertices_after << " vertices"
+				<< (statistics.closed ? "" : ", open mesh without normal cones") << std::endl;
+
+			VAO vao(positions, normals, indices, ranges, format);
+			vao.clusters = clusters;
+			return vao;
+		}
+		return VAO(positions, normals, indices, format);
+	}
+
+	// Otherwise the mesh goes straight into the mapped buffers, without a copy in client memory. Shared grid indices
+	// are only written once the poles tell whether the topology registry has them already.
+	auto share = settings.shared_topology;
+	auto plan = PlanGridMesh(vertical_segments, rotation_segments, settings.index_options);
+	auto vertex_count = plan.vertex_count;
+	auto index_count = plan.index_count;
+	VAO vao(static_cast<GLsizei>(vertex_count), static_cast<GLsizei>(index_count), format, plan.index_format, !share);
+
+	// glUnmapBuffer reports when the driver lost the mapped contents, the mesh is generated again then
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		MeshSpan span = { NULL, NULL, NULL, vertex_count, index_count, format, settings.index_options };
+		if (!vao.MapBuffers(span.positions, span.normals, span.indices))
+			break;
+
+		generated = generate(vertical_segments, rotation_segments, span);
+		vao.bounds = span.bounds;
+		if (format.position == PositionFormat::Snorm16x4)
+			vao.dequantization = span.quantization.DequantizationTransform();
+
+		if (vao.UnmapBuffers() && generated)
+		{
+			// Pole fans draw fewer indices than planned, the rest of the element array stays unused
+			vao.element_array_count = static_cast<GLsizei>(span.index_count);
+			vao.index_format = span.index_format;
+			poles = span.poles;
+			if (!share)
+				return vao;
+
+			SetGridPoles(plan, poles);
+			if (CreateGridElementArray(vao, plan, true))
+				return vao;
+			break;
+		}
+	}
+
+	std::cout << "Error: Mesh generation into the VAO buffers failed" << std::endl;
+	generated = false;
+	return vao;
+}
+
+// GenerateParametricVAO behind the mesh cache. key names the generator, the function, the segment counts and
+// the precision, the settings add the rest. Meshes that stay grids take their indices from the topology registry.
+// poles are the pole columns the grid indices leave out.
+template <typename Generate>
+static VAO CreateParametricVAO(const MeshSettings& settings, MeshCacheKey key, const Generate& generate, GridPoles& poles)
+{
+	key.format = settings.vertex_format;
+	key.index_options = settings.index_options;
+	if (!GetMeshGenerationSimdEnabled())
+		key.options += " no_simd";
+	if (settings.normal_method == NormalMethod::DualNumbers)
+		key.options += " dual_normals";
+	if (settings.weld)
+		key.options += " weld";
+	if (settings.remove_degenerates)
+		key.options += " remove_degenerates";
+	if (settings.simplify_triangles > 0)
+		key.options += " simplify " + std::to_string(settings.simplify_triangles);
+	if (settings.simplify_error > 0)
+		key.options += " simplify_error " + std::to_string(settings.simplify_error);
+	if (settings.simplify_triangles > 0 || settings.simplify_error > 0)
+		key.options += " slabs " + std::to_string(GetMeshGenerationThreadCount());
+	if (settings.optimize)
+		key.options += " optimize";
+	if (settings.optimize && settings.overdraw_threshold > 0)
+		key.options += " overdraw " + std::to_string(settings.overdraw_threshold);
+	if (settings.meshlets)
+		key.options += " meshlets";
+
+	// The post-processing passes reorder and remove triangles, the indices are no longer those of the grid
+	auto share = settings.shared_topology && !settings.PostProcessing();
+	poles = GridPoles();
+	if (settings.cache)
+	{
+		auto cached = LoadMeshCache(key, poles, share);
+		if (cached)
+			return *cached;
+	}
+
+	bool generated;
+	auto vao = GenerateParametricVAO(settings, key.vertical_segments, key.rotation_segments, generate, generated, poles);
+	if (settings.cache && generated)
+		SaveMeshCache(key, vao, poles);
+	return vao;
+}
+
+/* Levels of Detail */
+// Every level of detail of one shape, with the level selected in the previous frame for the hysteresis
+struct ParametricLod
+{
+	std::vector<LodLevel> levels;
+	std::vector<VAO> vaos;
+	std::vector<size_t> triangle_counts;
+	int current_level = -1;
+
+	// Of every level, the coarse levels do not stay exactly inside the full detail mesh
+	MeshBounds bounds = EmptyBounds();
+
+	// One per level when the vertex shader builds the vertices, empty for meshes with stored vertices
+	std::vector<ProceduralMesh> procedural;
+
+	// Visible meshlets of the level drawn last, kept between frames so that culling does not allocate
+	std::vector<char> visible_clusters;
+};
+
+// Triangles drawn per frame, against the triangles of the same draws at full detail
+struct LodStatistics
+{
+	size_t frames = 0;
+	size_t triangles_drawn = 0;
+	size_t triangles_full_detail = 0;
+	double start_time = 0;
+};
+
+// Triangle lists count by their indices, also after the post-processing passes. Strips are only drawn by meshes
+// that stay grids, plan is their grid with the poles it left out.
+static size_t CountGridTriangles(const VAO& vao, const GridMeshPlan& plan)
+{
+	if (vao.index_format.primitive == GL_TRIANGLE_STRIP)
+		return GridTriangleCount(plan);
+	return size_t(vao.element_array_count) / 3;
+}
+
+// CreateParametricVAO for every level of detail, key is the full detail mesh
+template <typename Generate>
+static ParametricLod CreateParametricLod(const MeshSettings& settings, const MeshCacheKey& key, const Generate& generate)
+{
+	ParametricLod lod;
+	if (settings.lod)
+		lod.levels = PlanLodChain(key.vertical_segments, key.rotation_segments);
+	else
+		lod.levels = PlanLodChain(key.vertical_segments, key.rotation_segments, { 1 });
+
+	for (auto& level : lod.levels)
+	{
+		auto level_key = key;
+		level_key.vertical_segments = level.vertical_segments;
+		level_key.rotation_segments = level.rotation_segments;
+		GridPoles poles;
+		lod.vaos.push_back(CreateParametricVAO(settings, level_key, generate, poles));
+
+		auto plan = PlanGridMesh(level.vertical_segments, level.rotation_segments, settings.index_options);
+		SetGridPoles(plan, poles);
+		lod.triangle_counts.push_back(CountGridTriangles(lod.vaos.back(), plan));
+		ExtendBounds(lod.bounds, lod.vaos.back().bounds);
+	}
+
+	// The errors are sampled from the surface, cached levels need them as well
+	if (lod.levels.size() > 1)
+		MeasureLodErrors(lod.levels, generate);
+	return lod;
+}
+
+// Levels of detail of a surface the vertex shader builds from gl_VertexID, only their element arrays are stored.
+// generate is the CPU generator of the same surface, for the level errors.
+template <typename Generate>
+static ParametricLod CreateProceduralLod(const MeshSettings& settings, const ProceduralMesh& mesh, const Generate& generate)
+{
+	ParametricLod lod;
+	if (settings.lod)
+		lod.levels = PlanLodChain(mesh.vertical_segments, mesh.rotation_segments);
+	else
+		lod.levels = PlanLodChain(mesh.vertical_segments, mesh.rotation_segments, { 1 });
+
+	for (auto& level : lod.levels)
+	{
+		auto level_mesh = mesh;
+		level_mesh.vertical_segments = level.vertical_segments;
+		level_mesh.rotation_segments = level.rotation_segments;
+		lod.procedural.push_back(level_mesh);
+
+		// The grid has no poles for the shader, its indices are those of every other grid without poles
+		auto vao = CreateProceduralVAO(level_mesh, settings.index_options, settings.shared_topology);
+		lod.vaos.push_back(vao);
+		auto index_options = settings.index_options;
+		index_options.pole_fans = false;
+		lod.triangle_counts.push_back(CountGridTriangles(vao, PlanGridMesh(level.vertical_segments, level.rotation_segments, index_options)));
+		ExtendBounds(lod.bounds, vao.bounds);
+	}
+
+	if (lod.levels.size() > 1)
+		MeasureLodErrors(lod.levels, generate);
+	return lod;
+}
+
+/* Morph Targets */
+// Generates one target of a MorphVAO per entry of targets on the same vertical_segments x rotation_segments grid.
+// targets[i](vertical_segments, rotation_segments, span) calls a generator function with a MeshSpan. Pole fans are
+// off, so every target keeps the indices of the full grid, also when its shape has poles.
+static MorphVAO CreateMorphVAO(const MeshSettings& settings, int vertical_segments, int rotation_segments,
+	const std::vector<std::function<bool(int, int, MeshSpan&)>>& targets)
+{
+	auto index_options = settings.index_options;
+	index_options.pole_fans = false;
+	auto plan = PlanGridMesh(vertical_segments, rotation_segments, index_options);
+	MorphVAO morph(static_cast<GLsizei>(plan.vertex_count), static_cast<GLsizei>(plan.index_count), int(targets.size()),
+		settings.vertex_format, plan.index_format);
+
+	// Every target writes the indices again, they have to be the ones of target 0
+	std::vector<char> indices(plan.index_count * plan.index_format.IndexSize());
+	std::vector<char> target_indices(indices.size());
+	for (int target = 0; target < morph.target_count; ++target)
+	{
+		MeshSpan span = { NULL, NULL, target == 0 ? indices.data() : target_indices.data(), plan.vertex_count, plan.index_count,
+			settings.vertex_format, index_options };
+
+		// glUnmapBuffer reports when the driver lost the mapped contents, the target is generated again then
+		auto generated = false;
+		for (int attempt = 0; attempt < 2 && !generated; ++attempt)
+		{
+			if (!morph.MapTargetBuffers(target, span.positions, span.normals))
+				break;
+			generated = targets[target](vertical_segments, rotation_segments, span);
+			generated = morph.UnmapTargetBuffers(target) && generated;
+		}
+
+		if (!generated || (target > 0 && target_indices != indices))
+		{
+			std::cout << "Error: Morph target " << target << " could not be generated on the grid of target 0" << std::endl;
+			morph.target_count = target;
+			break;
+		}
+		morph.SetQuantization(target, span.quantization);
+
+		// Blends with weights that add up to 1 stay inside the bounds of the targets
+		ExtendBounds(morph.vao.bounds, span.bounds);
+	}
+
+	glBindVertexArray(morph.vao.id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, morph.vao.element_array_buffer);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, GLsizeiptr(indices.size()), indices.data());
+	return morph;
+}
+
+// Holds every target for half of period seconds, then blends smoothly into the next one
+static glm::vec4 MorphCycleWeights(double time, int target_count, double period)
+{
+	glm::vec4 weights(0);
+	if (target_count == 0)
+		return weights;
+
+	auto phase = time / period;
+	auto from = int(std::fmod(std::floor(phase), double(target_count)));
+	auto to = (from + 1) % target_count;
+	auto blend = float(glm::smoothstep(0.5, 1., phase - std::floor(phase)));
+	weights[from] += 1 - blend;
+	weights[to] += blend;
+	return weights;
+}
+
+// Uniform locations of a scene program, looked up once after linking instead of on every draw
+struct SceneUniforms
+{
+	GLint transform;
+	GLint procedural;
+	ProceduralUniforms procedural_surface;
+};
+
+static SceneUniforms GetSceneUniforms(GLuint program)
+{
+	return { glGetUniformLocation(program, "u_transform"), glGetUniformLocation(program, "u_procedural"), GetProceduralUniforms(program) };
+}
+
+// Draws the coarsest level that keeps its error within the threshold at the size transform projects the shape to,
+// nothing when the shape is outside the view frustum
+static void DrawParametricLod(ParametricLod& lod, const glm::mat4& transform, const SceneUniforms& uniforms, const LodSelectionOptions& options, LodStatistics& statistics,
+	const CullingOptions& culling_options, CullingStatistics& culling_statistics)
+{
+	if (CullDraw(transform, lod.bounds, culling_options, culling_statistics))
+		return;
+
+	auto pixels_per_unit = ProjectedPixelsPerUnit(transform, glm::vec2(Globals.screen_dimensions));
+	lod.current_level = SelectLodLevel(lod.levels, pixels_per_unit, options, lod.current_level);
+
+	// Every scene program can build the vertices from gl_VertexID, u_procedural is program state and set on every draw
+	glUniform1i(uniforms.procedural, lod.procedural.empty() ? GL_FALSE : GL_TRUE);
+	if (!lod.procedural.empty())
+		SetProceduralUniforms(uniforms.procedural_surface, lod.procedural[lod.current_level]);
+
+	auto& vao = lod.vaos[lod.current_level];
+	glUniformMatrix4fv(uniforms.transform, 1, GL_FALSE, glm::value_ptr(transform * vao.dequantization));
+	if (vao.clusters.empty())
+	{
+		DrawVAO(vao);
+		statistics.triangles_drawn += lod.triangle_counts[lod.current_level];
+	}
+	else
+	{
+		// The clusters are in object space like the bounds, before the dequantization
+		statistics.triangles_drawn += CullClusters(transform, vao.clusters, vao.index_format.ranges, culling_options, culling_statistics,
+			lod.visible_clusters);
+		DrawVAORanges(vao, lod.visible_clusters);
+	}
+
+	statistics.triangles_full_detail += lod.triangle_counts[0];
+}
+
+/* Command Line */
+static void PrintUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n"
+		"  --threads N              Mesh generation threads, 0 for every hardware thread (default)\n"
+		"  --no-simd                Evaluate the example functions one point at a time\n"
+		"  --float                  Generate the large surface in single precision\n"
+		"  --float-vertices         Two GL_FLOAT x3 vertex buffers instead of packed 12 byte vertices\n"
+		"  --triangle-strips        One triangle strip per grid row instead of triangle lists\n"
+		"  --dual-normals           Exact normals from dual numbers for the example functions\n"
+		"  --weld                   Merge vertices closer than a small tolerance\n"
+		"  --remove-degenerates     Drop zero area triangles\n"
+		"  --optimize               Reorder for the vertex cache and vertex fetch\n"
+		"  --optimize-overdraw      --optimize, then sort the triangle clusters against overdraw\n"
+		"  --simplify N             Simplify every mesh to N triangles\n"
+		"  --simplify-error E       Simplify every mesh up to an error of E object units\n"
+		"  --meshlets               Split the meshes in meshlets culled one by one\n"
+		"  --no-mesh-cache          Always generate, never load or store mesh_cache/\n"
+		"  --no-shared-topology     Give every grid mesh its own element array\n"
+		"  --no-lod                 Generate full detail only\n"
+		"  --lod-error P            Screen space error of the levels of detail in pixels\n"
+		"  --lod-hysteresis H       Fraction the error has to change by before the level switches\n"
+		"  --no-culling             Draw the meshes outside the view frustum as well\n"
+		"  --no-cluster-culling     Draw every meshlet\n"
+		"  --gpu-procedural         Build the vertices of the large surface in the vertex shader\n"
+		"  --overdraw               Count the shaded fragments per pixel\n"
+		"  --benchmark              Run the mesh generation benchmarks and exit\n"
+		"  --validate-gpu           Compare the procedural vertex shader with the CPU generators and exit"
+		<< std::endl;
+}
+
+// The whole of text as a number, std::stoi and friends throw on bad input and accept trailing characters
+static bool ParseCount(const char* text, unsigned long& value)
+{
+	char* end = NULL;
+	errno = 0;
+	value = std::strtoul(text, &end, 10);
+	return text[0] >= '0' && text[0] <= '9' && *end == '\0' && errno == 0;
+}
+
+static bool ParseNumber(const char* text, double& value)
+{
+	char* end = NULL;
+	errno = 0;
+	value = std::strtod(text, &end);
+	return end != text && *end == '\0' && errno == 0 && std::isfinite(value) && value >= 0;
+}
 
 int main(int argc, char* argv[])
 {
+	/* Parse command line arguments */
+	bool run_benchmarks = false;
+	bool run_gpu_validation = false;
+	bool float_precision = false;
+	bool gpu_procedural = false;
+	bool measure_overdraw = false;
+
+	MeshSettings mesh_settings;
+	LodSelectionOptions lod_selection;
+	CullingOptions culling_options;
+
+	// 12 bytes per vertex instead of 24, --float-vertices switches back to two GL_FLOAT x3 buffers
+	mesh_settings.vertex_format = { PositionFormat::Snorm16x4, NormalFormat::Int2101010, true };
+
+	// 16 bit indices, chunked with base vertices above 0xFFFF vertices. Triangle lists, --triangle-strips draws
+	// one strip per row instead.
+	mesh_settings.index_options.short_indices = true;
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		auto valid = true;
+		auto takes_value = false;
+		auto value = i + 1 < argc ? argv[i + 1] : "";
+		unsigned long count = 0;
+		double number = 0;
+
+		if (argument == "--threads")
+		{
+			valid = ParseCount(value, count) && count <= 1024;
+			SetMeshGenerationThreadCount(unsigned(count));
+			takes_value = true;
+		}
+		else if (argument == "--no-simd")
+			SetMeshGenerationSimdEnabled(false);
+		else if (argument == "--float")
+			float_precision = true;
+		else if (argument == "--float-vertices")
+			mesh_settings.vertex_format = VertexFormat();
+		else if (argument == "--triangle-strips")
+			mesh_settings.index_options.strips = true;
+		else if (argument == "--dual-normals")
+			mesh_settings.normal_method = NormalMethod::DualNumbers;
+		else if (argument == "--weld")
+			mesh_settings.weld = true;
+		else if (argument == "--remove-degenerates")
+			mesh_settings.remove_degenerates = true;
+		else if (argument == "--no-mesh-cache")
+			mesh_settings.cache = false;
+		else if (argument == "--optimize")
+			mesh_settings.optimize = true;
+		else if (argument == "--optimize-overdraw")
+		{
+			mesh_settings.optimize = true;
+			mesh_settings.overdraw_threshold = 1.05f;
+		}
+		else if (argument == "--simplify")
+		{
+			valid = ParseCount(value, count);
+			mesh_settings.simplify_triangles = count;
+			takes_value = true;
+		}
+		else if (argument == "--simplify-error")
+		{
+			valid = ParseNumber(value, number);
+			mesh_settings.simplify_error = number;
+			takes_value = true;
+		}
+		else if (argument == "--no-shared-topology")
+			mesh_settings.shared_topology = false;
+		else if (argument == "--no-lod")
+			mesh_settings.lod = false;
+		else if (argument == "--lod-error")
+		{
+			valid = ParseNumber(value, number);
+			lod_selection.pixel_error = number;
+			takes_value = true;
+		}
+		else if (argument == "--lod-hysteresis")
+		{
+			valid = ParseNumber(value, number);
+			lod_selection.hysteresis = number;
+			takes_value = true;
+		}
+		else if (argument == "--no-culling")
+			culling_options.frustum = false;
+		else if (argument == "--meshlets")
+			mesh_settings.meshlets = true;
+		else if (argument == "--no-cluster-culling")
+			culling_options.clusters = false;
+		else if (argument == "--gpu-procedural")
+			gpu_procedural = true;
+		else if (argument == "--overdraw")
+			measure_overdraw = true;
+		else if (argument == "--benchmark")
+			run_benchmarks = true;
+		else if (argument == "--validate-gpu")
+			run_gpu_validation = true;
+		else
+			valid = false;
+
+		if (!valid)
+		{
+			if (takes_value)
+				std::cout << "Error: Invalid value \"" << value << "\" for " << argument << std::endl;
+			else
+				std::cout << "Error: Unknown argument " << argument << std::endl;
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		if (takes_value)
+			++i;
+	}
+
+	if (run_benchmarks)
+	{
+		return RunMeshGenerationBenchmarks() ? 0 : 1;
+	}
+
 	/* Set GLFW error callback */
 	glfwSetErrorCallback(ErrorCallback);
 
@@ -66,6 +648,7 @@ int main(int argc, char* argv[])
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 	glfwWindowHint(GLFW_TRANSPARENT_FRAMEBUFFER, GLFW_TRUE);
+	glfwWindowHint(GLFW_STENCIL_BITS, 8);
 
 	GLFWwindow* window = glfwCreateWindow(
 		Globals.screen_dimensions.x, Globals.screen_dimensions.y,
@@ -92,6 +675,27 @@ int main(int argc, char* argv[])
 		return -1;
 	}
 
+	/* Compare the procedural vertex shader with the CPU generators, runs under a software driver as well */
+	if (run_gpu_validation)
+	{
+		auto passed = true;
+		for (auto parametric_line : { ParametricHalfCircle, ParametricCircle, ParametricSpikes, ParametricSpikyv2 })
+		{
+			ProceduralMesh mesh;
+			CreateProceduralMesh(mesh, ProceduralSurface::Revolution, parametric_line, 64, 64);
+			passed &= ValidateProceduralSurface(mesh);
+			CreateProceduralMesh(mesh, ProceduralSurface::Surfacev2, parametric_line, 64, 64);
+			passed &= ValidateProceduralSurface(mesh);
+		}
+
+		ProceduralMesh parametric_two_mesh;
+		CreateProceduralMesh(parametric_two_mesh, ProceduralSurface::Surfacev2, ParametricSpikes, 1024, 1024);
+		passed &= ValidateProceduralSurface(parametric_two_mesh);
+
+		glfwTerminate();
+		return passed ? 0 : 1;
+	}
+
 	/* Set GLFW Callbacks */
 	glfwSetCursorPosCallback(window, CursorPositionCallback);
 	glfwSetWindowSizeCallback(window, WindowSizeCallback);
@@ -101,55 +705,98 @@ int main(int argc, char* argv[])
 	glClearColor(0, 0, 0, 1);
 	glEnable(GL_DEPTH_TEST);
 
-	/* Creating OpenGL objects */
-	std::vector<glm::vec3> positions;
-	std::vector<glm::vec3> normals;
-	std::vector<GLuint> indices;
+	// --overdraw counts the shaded fragments of every pixel in the stencil buffer, printed with the statistics
+	if (measure_overdraw)
+		BeginOverdrawMeasurement();
 
 	/* Creating Meshes */
-	GenerateParametricShapeFrom2D(positions, normals, indices, ParametricHalfCircle, 16, 16);
-	VAO sphereVAO(positions, normals, indices);
-
-	positions.clear();
-	normals.clear();
-	indices.clear();
+	auto generation_start = std::chrono::high_resolution_clock::now();
+	auto normal_method = mesh_settings.normal_method;
 
-	GenerateParametricShapeFrom2D(positions, normals, indices, ParametricCircle, 16, 16);
-	VAO torusVAO(positions, normals, indices);
-
-	positions.clear();
-	normals.clear();
-	indices.clear();
+	ParametricLod sphere_lod = CreateParametricLod(mesh_settings, { "GenerateParametricShapeFrom2D", "ParametricHalfCircle", 16, 16, "double" }, [normal_method](int v, int r, auto&... output)
+	{
+		return GenerateParametricShapeFrom2D(output..., ParametricHalfCircle, v, r, normal_method);
+	});
 
-	GenerateParametricShapeFrom2D(positions, normals, indices, ParametricSpikes, 64, 32);
-	VAO parametric_one_VAO(positions, normals, indices);
+	ParametricLod torus_lod = CreateParametricLod(mesh_settings, { "GenerateParametricShapeFrom2D", "ParametricCircle", 16, 16, "double" }, [normal_method](int v, int r, auto&... output)
+	{
+		return GenerateParametricShapeFrom2D(output..., ParametricCircle, v, r, normal_method);
+	});
 
-	positions.clear();
-	normals.clear();
-	indices.clear();
+	ParametricLod parametric_one_lod = CreateParametricLod(mesh_settings, { "GenerateParametricShapeFrom2D", "ParametricSpikes", 64, 32, "double" }, [normal_method](int v, int r, auto&... output)
+	{
+		return GenerateParametricShapeFrom2D(output..., ParametricSpikes, v, r, normal_method);
+	});
 
-	GenerateParametricShapeFrom2Dv2(positions, normals, indices, ParametricSpikes, 1024, 1024);
-	VAO parametric_two_VAO(positions, normals, indices);
+	// Float precision is not visible at this resolution, see --benchmark for the deviation
+	MeshCacheKey parametric_two_key = { "GenerateParametricShapeFrom2Dv2", "ParametricSpikes", 1024, 1024, float_precision ? "float" : "double" };
+	auto generate_parametric_two = [float_precision, normal_method](int v, int r, auto&... output)
+	{
+		if (float_precision)
+			return GenerateParametricShapeFrom2Dv2<float>(output..., ParametricSpikes, v, r, normal_method);
+		return GenerateParametricShapeFrom2Dv2<double>(output..., ParametricSpikes, v, r, normal_method);
+	};
+
+	// --gpu-procedural stores only the indices, the vertex shader evaluates the surface, see --validate-gpu
+	ParametricLod parametric_two_lod;
+	if (gpu_procedural)
+	{
+		ProceduralMesh parametric_two_mesh;
+		CreateProceduralMesh(parametric_two_mesh, ProceduralSurface::Surfacev2, ParametricSpikes, parametric_two_key.vertical_segments, parametric_two_key.rotation_segments);
+		parametric_two_lod = CreateProceduralLod(mesh_settings, parametric_two_mesh, generate_parametric_two);
+
+		size_t vertices = 0;
+		for (auto& level : parametric_two_lod.levels)
+			vertices += size_t(level.vertical_segments) * level.rotation_segments;
+		std::cout << "GPU procedural surface: " << vertices << " vertices built in the vertex shader, "
+			<< vertices * mesh_settings.vertex_format.VertexSize() / 1024 << " KB of vertex data not stored" << std::endl;
+	}
+	else
+		parametric_two_lod = CreateParametricLod(mesh_settings, parametric_two_key, generate_parametric_two);
+
+	// One grid and one element array for three shapes, blended on the GPU
+	MorphVAO shape_morph = CreateMorphVAO(mesh_settings, 64, 64, {
+		[normal_method](int v, int r, MeshSpan& span) { return GenerateParametricShapeFrom2D(span, ParametricHalfCircle, v, r, normal_method); },
+		[normal_method](int v, int r, MeshSpan& span) { return GenerateParametricShapeFrom2D(span, ParametricCircle, v, r, normal_method); },
+		[normal_method](int v, int r, MeshSpan& span) { return GenerateParametricShapeFrom2D(span, ParametricSpikes, v, r, normal_method); }
+	});
+
+	auto generation_time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - generation_start);
+	std::cout << "Meshes created in " << generation_time.count() << " ms using " << GetMeshGenerationThreadCount() << " thread(s)" << std::endl;
+	if (mesh_settings.shared_topology)
+	{
+		auto topology = GetTopologyStatistics();
+		std::cout << "Shared topology: " << topology.attached_vaos << " VAO(s) attached to " << topology.element_buffers
+			<< " element buffer(s), " << topology.bytes_saved / 1024 << " KB saved" << std::endl;
+	}
 
 	/* Creating Programs and Shaders */
-	const GLchar* vertex_shader_scene_ottffs = R"VERTEX(
+	// With u_procedural the vertex comes from gl_VertexID instead of the attributes, see procedural_surface.h
+	const std::string vertex_shader_scene_source = std::string(R"VERTEX(
 		#version 330 core
-
+		)VERTEX") + procedural_surface_shader + R"VERTEX(
 		layout(location = 0) in vec3 a_position;
 		layout(location = 1) in vec3 a_normal;
 
 		uniform mat4 u_transform;
+		uniform bool u_procedural;
 
 		out vec3 vertex_position;
 		out vec3 vertex_normal;
 
 		void main()
 		{
-			gl_Position = u_transform * vec4(a_position, 1);
-			vertex_normal = (u_transform * vec4(a_normal, 0)).xyz;
+			vec3 position = a_position;
+			vec3 normal = a_normal;
+			if (u_procedural)
+				ProceduralVertex(gl_VertexID, position, normal);
+
+			gl_Position = u_transform * vec4(position, 1);
+			vertex_normal = (u_transform * vec4(normal, 0)).xyz;
 			vertex_position = gl_Position.xyz;
 		}
 		)VERTEX";
+	const GLchar* vertex_shader_scene_ottffs = vertex_shader_scene_source.c_str();
 
 	/*********************************************************************************************************************************/
 
@@ -666,9 +1313,73 @@ int main(int argc, char* argv[])
 		return -1;
 	}
 
-	// u_mouse_position and u_transform
+	/*********************************************************************************************************************************/
+
+	// Blends the targets of a MorphVAO, see DrawMorphVAO
+	const GLchar* vertex_shader_morph = R"VERTEX(
+		#version 330 core
+
+		layout(location = 0) in vec3 a_position;
+		layout(location = 1) in vec3 a_normal;
+		layout(location = 2) in vec3 a_position_1;
+		layout(location = 3) in vec3 a_normal_1;
+		layout(location = 4) in vec3 a_position_2;
+		layout(location = 5) in vec3 a_normal_2;
+		layout(location = 6) in vec3 a_position_3;
+		layout(location = 7) in vec3 a_normal_3;
+
+		uniform mat4 u_transform;
+		uniform vec4 u_morph_weights;
+		uniform vec4 u_morph_dequantization[4];
+
+		out vec3 vertex_position;
+		out vec3 vertex_normal;
+
+		vec3 Dequantize(vec3 position, int target)
+		{
+			return u_morph_dequantization[target].xyz + position * u_morph_dequantization[target].w;
+		}
+
+		void main()
+		{
+			vec3 position = u_morph_weights.x * Dequantize(a_position, 0) + u_morph_weights.y * Dequantize(a_position_1, 1)
+				+ u_morph_weights.z * Dequantize(a_position_2, 2) + u_morph_weights.w * Dequantize(a_position_3, 3);
+			vec3 normal = u_morph_weights.x * a_normal + u_morph_weights.y * a_normal_1
+				+ u_morph_weights.z * a_normal_2 + u_morph_weights.w * a_normal_3;
+
+			gl_Position = u_transform * vec4(position, 1);
+			vertex_normal = (u_transform * vec4(normal, 0)).xyz;
+			vertex_position = gl_Position.xyz;
+		}
+		)VERTEX";
+
+	GLuint scene_seven = CreateProgramFromSources(vertex_shader_morph, fragment_shader_gray);
+	if (scene_seven == NULL)
+	{
+		glfwTerminate();
+		return -1;
+	}
+	auto morph_weights_location = glGetUniformLocation(scene_seven, "u_morph_weights");
+	auto morph_dequantization_location = glGetUniformLocation(scene_seven, "u_morph_dequantization");
+
+	// Uniform locations of every program the parametric meshes are drawn with
+	auto scene_one_uniforms = GetSceneUniforms(scene_one);
+	auto scene_two_uniforms = GetSceneUniforms(scene_two);
+	auto scene_three_uniforms = GetSceneUniforms(scene_three);
+	auto scene_four_obj1_uniforms = GetSceneUniforms(scene_four_obj1);
+	auto scene_four_obj2_uniforms = GetSceneUniforms(scene_four_obj2);
+	auto scene_four_obj3_uniforms = GetSceneUniforms(scene_four_obj3);
+	auto scene_four_obj4_uniforms = GetSceneUniforms(scene_four_obj4);
+	auto scene_six_uniforms = GetSceneUniforms(scene_six);
+	auto scene_seven_uniforms = GetSceneUniforms(scene_seven);
+
+	// u_mouse_position and the uniforms of the current program
 	auto mouse_location = glGetUniformLocation(scene_four_obj1, "u_mouse_position");
-	auto u_transform_location = glGetUniformLocation(scene_one, "u_transform");
+	auto scene_uniforms = scene_one_uniforms;
+
+	// The wireframe scenes show the backs through the lines, their meshlets are only culled by the frustum
+	auto scene_culling_options = culling_options;
+	scene_culling_options.back_faces = false;
 
 	// Key Flags
 	bool flag_q = GL_FALSE;
@@ -677,13 +1388,18 @@ int main(int argc, char* argv[])
 	bool flag_r = GL_FALSE;
 	bool flag_t = GL_FALSE;
 	bool flag_y = GL_FALSE;
+	bool flag_u = GL_FALSE;
 	bool flag_init = GL_FALSE;
 
+	LodStatistics lod_statistics;
+	lod_statistics.start_time = glfwGetTime();
+	CullingStatistics culling_statistics;
+
 	/* Loop until the user closes the window */
 	while (!glfwWindowShouldClose(window))
 	{
 		/* Render here */
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 		/* States of the keys*/
 		int state_q = glfwGetKey(window, GLFW_KEY_Q);
@@ -692,9 +1408,10 @@ int main(int argc, char* argv[])
 		int state_r = glfwGetKey(window, GLFW_KEY_R);
 		int state_t = glfwGetKey(window, GLFW_KEY_T);
 		int state_y = glfwGetKey(window, GLFW_KEY_Y);
+		int state_u = glfwGetKey(window, GLFW_KEY_U);
 
 		/* INIT FLAG ONLY TRUE WHEN EVERY OTHER FLAGS ARE FALSE @ the start */
-		if (flag_q == GL_FALSE && flag_w == GL_FALSE && flag_e == GL_FALSE && flag_r == GL_FALSE && flag_t == GL_FALSE && flag_y == GL_FALSE)
+		if (flag_q == GL_FALSE && flag_w == GL_FALSE && flag_e == GL_FALSE && flag_r == GL_FALSE && flag_t == GL_FALSE && flag_y == GL_FALSE && flag_u == GL_FALSE)
 		{
 			flag_init = GL_TRUE;
 		}
@@ -710,12 +1427,14 @@ int main(int argc, char* argv[])
 			flag_r = GL_FALSE;
 			flag_t = GL_FALSE;
 			flag_y = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode ON
 			glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+			scene_culling_options.back_faces = false;
 
-			u_transform_location = glGetUniformLocation(scene_one, "u_transform");
+			scene_uniforms = scene_one_uniforms;
 			glUseProgram(scene_one);
 		}
 
@@ -730,12 +1449,14 @@ int main(int argc, char* argv[])
 			flag_r = GL_FALSE;
 			flag_t = GL_FALSE;
 			flag_y = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode OFF
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
 
-			u_transform_location = glGetUniformLocation(scene_two, "u_transform");
+			scene_uniforms = scene_two_uniforms;
 			glUseProgram(scene_two);
 		}
 
@@ -750,12 +1471,14 @@ int main(int argc, char* argv[])
 			flag_r = GL_FALSE;
 			flag_t = GL_FALSE;
 			flag_y = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode OFF
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
 
-			u_transform_location = glGetUniformLocation(scene_three, "u_transform");
+			scene_uniforms = scene_three_uniforms;
 			glUseProgram(scene_three);
 		}
 
@@ -770,10 +1493,12 @@ int main(int argc, char* argv[])
 			flag_q = GL_FALSE;
 			flag_t = GL_FALSE;
 			flag_y = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode OFF
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
 		}
 
 		/****** Scene Five ******/
@@ -787,10 +1512,12 @@ int main(int argc, char* argv[])
 			flag_r = GL_FALSE;
 			flag_y = GL_FALSE;
 			flag_q = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode OFF
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
 		}
 
 		/****** Scene Six ******/
@@ -804,16 +1531,41 @@ int main(int argc, char* argv[])
 			flag_r = GL_FALSE;
 			flag_t = GL_FALSE;
 			flag_q = GL_FALSE;
+			flag_u = GL_FALSE;
 			flag_init = GL_FALSE;
 
 			// Wireframe Mode OFF
 			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
 
 			mouse_location = glGetUniformLocation(scene_six, "u_mouse_position");
-			u_transform_location = glGetUniformLocation(scene_six, "u_transform");
+			scene_uniforms = scene_six_uniforms;
 			glUseProgram(scene_six);
 		}
 
+		/****** Scene Seven ******/
+		if (state_u == GLFW_PRESS)
+		{
+			//Flag true
+			flag_u = GL_TRUE;
+			//Flag false
+			flag_w = GL_FALSE;
+			flag_e = GL_FALSE;
+			flag_r = GL_FALSE;
+			flag_t = GL_FALSE;
+			flag_y = GL_FALSE;
+			flag_q = GL_FALSE;
+			flag_init = GL_FALSE;
+
+			// Wireframe Mode OFF
+			glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+			scene_culling_options.back_faces = culling_options.back_faces;
+
+			mouse_location = glGetUniformLocation(scene_seven, "u_mouse_position");
+			scene_uniforms = scene_seven_uniforms;
+			glUseProgram(scene_seven);
+		}
+
 		// Calculate mouse position
 		auto mouse_position = Globals.mouse_position / glm::dvec2(Globals.screen_dimensions);
 		mouse_position.y = 1. - mouse_position.y;
@@ -827,44 +1579,28 @@ int main(int argc, char* argv[])
 			glm::mat4 transform;
 
 			// Draw Sphere
-			glBindVertexArray(sphereVAO.id);
-
 			transform = glm::translate(glm::vec3(-0.5, 0.5, 0));
 			transform = glm::scale(transform, glm::vec3(0.45f));
 			transform = glm::rotate(transform, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform));
-
-			glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(sphere_lod, transform, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
 			// Draw Torus
-			glBindVertexArray(torusVAO.id);
-
 			transform = glm::translate(glm::vec3(0.5, 0.5, 0));
 			transform = glm::scale(transform, glm::vec3(0.45f));
 			transform = glm::rotate(transform, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform));
-
-			glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(torus_lod, transform, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
 			// Draw Parametric One
-			glBindVertexArray(parametric_one_VAO.id);
-
 			transform = glm::translate(glm::vec3(-0.5, -0.5, 0));
 			transform = glm::scale(transform, glm::vec3(0.45f));
 			transform = glm::rotate(transform, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform));
-
-			glDrawElements(GL_TRIANGLES, parametric_one_VAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(parametric_one_lod, transform, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
 			// Draw Parametric Two
-			glBindVertexArray(parametric_two_VAO.id);
-
 			transform = glm::translate(glm::vec3(0.5, -0.5, 0));
 			transform = glm::scale(transform, glm::vec3(0.45f));
 			transform = glm::rotate(transform, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform));
-
-			glDrawElements(GL_TRIANGLES, parametric_two_VAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(parametric_two_lod, transform, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 		}
 
 		/****** Render Scene Four with 4 Meshes ******/
@@ -875,62 +1611,49 @@ int main(int argc, char* argv[])
 			glm::mat4 transform_v4;
 
 			mouse_location = glGetUniformLocation(scene_four_obj1, "u_mouse_position");
-			u_transform_location = glGetUniformLocation(scene_four_obj1, "u_transform");
+			scene_uniforms = scene_four_obj1_uniforms;
 			glUseProgram(scene_four_obj1);
 
 			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
 
 			// Draw Sphere
-			glBindVertexArray(sphereVAO.id);
-
 			transform_v4 = glm::translate(glm::vec3(-0.5, 0.5, 0));
 			transform_v4 = glm::scale(transform_v4, glm::vec3(0.45f));
 			transform_v4 = glm::rotate(transform_v4, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v4));
-
-			glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(sphere_lod, transform_v4, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
+			scene_uniforms = scene_four_obj2_uniforms;
 			glUseProgram(scene_four_obj2);
 
 			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
 
 			// Draw Torus
-			glBindVertexArray(torusVAO.id);
-
 			transform_v4 = glm::translate(glm::vec3(0.5, 0.5, 0));
 			transform_v4 = glm::scale(transform_v4, glm::vec3(0.45f));
 			transform_v4 = glm::rotate(transform_v4, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v4));
-
-			glDrawElements(GL_TRIANGLES, torusVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(torus_lod, transform_v4, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
+			scene_uniforms = scene_four_obj3_uniforms;
 			glUseProgram(scene_four_obj3);
 
 			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
 
 			// Draw Parametric One
-			glBindVertexArray(parametric_one_VAO.id);
-
 			transform_v4 = glm::translate(glm::vec3(-0.5, -0.5, 0));
 			transform_v4 = glm::scale(transform_v4, glm::vec3(0.45f));
 			transform_v4 = glm::rotate(transform_v4, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v4));
-
-			glDrawElements(GL_TRIANGLES, parametric_one_VAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(parametric_one_lod, transform_v4, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
+			scene_uniforms = scene_four_obj4_uniforms;
 			glUseProgram(scene_four_obj4);
 
 			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
 
 			// Draw Parametric Two
-			glBindVertexArray(parametric_two_VAO.id);
-
 			transform_v4 = glm::translate(glm::vec3(0.5, -0.5, 0));
 			transform_v4 = glm::scale(transform_v4, glm::vec3(0.45f));
 			transform_v4 = glm::rotate(transform_v4, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v4));
-
-			glDrawElements(GL_TRIANGLES, parametric_two_VAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(parametric_two_lod, transform_v4, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 		}
 
 		/****** Render Scene Five The Game ******/
@@ -948,37 +1671,29 @@ int main(int argc, char* argv[])
 
 			if (distance_bet >= 0.3 * 2)
 			{
-				u_transform_location = glGetUniformLocation(scene_four_obj3, "u_transform");
+				scene_uniforms = scene_four_obj3_uniforms;
 				glUseProgram(scene_four_obj3);
 			}
 			else
 			{
-				u_transform_location = glGetUniformLocation(scene_four_obj2, "u_transform");
+				scene_uniforms = scene_four_obj2_uniforms;
 				glUseProgram(scene_four_obj2);
 			}
 
 			//::cout << chasing_pos.g << std::endl;
 
 			// Draw Sphere 1
-			glBindVertexArray(sphereVAO.id);
-
 			transform_v3 = glm::translate(glm::vec3(mouse_position,1));
 			transform_v3 = glm::scale(transform_v3, glm::vec3(0.3f));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v3));
-
-			glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(sphere_lod, transform_v3, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 
 			// Draw Sphere 2
-			u_transform_location = glGetUniformLocation(scene_four_obj1, "u_transform");
+			scene_uniforms = scene_four_obj1_uniforms;
 			glUseProgram(scene_four_obj1);
 
-			glBindVertexArray(sphereVAO.id);
-
 			transform_v3 = glm::translate(glm::vec3(chasing_pos, 1));
 			transform_v3 = glm::scale(transform_v3, glm::vec3(0.3f));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v3));
-
-			glDrawElements(GL_TRIANGLES, sphereVAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			DrawParametricLod(sphere_lod, transform_v3, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
 		}
 
 		/****** Render Scene Six Impress ******/
@@ -992,15 +1707,58 @@ int main(int argc, char* argv[])
 			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
 
 			// Draw Parametric Two
-			glBindVertexArray(parametric_two_VAO.id);
-
 			transform_v2 = glm::translate(glm::vec3(0, 0, 0));
 			transform_v2 = glm::rotate(transform_v2, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
-			glUniformMatrix4fv(u_transform_location, 1, GL_FALSE, glm::value_ptr(transform_v2));
+			DrawParametricLod(parametric_two_lod, transform_v2, scene_uniforms, lod_selection, lod_statistics, scene_culling_options, culling_statistics);
+		}
+
+		/****** Render Scene Seven Morph ******/
+		if (flag_u == GL_TRUE)
+		{
+			glClearColor(0, 0, 0, 1);
 
-			glDrawElements(GL_TRIANGLES, parametric_two_VAO.element_array_count, GL_UNSIGNED_INT, NULL);
+			glm::mat4 transform_v7;
+
+			glUniform2fv(mouse_location, 1, glm::value_ptr(glm::vec2(mouse_position)));
+
+			// Draw the sphere, torus and spikes blended, every shape holds for two seconds
+			transform_v7 = glm::scale(glm::vec3(0.8f));
+			transform_v7 = glm::rotate(transform_v7, glm::radians(float(glfwGetTime() * 10)), glm::vec3(1, 1, 0));
+			if (!CullDraw(transform_v7, shape_morph.vao.bounds, scene_culling_options, culling_statistics))
+			{
+				glUniformMatrix4fv(scene_uniforms.transform, 1, GL_FALSE, glm::value_ptr(transform_v7));
+				DrawMorphVAO(shape_morph, MorphCycleWeights(glfwGetTime(), shape_morph.target_count, 4), morph_weights_location, morph_dequantization_location);
+			}
+		}
+
+		/* Print the level of detail, culling and overdraw statistics every few seconds */
+		++lod_statistics.frames;
+		if (glfwGetTime() - lod_statistics.start_time >= 5)
+		{
+			std::cout << "Level of detail: " << lod_statistics.triangles_drawn / lod_statistics.frames << " triangles drawn per frame, "
+				<< lod_statistics.triangles_full_detail / lod_statistics.frames << " at full detail" << std::endl;
+			std::cout << "Frustum culling: " << double(culling_statistics.culled_draws) / lod_statistics.frames << " of "
+				<< double(culling_statistics.draws) / lod_statistics.frames << " draws culled per frame" << std::endl;
+			if (culling_statistics.cluster_triangles > 0)
+			{
+				auto triangles = double(culling_statistics.cluster_triangles);
+				std::cout << "Cluster culling: " << 100 * (culling_statistics.triangles_outside + culling_statistics.triangles_back_facing) / triangles
+					<< "% of the meshlet triangles rejected, " << 100 * culling_statistics.triangles_back_facing / triangles << "% back-facing, "
+					<< 100 * culling_statistics.triangles_outside / triangles << "% outside the frustum" << std::endl;
+			}
+			if (measure_overdraw)
+			{
+				glm::ivec2 framebuffer_size;
+				glfwGetFramebufferSize(window, &framebuffer_size.x, &framebuffer_size.y);
+				auto overdraw = ReadOverdrawMeasurement(framebuffer_size);
+				std::cout << "Overdraw: " << overdraw.overdraw << " shaded fragments per pixel over " << overdraw.covered_pixels
+					<< " covered pixels" << std::endl;
+			}
+			lod_statistics = LodStatistics();
+			lod_statistics.start_time = glfwGetTime();
+			culling_statistics = CullingStatistics();
 		}
-		
+
 		/* Swap front and back buffers */
 		glfwSwapBuffers(window);
 
@@ -1008,6 +1766,13 @@ int main(int argc, char* argv[])
 		glfwPollEvents();
 	}
 
+	// The shapes hold the shared element buffers, the registry deletes them once none does, before the context goes
+	sphere_lod = ParametricLod();
+	torus_lod = ParametricLod();
+	parametric_one_lod = ParametricLod();
+	parametric_two_lod = ParametricLod();
+	ReleaseUnusedTopologies();
+
 	glfwTerminate();
 	return 0;
 }
\ No newline at end of file
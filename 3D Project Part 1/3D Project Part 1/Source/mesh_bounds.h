@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "GLM/glm.hpp"
+
+/* Mesh Bounds */
+// Axis aligned box and bounding sphere of the generated positions, in object space. The sphere is grown point by point
+// along with the box, in the same pass, so it is not the smallest one, but mostly well inside the sphere around the
+// box. Empty bounds have a negative radius.
+struct MeshBounds
+{
+	glm::dvec3 min;
+	glm::dvec3 max;
+
+	glm::dvec3 center;
+	double radius;
+};
+
+inline MeshBounds EmptyBounds()
+{
+	auto infinity = std::numeric_limits<double>::infinity();
+	return MeshBounds{ glm::dvec3(infinity), glm::dvec3(-infinity), glm::dvec3(0), -1 };
+}
+
+inline bool IsEmpty(const MeshBounds& bounds)
+{
+	return bounds.radius < 0;
+}
+
+// Moves the sphere towards a point outside of it just far enough to touch it, as in Ritter's bounding sphere
+inline void ExtendBounds(MeshBounds& bounds, const glm::dvec3& point)
+{
+	bounds.min = glm::min(bounds.min, point);
+	bounds.max = glm::max(bounds.max, point);
+
+	if (IsEmpty(bounds))
+	{
+		bounds.center = point;
+		bounds.radius = 0;
+		return;
+	}
+
+	auto distance = glm::distance(bounds.center, point);
+	if (distance <= bounds.radius)
+		return;
+
+	auto radius = (bounds.radius + distance) / 2;
+	bounds.center += (point - bounds.center) * ((radius - bounds.radius) / distance);
+	bounds.radius = radius;
+}
+
+inline void ExtendBounds(MeshBounds& bounds, const MeshBounds& part)
+{
+	if (IsEmpty(part))
+		return;
+	if (IsEmpty(bounds))
+	{
+		bounds = part;
+		return;
+	}
+
+	bounds.min = glm::min(bounds.min, part.min);
+	bounds.max = glm::max(bounds.max, part.max);
+
+	// The smallest sphere around both spheres, unless one already holds the other
+	auto distance = glm::distance(bounds.center, part.center);
+	if (distance + part.radius <= bounds.radius)
+		return;
+	if (distance + bounds.radius <= part.radius)
+	{
+		bounds.center = part.center;
+		bounds.radius = part.radius;
+		return;
+	}
+
+	auto radius = (distance + bounds.radius + part.radius) / 2;
+	bounds.center += (part.center - bounds.center) * ((radius - bounds.radius) / distance);
+	bounds.radius = radius;
+}
+
+// The sphere is centered in the merged box. Every part is inside the sphere through the corner of its box furthest
+// from the center, and inside the one around its own sphere, the smaller of the two counts.
+inline MeshBounds MergeBounds(const std::vector<MeshBounds>& bounds)
+{
+	auto merged = EmptyBounds();
+	for (auto& part : bounds)
+	{
+		if (IsEmpty(part))
+			continue;
+		merged.min = glm::min(merged.min, part.min);
+		merged.max = glm::max(merged.max, part.max);
+		merged.radius = 0;
+	}
+	if (IsEmpty(merged))
+		return merged;
+
+	merged.center = (merged.min + merged.max) / 2.;
+	for (auto& part : bounds)
+	{
+		if (IsEmpty(part))
+			continue;
+		auto furthest_corner = glm::max(glm::abs(part.min - merged.center), glm::abs(part.max - merged.center));
+		auto radius = std::min(glm::length(furthest_corner), glm::distance(merged.center, part.center) + part.radius);
+		merged.radius = std::max(merged.radius, radius);
+	}
+	return merged;
+}
+
+/* Cluster Bounds */
+// Bounding sphere and normal cone of a cluster of triangles, see mesh_clusters.h. The front of every triangle faces
+// within the cone around cone_axis and cone_cutoff is the sine of its half angle, or 1 when the cone is too wide
+// for any view to see only the backs.
+struct ClusterBounds
+{
+	glm::vec3 center;
+	float radius;
+	glm::vec3 cone_axis;
+	float cone_cutoff;
+};
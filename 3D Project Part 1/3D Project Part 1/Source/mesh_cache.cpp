@@ -0,0 +1,446 @@
+#include "mesh_cache.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "topology_registry.h"
+
+/* Mesh Cache Format */
+static const char mesh_cache_directory[] = "mesh_cache";
+static const char mesh_cache_magic[8] = { 'P', 'M', 'E', 'S', 'H', 'C', 'A', 0 };
+static const std::uint32_t mesh_cache_version = 6;
+
+// Sections start at multiples of this, so the mapped data is aligned for any vertex or index type and cache line
+static const std::uint64_t mesh_cache_alignment = 64;
+
+struct MeshCacheSection
+{
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+struct MeshCacheHeader
+{
+	char magic[8];
+	std::uint32_t version;
+
+	std::uint32_t vertex_count;
+	std::uint32_t element_array_count;
+	std::uint32_t position_format;
+	std::uint32_t normal_format;
+	std::uint32_t interleaved;
+	std::uint32_t primitive;
+	std::uint32_t index_type;
+	std::uint32_t poles;		// Bit 0 for the first column, bit 1 for the last
+	float dequantization[16];
+	double bounds[10];			// Box min and max, sphere center and radius, radius -1 when empty
+
+	MeshCacheSection key;
+	MeshCacheSection positions;
+	MeshCacheSection normals;
+	MeshCacheSection indices;
+	MeshCacheSection ranges;
+	MeshCacheSection clusters;	// One ClusterBounds per range for meshlets, empty otherwise
+
+	// Of the whole file, with this field zeroed
+	std::uint64_t checksum;
+};
+
+// DrawRange with fixed size fields
+struct MeshCacheRange
+{
+	std::uint64_t first_index;
+	std::int32_t index_count;
+	std::int32_t base_vertex;
+};
+
+// ClusterBounds as floats, center, radius, cone axis and cutoff
+struct MeshCacheCluster
+{
+	float values[8];
+};
+
+static std::uint64_t AlignCacheOffset(std::uint64_t offset)
+{
+	return (offset + mesh_cache_alignment - 1) / mesh_cache_alignment * mesh_cache_alignment;
+}
+
+static const std::uint64_t fnv_offset_basis = 0xCBF29CE484222325ull;
+static const std::uint64_t fnv_prime = 0x100000001B3ull;
+
+static std::uint64_t HashText(const std::string& text)
+{
+	auto hash = fnv_offset_basis;
+	for (auto c : text)
+		hash = (hash ^ std::uint8_t(c)) * fnv_prime;
+	return hash;
+}
+
+// FNV-1a over 8 byte words in four independent lanes, a byte at a time the checksum took longer than the upload.
+// seed continues the checksum of the data before.
+static std::uint64_t MeshCacheChecksum(const char* data, size_t size, std::uint64_t seed = fnv_offset_basis)
+{
+	std::uint64_t lanes[4] = { seed, seed + 1, seed + 2, seed + 3 };
+
+	size_t offset = 0;
+	for (; offset + sizeof(lanes) <= size; offset += sizeof(lanes))
+	{
+		std::uint64_t words[4];
+		std::memcpy(words, data + offset, sizeof(words));
+		for (int lane = 0; lane < 4; ++lane)
+			lanes[lane] = (lanes[lane] ^ words[lane]) * fnv_prime;
+	}
+	for (; offset < size; ++offset)
+		lanes[0] = (lanes[0] ^ std::uint8_t(data[offset])) * fnv_prime;
+
+	auto checksum = (fnv_offset_basis ^ size) * fnv_prime;
+	for (auto lane : lanes)
+		checksum = (checksum ^ lane) * fnv_prime;
+	return checksum;
+}
+
+// Of the header with its checksum field zeroed and then of the sections, data is the whole file
+static std::uint64_t MeshCacheFileChecksum(const char* data, size_t size, size_t header_end)
+{
+	std::vector<char> header(data, data + header_end);
+	std::memset(&header[offsetof(MeshCacheHeader, checksum)], 0, sizeof(MeshCacheHeader::checksum));
+	return MeshCacheChecksum(data + header_end, size - header_end, MeshCacheChecksum(header.data(), header.size()));
+}
+
+/* Mesh Cache Keys */
+std::string MeshCacheKey::Text() const
+{
+	std::ostringstream text;
+	text << generator << " " << function << " " << vertical_segments << "x" << rotation_segments << " " << options
+		<< " position " << int(format.position) << " normal " << int(format.normal) << (format.interleaved ? " interleaved" : "")
+		<< (index_options.strips ? " strips" : " triangles") << (index_options.short_indices ? " short" : "")
+		<< (index_options.pole_fans ? " pole_fans" : "");
+	return text.str();
+}
+
+std::string MeshCachePath(const MeshCacheKey& key)
+{
+	char hash[17];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(HashText(key.Text())));
+
+	std::ostringstream path;
+	path << mesh_cache_directory << "/" << key.function << "_" << key.vertical_segments << "x" << key.rotation_segments << "_" << hash << ".mesh";
+	return path.str();
+}
+
+/* Mapped Files */
+// Read-only mapping of a whole file, data is NULL when the file is missing or cannot be mapped
+struct MappedFile
+{
+	const char* data = NULL;
+	size_t size = 0;
+
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+
+	explicit MappedFile(const std::string& path)
+	{
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+			return;
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL)
+			return;
+
+		data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (data != NULL)
+			size = size_t(file_size.QuadPart);
+	}
+
+	~MappedFile()
+	{
+		if (data != NULL)
+			UnmapViewOfFile(data);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+#else
+	explicit MappedFile(const std::string& path)
+	{
+		auto file = open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return;
+
+		// The mapping stays valid after the descriptor is closed
+		struct stat file_status;
+		if (fstat(file, &file_status) == 0 && file_status.st_size > 0)
+		{
+			auto mapped = mmap(NULL, size_t(file_status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+			if (mapped != MAP_FAILED)
+			{
+				madvise(mapped, size_t(file_status.st_size), MADV_SEQUENTIAL);
+				data = static_cast<const char*>(mapped);
+				size = size_t(file_status.st_size);
+			}
+		}
+		close(file);
+	}
+
+	~MappedFile()
+	{
+		if (data != NULL)
+			munmap(const_cast<char*>(data), size);
+	}
+#endif
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
+
+static bool CreateCacheDirectory()
+{
+#ifdef _WIN32
+	return _mkdir(mesh_cache_directory) == 0 || errno == EEXIST;
+#else
+	return mkdir(mesh_cache_directory, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+/* Mesh Cache Files */
+static bool SectionInFile(const MeshCacheSection& section, size_t file_size)
+{
+	return section.offset % mesh_cache_alignment == 0 && section.offset <= file_size && section.size <= file_size - section.offset;
+}
+
+std::unique_ptr<VAO> LoadMeshCache(const MeshCacheKey& key, GridPoles& poles, bool shared_topology)
+{
+	auto path = MeshCachePath(key);
+	auto header_end = AlignCacheOffset(sizeof(MeshCacheHeader));
+	MappedFile file(path);
+	if (file.data == NULL || file.size < header_end)
+		return NULL;
+
+	MeshCacheHeader header;
+	std::memcpy(&header, file.data, sizeof(header));
+	if (std::memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) != 0 || header.version != mesh_cache_version)
+		return NULL;
+
+	for (auto section : { header.key, header.positions, header.normals, header.indices, header.ranges, header.clusters })
+		if (!SectionInFile(section, file.size))
+		{
+			std::cout << "Error: Mesh cache " << path << " is truncated, the mesh is generated again" << std::endl;
+			return NULL;
+		}
+
+	// A file of another key with the same hash is a miss, not an error
+	auto key_text = key.Text();
+	if (header.key.size != key_text.size() || std::memcmp(file.data + header.key.offset, key_text.data(), key_text.size()) != 0)
+		return NULL;
+
+	if (MeshCacheFileChecksum(file.data, file.size, size_t(header_end)) != header.checksum)
+	{
+		std::cout << "Error: Mesh cache " << path << " failed its checksum, the mesh is generated again" << std::endl;
+		return NULL;
+	}
+
+	poles.first = (header.poles & 1) != 0;
+	poles.last = (header.poles & 2) != 0;
+
+	IndexFormat index_format;
+	index_format.primitive = GLenum(header.primitive);
+	index_format.type = GLenum(header.index_type);
+	auto ranges = reinterpret_cast<const MeshCacheRange*>(file.data + header.ranges.offset);
+	for (size_t i = 0; i < header.ranges.size / sizeof(MeshCacheRange); ++i)
+		index_format.ranges.push_back(DrawRange{ size_t(ranges[i].first_index), ranges[i].index_count, ranges[i].base_vertex });
+
+	auto& format = key.format;
+	auto vertex_count = GLsizei(header.vertex_count);
+	auto element_array_count = GLsizei(header.element_array_count);
+	if (header.positions.size != size_t(vertex_count) * (format.interleaved ? format.VertexSize() : format.PositionSize())
+		|| header.normals.size != (format.interleaved ? 0 : size_t(vertex_count) * format.NormalSize())
+		|| header.indices.size != size_t(element_array_count) * index_format.IndexSize()
+		|| (header.clusters.size != 0 && header.clusters.size != index_format.ranges.size() * sizeof(MeshCacheCluster)))
+	{
+		std::cout << "Error: Mesh cache " << path << " does not match its vertex format, the mesh is generated again" << std::endl;
+		return NULL;
+	}
+
+	// The grid of the key with the poles of the file has the cached indices, another VAO may have registered them already
+	auto plan = PlanGridMesh(key.vertical_segments, key.rotation_segments, key.index_options);
+	SetGridPoles(plan, poles);
+	auto topology = GridTopologyKey(plan);
+	shared_topology &= topology.primitive == index_format.primitive && topology.type == index_format.type
+		&& topology.element_array_count == element_array_count;
+	auto attach = shared_topology && HasSharedTopology(topology);
+
+	std::unique_ptr<VAO> vao(new VAO(vertex_count, element_array_count, format, index_format, !attach));
+	if (attach)
+		AttachSharedTopology(*vao, topology);
+	std::memcpy(&vao->dequantization[0][0], header.dequantization, sizeof(header.dequantization));
+	vao->bounds.min = glm::dvec3(header.bounds[0], header.bounds[1], header.bounds[2]);
+	vao->bounds.max = glm::dvec3(header.bounds[3], header.bounds[4], header.bounds[5]);
+	vao->bounds.center = glm::dvec3(header.bounds[6], header.bounds[7], header.bounds[8]);
+	vao->bounds.radius = header.bounds[9];
+
+	auto clusters = reinterpret_cast<const MeshCacheCluster*>(file.data + header.clusters.offset);
+	for (size_t i = 0; i < header.clusters.size / sizeof(MeshCacheCluster); ++i)
+	{
+		auto& values = clusters[i].values;
+		vao->clusters.push_back(ClusterBounds{ glm::vec3(values[0], values[1], values[2]), values[3],
+			glm::vec3(values[4], values[5], values[6]), values[7] });
+	}
+
+	// Interleaved normals live in the position section, the mapped normal pointer is inside the position buffer
+	void* positions;
+	void* normals;
+	void* indices;
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		if (!vao->MapBuffers(positions, normals, indices))
+			break;
+
+		std::memcpy(positions, file.data + header.positions.offset, size_t(header.positions.size));
+		if (!format.interleaved)
+			std::memcpy(normals, file.data + header.normals.offset, size_t(header.normals.size));
+		if (indices != NULL)
+			std::memcpy(indices, file.data + header.indices.offset, size_t(header.indices.size));
+
+		if (vao->UnmapBuffers())
+		{
+			if (shared_topology && !attach)
+				RegisterSharedTopology(*vao, topology);
+			return vao;
+		}
+	}
+
+	std::cout << "Error: Uploading mesh cache " << path << " failed, the mesh is generated again" << std::endl;
+	glDeleteBuffers(1, &vao->position_buffer);
+	if (!format.interleaved)
+		glDeleteBuffers(1, &vao->normals_buffer);
+	if (!attach)
+		glDeleteBuffers(1, &vao->element_array_buffer);
+	glDeleteVertexArrays(1, &vao->id);
+	return NULL;
+}
+
+bool SaveMeshCache(const MeshCacheKey& key, const VAO& vao, const GridPoles& poles)
+{
+	auto& format = vao.format;
+	auto& index_format = vao.index_format;
+	auto key_text = key.Text();
+
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+	header.version = mesh_cache_version;
+	header.vertex_count = std::uint32_t(vao.vertex_count);
+	header.element_array_count = std::uint32_t(vao.element_array_count);
+	header.position_format = std::uint32_t(format.position);
+	header.normal_format = std::uint32_t(format.normal);
+	header.interleaved = format.interleaved ? 1 : 0;
+	header.primitive = std::uint32_t(index_format.primitive);
+	header.index_type = std::uint32_t(index_format.type);
+	header.poles = (poles.first ? 1 : 0) | (poles.last ? 2 : 0);
+	std::memcpy(header.dequantization, &vao.dequantization[0][0], sizeof(header.dequantization));
+	auto& bounds = vao.bounds;
+	double bounds_values[10] = { bounds.min.x, bounds.min.y, bounds.min.z, bounds.max.x, bounds.max.y, bounds.max.z,
+		bounds.center.x, bounds.center.y, bounds.center.z, bounds.radius };
+	std::memcpy(header.bounds, bounds_values, sizeof(header.bounds));
+
+	// Lay the sections out one after the other, each at the next aligned offset
+	auto offset = AlignCacheOffset(sizeof(MeshCacheHeader));
+	auto place = [&offset](MeshCacheSection& section, std::uint64_t size)
+	{
+		section.offset = offset;
+		section.size = size;
+		offset = AlignCacheOffset(offset + size);
+	};
+	place(header.key, key_text.size());
+	place(header.positions, std::uint64_t(vao.vertex_count) * (format.interleaved ? format.VertexSize() : format.PositionSize()));
+	place(header.normals, format.interleaved ? 0 : std::uint64_t(vao.vertex_count) * format.NormalSize());
+	place(header.indices, std::uint64_t(vao.element_array_count) * index_format.IndexSize());
+	place(header.ranges, index_format.ranges.size() * sizeof(MeshCacheRange));
+	place(header.clusters, vao.clusters.size() * sizeof(MeshCacheCluster));
+
+	std::vector<char> contents(size_t(offset), 0);
+	std::memcpy(&contents[size_t(header.key.offset)], key_text.data(), key_text.size());
+
+	// The element array buffer binding belongs to the VAO, bind it first to read the right buffer
+	glBindVertexArray(vao.id);
+	glBindBuffer(GL_ARRAY_BUFFER, vao.position_buffer);
+	glGetBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(header.positions.size), &contents[size_t(header.positions.offset)]);
+	if (!format.interleaved)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, vao.normals_buffer);
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(header.normals.size), &contents[size_t(header.normals.offset)]);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.element_array_buffer);
+	glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, GLsizeiptr(header.indices.size), &contents[size_t(header.indices.offset)]);
+
+	for (size_t i = 0; i < index_format.ranges.size(); ++i)
+	{
+		auto& range = index_format.ranges[i];
+		MeshCacheRange cache_range = { range.first_index, range.index_count, range.base_vertex };
+		std::memcpy(&contents[size_t(header.ranges.offset) + i * sizeof(MeshCacheRange)], &cache_range, sizeof(cache_range));
+	}
+	for (size_t i = 0; i < vao.clusters.size(); ++i)
+	{
+		auto& cluster = vao.clusters[i];
+		MeshCacheCluster cache_cluster = { { cluster.center.x, cluster.center.y, cluster.center.z, cluster.radius,
+			cluster.cone_axis.x, cluster.cone_axis.y, cluster.cone_axis.z, cluster.cone_cutoff } };
+		std::memcpy(&contents[size_t(header.clusters.offset) + i * sizeof(MeshCacheCluster)], &cache_cluster, sizeof(cache_cluster));
+	}
+
+	std::memcpy(contents.data(), &header, sizeof(header));
+	header.checksum = MeshCacheFileChecksum(contents.data(), contents.size(), size_t(AlignCacheOffset(sizeof(MeshCacheHeader))));
+	std::memcpy(contents.data(), &header, sizeof(header));
+
+	// Written under another name first, so an interrupted run never leaves a half written file behind
+	auto path = MeshCachePath(key);
+	auto temporary_path = path + ".tmp";
+	if (!CreateCacheDirectory())
+	{
+		std::cout << "Error: Could not create the mesh cache directory " << mesh_cache_directory << std::endl;
+		return false;
+	}
+
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		file.write(contents.data(), std::streamsize(contents.size()));
+		if (!file)
+		{
+			std::cout << "Error: Could not write the mesh cache " << temporary_path << std::endl;
+			return false;
+		}
+	}
+
+	// rename does not replace an existing file on Windows
+	std::remove(path.c_str());
+	if (std::rename(temporary_path.c_str(), path.c_str()) != 0)
+	{
+		std::cout << "Error: Could not write the mesh cache " << path << std::endl;
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
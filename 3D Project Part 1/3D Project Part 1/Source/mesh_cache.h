@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/*
+	On-disk cache of the VAO buffers of generated meshes, so later runs upload them without generating.
+	A cache file stores the buffers exactly as the VAO holds them, every section starts 64 byte aligned:
+
+		MeshCacheHeader		version, counts, formats, poles, dequantization, bounds, section offsets and checksum
+		key					the MeshCacheKey text, to tell hash collisions apart
+		positions			the whole vertex buffer for interleaved formats
+		normals				empty for interleaved formats
+		indices				element_array_count indices of index_format.type
+		ranges				the base-vertex draw ranges
+		clusters			sphere and normal cone of every range for meshlets, empty otherwise
+
+	Loading memory-maps the file and copies the sections straight into the mapped VAO buffers, the indices are
+	skipped when the VAO attaches to a shared element array of the topology registry.
+	Bump mesh_cache_version in mesh_cache.cpp when a generator change alters its output.
+*/
+
+/* Mesh Cache Keys */
+// Everything that decides the bytes of the buffers. Functions are identified by name, their addresses change
+// between builds. The rows split over the threads give the same mesh for any thread count, --no-simd changes its
+// rounding and simplification splits the mesh into one slab per thread, both go into options.
+struct MeshCacheKey
+{
+	std::string generator;
+	std::string function;
+	int vertical_segments;
+	int rotation_segments;
+
+	// Precision, post-processing passes and anything else the caller varies, as text
+	std::string options;
+
+	VertexFormat format = {};
+	GridIndexOptions index_options = {};
+
+	std::string Text() const;
+};
+
+// mesh_cache/<function>_<vertical_segments>x<rotation_segments>_<hash of the key>.mesh
+std::string MeshCachePath(const MeshCacheKey& key);
+
+/* Mesh Cache Files */
+// Creates the VAO from its cache file, NULL when the file is missing, from another version, for another key
+// or fails its checksum. poles are the pole columns the generator reported when the file was saved.
+// With shared_topology the file holds grid indices, they are taken from the topology registry when an earlier VAO
+// registered them, without copying or allocating, and registered otherwise.
+std::unique_ptr<VAO> LoadMeshCache(const MeshCacheKey& key, GridPoles& poles, bool shared_topology = false);
+
+// Reads the buffers of vao back from the GPU and writes its cache file, the directory is created when needed
+bool SaveMeshCache(const MeshCacheKey& key, const VAO& vao, const GridPoles& poles);
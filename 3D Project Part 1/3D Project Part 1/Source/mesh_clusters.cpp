@@ -0,0 +1,266 @@
+#include "mesh_clusters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "mesh_optimization.h"
+
+/* Meshlets */
+MeshletStatistics BuildMeshlets(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	std::vector<DrawRange>& ranges,
+	std::vector<ClusterBounds>& clusters,
+	const MeshletOptions& options
+)
+{
+	auto vertex_count = positions.size();
+	auto triangle_count = indices.size() / 3;
+	ranges.clear();
+	clusters.clear();
+
+	MeshletStatistics statistics = {};
+	statistics.vertices_before = vertex_count;
+	statistics.triangles = triangle_count;
+
+	// Before the meshlets reorder the vertices, the welding in IsClosedMesh depends on the vertex order
+	statistics.closed = IsClosedMesh(positions, indices);
+
+	// Triangles of every vertex
+	std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+	for (auto index : indices)
+		++adjacency_offsets[index + 1];
+	for (size_t v = 0; v < vertex_count; ++v)
+		adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+	std::vector<size_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	std::vector<GLuint> adjacency(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+		adjacency[adjacency_fill[indices[i]]++] = GLuint(i / 3);
+
+	// The vertices are stored in the order the meshlets first use them, a meshlet shares those of the meshlets before it
+	// as long as they are within 16 bit indices of its base vertex
+	const size_t short_index_range = 0x10000;
+	std::vector<glm::vec3> meshlet_positions;
+	std::vector<glm::vec3> meshlet_normals;
+	std::vector<GLuint> meshlet_indices;
+	meshlet_positions.reserve(vertex_count);
+	meshlet_normals.reserve(vertex_count);
+	meshlet_indices.reserve(indices.size());
+	std::vector<bool> stored(vertex_count, false);
+	std::vector<GLuint> stored_vertex(vertex_count);
+
+	// Candidates are the triangles next to the meshlet, listed by how many of their corners it already has.
+	// A triangle moves to the next list with every corner, the entries it leaves behind are skipped.
+	std::vector<bool> assigned(triangle_count, false);
+	std::vector<std::uint8_t> corners_in_meshlet(triangle_count, 0);
+	std::vector<int> local_vertex(vertex_count, -1);
+	std::vector<GLuint> vertices;
+	std::vector<GLuint> candidates[4];
+	size_t candidate_heads[4];
+	std::vector<GLuint> touched;
+
+	size_t assigned_count = 0;
+	size_t seed = 0;
+	while (assigned_count < triangle_count)
+	{
+		while (assigned[seed])
+			++seed;
+
+		DrawRange range = { meshlet_indices.size(), 0, 0 };
+		vertices.clear();
+		touched.clear();
+		for (int corners = 0; corners < 4; ++corners)
+		{
+			candidates[corners].clear();
+			candidate_heads[corners] = 0;
+		}
+
+		auto AddTriangle = [&](size_t triangle)
+		{
+			assigned[triangle] = true;
+			++assigned_count;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				auto v = indices[triangle * 3 + corner];
+				if (local_vertex[v] < 0)
+				{
+					local_vertex[v] = int(vertices.size());
+					vertices.push_back(v);
+					for (auto i = adjacency_offsets[v]; i < adjacency_offsets[v + 1]; ++i)
+					{
+						auto neighbour = adjacency[i];
+						if (assigned[neighbour])
+							continue;
+						if (corners_in_meshlet[neighbour] == 0)
+							touched.push_back(neighbour);
+						candidates[++corners_in_meshlet[neighbour]].push_back(neighbour);
+					}
+				}
+				meshlet_indices.push_back(v);
+			}
+		};
+
+		AddTriangle(seed);
+		int triangles = 1;
+		while (triangles < options.max_triangles)
+		{
+			// A triangle with c corners in the meshlet adds at most 3 - c vertices
+			long next = -1;
+			for (int corners = 3; corners >= 1 && next < 0; --corners)
+			{
+				if (vertices.size() + (3 - corners) > size_t(options.max_vertices))
+					break;
+
+				auto& list = candidates[corners];
+				while (candidate_heads[corners] < list.size())
+				{
+					auto triangle = list[candidate_heads[corners]++];
+					if (!assigned[triangle] && corners_in_meshlet[triangle] == corners)
+					{
+						next = long(triangle);
+						break;
+					}
+				}
+			}
+			if (next < 0)
+				break;
+
+			AddTriangle(size_t(next));
+			++triangles;
+		}
+
+		// The vertices stored further back than 16 bit indices reach from the end of the meshlet are stored again
+		auto window_end = meshlet_positions.size() + vertices.size();
+		auto window_start = window_end > short_index_range ? window_end - short_index_range : 0;
+		auto base_vertex = GLuint(meshlet_positions.size());
+		for (auto v : vertices)
+		{
+			if (!stored[v] || stored_vertex[v] < window_start)
+			{
+				stored[v] = true;
+				stored_vertex[v] = GLuint(meshlet_positions.size());
+				meshlet_positions.push_back(positions[v]);
+				meshlet_normals.push_back(normals[v]);
+			}
+			base_vertex = std::min(base_vertex, stored_vertex[v]);
+			local_vertex[v] = -1;
+		}
+		for (auto triangle : touched)
+			corners_in_meshlet[triangle] = 0;
+
+		range.index_count = GLsizei(meshlet_indices.size() - range.first_index);
+		range.base_vertex = GLint(base_vertex);
+		for (auto i = range.first_index; i < meshlet_indices.size(); ++i)
+			meshlet_indices[i] = stored_vertex[meshlet_indices[i]] - base_vertex;
+		ranges.push_back(range);
+	}
+
+	positions.swap(meshlet_positions);
+	normals.swap(meshlet_normals);
+	indices.swap(meshlet_indices);
+	for (auto& range : ranges)
+	{
+		clusters.push_back(ComputeClusterBounds(positions, normals, indices, range));
+		if (!statistics.closed)
+			clusters.back().cone_cutoff = 1;
+	}
+
+	statistics.meshlets = ranges.size();
+	statistics.vertices_after = positions.size();
+	return statistics;
+}
+
+bool IsClosedMesh(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices)
+{
+	// Welding with any normal merges every vertex with the ones at its position
+	auto welded_positions = positions;
+	std::vector<glm::vec3> welded_normals(positions.size(), glm::vec3(0, 0, 1));
+	auto welded_indices = indices;
+	WeldTolerance tolerance;
+	tolerance.normal_degrees = 180;
+	WeldVertices(welded_positions, welded_normals, welded_indices, tolerance);
+	RemoveDegenerateTriangles(welded_positions, welded_indices);
+
+	// The edges leaving every vertex, in the order of the triangles
+	auto vertex_count = welded_positions.size();
+	std::vector<size_t> edge_offsets(vertex_count + 1, 0);
+	for (auto index : welded_indices)
+		++edge_offsets[index + 1];
+	for (size_t v = 0; v < vertex_count; ++v)
+		edge_offsets[v + 1] += edge_offsets[v];
+
+	std::vector<size_t> edge_fill(edge_offsets.begin(), edge_offsets.end() - 1);
+	std::vector<GLuint> edge_ends(welded_indices.size());
+	for (size_t i = 0; i < welded_indices.size(); ++i)
+	{
+		auto next = i - i % 3 + (i + 1) % 3;
+		edge_ends[edge_fill[welded_indices[i]]++] = welded_indices[next];
+	}
+
+	auto CountEdges = [&](GLuint from, GLuint to)
+	{
+		return std::count(edge_ends.begin() + edge_offsets[from], edge_ends.begin() + edge_offsets[from + 1], to);
+	};
+
+	// Every edge runs once each way
+	for (GLuint v = 0; v < GLuint(vertex_count); ++v)
+		for (auto i = edge_offsets[v]; i < edge_offsets[v + 1]; ++i)
+			if (CountEdges(v, edge_ends[i]) != 1 || CountEdges(edge_ends[i], v) != 1)
+				return false;
+	return !welded_indices.empty();
+}
+
+ClusterBounds ComputeClusterBounds(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices, const DrawRange& range)
+{
+	auto Vertex = [&](size_t i)
+	{
+		return size_t(range.base_vertex) + indices[range.first_index + i];
+	};
+
+	auto bounds = EmptyBounds();
+	for (GLsizei i = 0; i < range.index_count; ++i)
+		ExtendBounds(bounds, glm::dvec3(positions[Vertex(i)]));
+
+	ClusterBounds cluster;
+	cluster.center = glm::vec3((bounds.min + bounds.max) / 2.);
+	cluster.radius = 0;
+	for (GLsizei i = 0; i < range.index_count; ++i)
+		cluster.radius = std::max(cluster.radius, glm::distance(cluster.center, positions[Vertex(i)]));
+
+	// The winding is not known, the triangle normal is turned to the side of the vertex normals
+	std::vector<glm::dvec3> triangle_normals;
+	glm::dvec3 axis(0);
+	for (GLsizei i = 0; i + 2 < range.index_count; i += 3)
+	{
+		auto a = Vertex(i), b = Vertex(i + 1), c = Vertex(i + 2);
+		auto normal = glm::cross(glm::dvec3(positions[b] - positions[a]), glm::dvec3(positions[c] - positions[a]));
+		auto length = glm::length(normal);
+		if (length == 0)
+			continue;
+
+		normal /= length;
+		if (glm::dot(normal, glm::dvec3(normals[a] + normals[b] + normals[c])) < 0)
+			normal = -normal;
+		triangle_normals.push_back(normal);
+		axis += normal;
+	}
+
+	cluster.cone_axis = glm::vec3(0, 0, 1);
+	cluster.cone_cutoff = 1;
+	if (glm::length(axis) == 0)
+		return cluster;
+
+	axis = glm::normalize(axis);
+	auto min_dot = 1.;
+	for (auto& normal : triangle_normals)
+		min_dot = std::min(min_dot, glm::dot(axis, normal));
+
+	cluster.cone_axis = glm::vec3(axis);
+	if (min_dot > 0)
+		cluster.cone_cutoff = float(std::sqrt(1 - min_dot * min_dot));
+	return cluster;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "mesh_bounds.h"
+#include "vertex_format.h"
+
+/*
+	Meshlets, small clusters of the triangles of a mesh that the renderer culls one by one. Every meshlet is drawn
+	as one base-vertex range with 16 bit indices. The vertices are stored in the order the meshlets first use them
+	and shared between meshlets, only a vertex further back than 16 bit indices reach is stored again. Its bounding
+	sphere skips a meshlet outside the view frustum, its normal cone when it only shows its back to the eye.
+
+	A meshlet grows from the first triangle that is not in one yet, by the adjacent triangle that adds the fewest
+	new vertices, oldest first, which keeps it round. It ends when the vertex or triangle limit is reached or no
+	triangle next to it is left.
+
+	The renderer draws both sides of the triangles, the backs of a cluster are only hidden behind the fronts of
+	the rest of the mesh when the mesh is closed. The clusters of open meshes get no normal cone.
+*/
+
+/* Meshlets */
+struct MeshletOptions
+{
+	// 64 and 124 are the limits mesh shaders are tuned for, the ranges work with any vertex limit below 65536
+	int max_vertices = 64;
+	int max_triangles = 124;
+};
+
+struct MeshletStatistics
+{
+	size_t meshlets;
+	size_t vertices_before;
+	size_t vertices_after;		// Vertices without triangles are left out, the ones out of 16 bit reach are stored twice
+	size_t triangles;
+	bool closed;				// The clusters have normal cones
+};
+
+// Rewrites a triangle list meshlet by meshlet. positions and normals get the vertices in the order the meshlets first
+// use them, the indices of a meshlet count from its base vertex and stay below 65536. ranges and clusters get one
+// entry per meshlet, the fronts of the triangles are the sides the vertex normals point to.
+MeshletStatistics BuildMeshlets(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	std::vector<DrawRange>& ranges,
+	std::vector<ClusterBounds>& clusters,
+	const MeshletOptions& options = MeshletOptions()
+);
+
+// True when every edge of a triangle with area is shared by exactly one other triangle, which runs it the other way.
+// Vertices at the same position count as one, the seams and poles of the grids are closed.
+bool IsClosedMesh(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices);
+
+// Sphere around the vertices and cone around the triangle normals of the triangles of one range
+ClusterBounds ComputeClusterBounds(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices, const DrawRange& range);
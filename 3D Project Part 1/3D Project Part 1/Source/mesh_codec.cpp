@@ -0,0 +1,516 @@
+#include "mesh_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "simd_math.h"
+
+/* Codec Format */
+static const char mesh_codec_magic[8] = { 'P', 'M', 'E', 'S', 'H', 'C', 'O', 'D' };
+static const std::uint32_t mesh_codec_version = 1;
+
+// Values per block, the decoder writes whole blocks so its buffers are rounded up to this
+static const size_t codec_block_size = 16;
+
+// Vertices are dequantized and interleaved in chunks of this many, so the float temporaries stay in the cache
+static const size_t codec_chunk_size = 1024;
+
+// Streams in the order they follow the header: position x, y, z, octahedral normal u, v, indices
+static const int codec_stream_count = 6;
+
+struct MeshCodecHeader
+{
+	char magic[8];
+	std::uint32_t version;
+
+	std::uint32_t vertex_count;
+	std::uint32_t index_count;
+
+	// Vertices per row of the vertex prediction, vertex_count for meshes that are not grids
+	std::uint32_t grid_width;
+	std::uint32_t position_bits;
+	std::uint32_t normal_bits;
+
+	// index[i] is predicted as index[i - index_stride] + index_row_delta, the first index_stride indices
+	// as the same corner of the triangle before
+	std::uint32_t index_stride;
+	std::int32_t index_row_delta;
+
+	float center[3];
+	float extent;
+
+	std::uint64_t stream_sizes[codec_stream_count];
+};
+
+static size_t RoundUpToBlock(size_t count)
+{
+	return (count + codec_block_size - 1) / codec_block_size * codec_block_size;
+}
+
+static std::int32_t QuantizationMax(int bits)
+{
+	return (1 << (std::min(std::max(bits, 2), 16) - 1)) - 1;
+}
+
+/* Residual Blocks */
+static std::uint32_t ZigZag(std::int32_t value)
+{
+	return (std::uint32_t(value) << 1) ^ std::uint32_t(value >> 31);
+}
+
+static std::int32_t UnZigZag(std::uint32_t value)
+{
+	return std::int32_t((value >> 1) ^ (0u - (value & 1)));
+}
+
+// Appends the values in blocks of codec_block_size, each a width byte followed by the values packed at that width.
+// The last block is padded with zeros, so the size of a block only depends on its width.
+static void EncodeBlocks(const std::vector<std::uint32_t>& values, std::vector<std::uint8_t>& output)
+{
+	for (size_t begin = 0; begin < values.size(); begin += codec_block_size)
+	{
+		auto end = std::min(values.size(), begin + codec_block_size);
+		std::uint32_t bits = 0;
+		for (auto i = begin; i < end; ++i)
+			bits |= values[i];
+
+		int width = bits == 0 ? 0 : bits < 0x10 ? 4 : bits < 0x100 ? 8 : bits < 0x10000 ? 16 : 32;
+		output.push_back(std::uint8_t(width));
+
+		for (size_t i = 0; i < codec_block_size && width != 0; ++i)
+		{
+			auto value = begin + i < end ? values[begin + i] : 0;
+			if (width == 4 && (i & 1))
+				output.back() |= std::uint8_t(value << 4);
+			else
+				for (int byte = 0; byte < std::max(width / 8, 1); ++byte)
+					output.push_back(std::uint8_t(value >> (byte * 8)));
+		}
+	}
+}
+
+// Unpacks whole blocks of residuals of at most 16 bits until count values are written, output holds RoundUpToBlock(count)
+static bool DecodeBlocks16(const std::uint8_t* input, const std::uint8_t* end, size_t count, std::int16_t* output)
+{
+	for (size_t begin = 0; begin < count; begin += codec_block_size, output += codec_block_size)
+	{
+		if (input == end)
+			return false;
+
+		int width = *input++;
+		auto size = size_t(width) * codec_block_size / 8;
+		if ((width != 0 && width != 4 && width != 8 && width != 16) || size_t(end - input) < size)
+			return false;
+
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+		auto zero = _mm_setzero_si128();
+		__m128i low = zero;
+		__m128i high = zero;
+		if (width == 4)
+		{
+			// Nibble pairs to bytes, the low nibble is the earlier value
+			auto packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input));
+			auto nibble = _mm_set1_epi8(0x0F);
+			auto bytes = _mm_unpacklo_epi8(_mm_and_si128(packed, nibble), _mm_and_si128(_mm_srli_epi16(packed, 4), nibble));
+			low = _mm_unpacklo_epi8(bytes, zero);
+			high = _mm_unpackhi_epi8(bytes, zero);
+		}
+		else if (width == 8)
+		{
+			auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+			low = _mm_unpacklo_epi8(bytes, zero);
+			high = _mm_unpackhi_epi8(bytes, zero);
+		}
+		else if (width == 16)
+		{
+			low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+			high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 16));
+		}
+
+		// (value >> 1) ^ -(value & 1) on 16 bit lanes
+		auto one = _mm_set1_epi16(1);
+		low = _mm_xor_si128(_mm_srli_epi16(low, 1), _mm_sub_epi16(zero, _mm_and_si128(low, one)));
+		high = _mm_xor_si128(_mm_srli_epi16(high, 1), _mm_sub_epi16(zero, _mm_and_si128(high, one)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), low);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 8), high);
+#else
+		for (size_t i = 0; i < codec_block_size; ++i)
+		{
+			std::uint32_t value = 0;
+			if (width == 4)
+				value = (input[i / 2] >> ((i & 1) * 4)) & 0x0F;
+			else if (width == 8)
+				value = input[i];
+			else if (width == 16)
+				value = input[i * 2] | (input[i * 2 + 1] << 8);
+			output[i] = std::int16_t(UnZigZag(value));
+		}
+#endif
+		input += size;
+	}
+	return true;
+}
+
+// Index residuals can need all 32 bits, grid meshes are mostly zero blocks
+static bool DecodeBlocks32(const std::uint8_t* input, const std::uint8_t* end, size_t count, std::uint32_t* output)
+{
+	for (size_t begin = 0; begin < count; begin += codec_block_size, output += codec_block_size)
+	{
+		if (input == end)
+			return false;
+
+		int width = *input++;
+		auto size = size_t(width) * codec_block_size / 8;
+		if ((width != 0 && width != 4 && width != 8 && width != 16 && width != 32) || size_t(end - input) < size)
+			return false;
+
+		if (width == 0)
+		{
+			std::fill(output, output + codec_block_size, 0u);
+			continue;
+		}
+
+		for (size_t i = 0; i < codec_block_size; ++i)
+		{
+			std::uint32_t value;
+			if (width == 4)
+				value = (input[i / 2] >> ((i & 1) * 4)) & 0x0F;
+			else if (width == 8)
+				value = input[i];
+			else if (width == 16)
+				value = input[i * 2] | (input[i * 2 + 1] << 8);
+			else
+				value = input[i * 4] | (input[i * 4 + 1] << 8) | (input[i * 4 + 2] << 16) | (std::uint32_t(input[i * 4 + 3]) << 24);
+			output[i] = std::uint32_t(UnZigZag(value));
+		}
+		input += size;
+	}
+	return true;
+}
+
+/* Vertex Streams */
+// Residuals of quantized values in rows of width: the step from the previous value minus the same step in the previous row.
+// The arithmetic wraps at 16 bits on both sides, so the decoder reconstructs the values exactly.
+static std::vector<std::uint32_t> PredictRows(const std::vector<std::int16_t>& values, size_t width)
+{
+	std::vector<std::uint32_t> residuals(values.size());
+	for (size_t row = 0; row < values.size(); row += width)
+	{
+		std::int16_t previous_step = 0;
+		for (size_t v = 0; v < width; ++v)
+		{
+			auto step = std::int16_t(values[row + v] - (row >= width ? values[row + v - width] : 0));
+			residuals[row + v] = ZigZag(std::int16_t(step - previous_step));
+			previous_step = step;
+		}
+	}
+	return residuals;
+}
+
+// Inverse of PredictRows in place, a prefix sum over every row plus the row before it
+static void ReconstructRows(std::int16_t* values, size_t count, size_t width)
+{
+	for (size_t row = 0; row < count; row += width)
+	{
+		auto row_values = values + row;
+		auto previous_row = row >= width ? row_values - width : NULL;
+		std::int16_t step = 0;
+		size_t v = 0;
+
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+		auto carry = _mm_setzero_si128();
+		for (; v + 8 <= width; v += 8)
+		{
+			auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_values + v));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+			x = _mm_add_epi16(x, carry);
+			carry = _mm_set1_epi16(std::int16_t(_mm_extract_epi16(x, 7)));
+
+			if (previous_row)
+				x = _mm_add_epi16(x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous_row + v)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(row_values + v), x);
+		}
+		step = std::int16_t(_mm_extract_epi16(carry, 0));
+#endif
+
+		for (; v < width; ++v)
+		{
+			step = std::int16_t(step + row_values[v]);
+			row_values[v] = std::int16_t(step + (previous_row ? previous_row[v] : 0));
+		}
+	}
+}
+
+// scale * value + offset for count values
+static void DequantizeStream(const std::int16_t* values, size_t count, float scale, float offset, float* output)
+{
+	size_t i = 0;
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+	auto scale_lanes = _mm_set1_ps(scale);
+	auto offset_lanes = _mm_set1_ps(offset);
+	for (; i + 8 <= count; i += 8)
+	{
+		// Sign extension, every value lands in the upper half of a 32 bit lane and is shifted back down
+		auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + i));
+		auto low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+		auto high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+		_mm_storeu_ps(output + i, _mm_add_ps(_mm_mul_ps(low, scale_lanes), offset_lanes));
+		_mm_storeu_ps(output + i + 4, _mm_add_ps(_mm_mul_ps(high, scale_lanes), offset_lanes));
+	}
+#endif
+	for (; i < count; ++i)
+		output[i] = values[i] * scale + offset;
+}
+
+/* Octahedral Normals */
+// The unit octahedron folded onto the plane z = 0, the lower half is mirrored across the diagonals
+static glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+	auto n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	if (n.z >= 0)
+		return glm::vec2(n.x, n.y);
+	return glm::vec2((1 - std::abs(n.y)) * (n.x >= 0 ? 1 : -1), (1 - std::abs(n.x)) * (n.y >= 0 ? 1 : -1));
+}
+
+static void DecodeOctahedral(const float* u, const float* v, size_t count, float* x, float* y, float* z)
+{
+	size_t i = 0;
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+	auto one = _mm_set1_ps(1.f);
+	auto sign = _mm_set1_ps(-0.f);
+	for (; i + 4 <= count; i += 4)
+	{
+		// z = 1 - |u| - |v|, the lower half moves u and v back by max(-z, 0) towards zero
+		auto lane_u = _mm_loadu_ps(u + i);
+		auto lane_v = _mm_loadu_ps(v + i);
+		auto lane_z = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(sign, lane_u)), _mm_andnot_ps(sign, lane_v));
+		auto fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), lane_z), _mm_setzero_ps());
+		auto lane_x = _mm_sub_ps(lane_u, _mm_or_ps(fold, _mm_and_ps(sign, lane_u)));
+		auto lane_y = _mm_sub_ps(lane_v, _mm_or_ps(fold, _mm_and_ps(sign, lane_v)));
+
+		auto length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lane_x, lane_x), _mm_mul_ps(lane_y, lane_y)), _mm_mul_ps(lane_z, lane_z));
+		auto inverse_length = _mm_div_ps(one, _mm_sqrt_ps(length_squared));
+		_mm_storeu_ps(x + i, _mm_mul_ps(lane_x, inverse_length));
+		_mm_storeu_ps(y + i, _mm_mul_ps(lane_y, inverse_length));
+		_mm_storeu_ps(z + i, _mm_mul_ps(lane_z, inverse_length));
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		auto n = glm::vec3(u[i], v[i], 1 - std::abs(u[i]) - std::abs(v[i]));
+		auto fold = std::max(-n.z, 0.f);
+		n.x -= n.x >= 0 ? fold : -fold;
+		n.y -= n.y >= 0 ? fold : -fold;
+		auto normal = glm::normalize(n);
+		x[i] = normal.x;
+		y[i] = normal.y;
+		z[i] = normal.z;
+	}
+}
+
+/* Mesh Codec */
+// Index stride with the most exact grid predictions: rows of triangles without poles, or with one or two pole fans
+static size_t ChooseIndexStride(const std::vector<GLuint>& indices, int grid_width)
+{
+	size_t best_stride = 3;
+	size_t best_matches = 0;
+	if (grid_width < 2)
+		return best_stride;
+
+	for (int poles = 0; poles <= 2; ++poles)
+	{
+		auto stride = size_t(grid_width - 1) * 6 - poles * 3;
+		size_t matches = 0;
+		for (auto i = stride; i < indices.size(); ++i)
+			matches += indices[i] - indices[i - stride] == GLuint(grid_width);
+		if (matches > best_matches)
+		{
+			best_matches = matches;
+			best_stride = stride;
+		}
+	}
+
+	// Reordered meshes have no row structure left, the triangle before predicts them better
+	return best_matches * 2 >= indices.size() ? best_stride : 3;
+}
+
+std::vector<std::uint8_t> EncodeMesh(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices,
+	const MeshCodecOptions& options
+)
+{
+	auto vertex_count = positions.size();
+
+	MeshCodecHeader header = {};
+	std::memcpy(header.magic, mesh_codec_magic, sizeof(header.magic));
+	header.version = mesh_codec_version;
+	header.vertex_count = std::uint32_t(vertex_count);
+	header.index_count = std::uint32_t(indices.size());
+	header.position_bits = std::uint32_t(options.position_bits);
+	header.normal_bits = std::uint32_t(options.normal_bits);
+
+	auto grid = options.grid_width > 0 && vertex_count % options.grid_width == 0;
+	header.grid_width = std::uint32_t(grid ? options.grid_width : std::max<size_t>(vertex_count, 1));
+
+	// Uniform extent like QuantizeBounds
+	auto min = glm::vec3(0);
+	auto max = glm::vec3(0);
+	if (vertex_count > 0)
+	{
+		min = max = positions[0];
+		for (auto& position : positions)
+		{
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+	}
+	auto center = (min + max) / 2.f;
+	auto half_size = (max - min) / 2.f;
+	auto extent = std::max({ half_size.x, half_size.y, half_size.z });
+	header.center[0] = center.x;
+	header.center[1] = center.y;
+	header.center[2] = center.z;
+	header.extent = extent > 0 ? extent : 1.f;
+
+	std::vector<std::int16_t> quantized[5];
+	for (auto& stream : quantized)
+		stream.resize(vertex_count);
+
+	auto position_max = float(QuantizationMax(options.position_bits));
+	auto normal_max = float(QuantizationMax(options.normal_bits));
+	for (size_t i = 0; i < vertex_count; ++i)
+	{
+		auto position = (positions[i] - center) / header.extent * position_max;
+		auto octahedral = EncodeOctahedral(normals[i]) * normal_max;
+		quantized[0][i] = std::int16_t(std::lround(position.x));
+		quantized[1][i] = std::int16_t(std::lround(position.y));
+		quantized[2][i] = std::int16_t(std::lround(position.z));
+		quantized[3][i] = std::int16_t(std::lround(octahedral.x));
+		quantized[4][i] = std::int16_t(std::lround(octahedral.y));
+	}
+
+	std::vector<std::uint8_t> streams[codec_stream_count];
+	for (int stream = 0; stream < 5; ++stream)
+		EncodeBlocks(PredictRows(quantized[stream], header.grid_width), streams[stream]);
+
+	auto stride = ChooseIndexStride(indices, grid ? options.grid_width : 0);
+	header.index_stride = std::uint32_t(stride);
+	header.index_row_delta = stride == 3 ? 0 : options.grid_width;
+
+	std::vector<std::uint32_t> index_residuals(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		auto predicted = i >= stride ? indices[i - stride] + GLuint(header.index_row_delta) : i >= 3 ? indices[i - 3] : 0;
+		index_residuals[i] = ZigZag(std::int32_t(indices[i] - predicted));
+	}
+	EncodeBlocks(index_residuals, streams[5]);
+
+	std::vector<std::uint8_t> output(sizeof(header));
+	for (int stream = 0; stream < codec_stream_count; ++stream)
+	{
+		header.stream_sizes[stream] = streams[stream].size();
+		output.insert(output.end(), streams[stream].begin(), streams[stream].end());
+	}
+	std::memcpy(output.data(), &header, sizeof(header));
+	return output;
+}
+
+bool DecodeMesh(
+	const std::uint8_t* data,
+	size_t size,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices
+)
+{
+	MeshCodecHeader header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, mesh_codec_magic, sizeof(header.magic)) != 0 || header.version != mesh_codec_version)
+		return false;
+
+	auto vertex_count = size_t(header.vertex_count);
+	auto index_count = size_t(header.index_count);
+	auto width = size_t(header.grid_width);
+	auto stride = size_t(header.index_stride);
+	if (width == 0 || vertex_count % width != 0 || stride < 3)
+		return false;
+
+	const std::uint8_t* stream_begin[codec_stream_count];
+	auto offset = sizeof(header);
+	for (int stream = 0; stream < codec_stream_count; ++stream)
+	{
+		if (header.stream_sizes[stream] > size - offset)
+			return false;
+		stream_begin[stream] = data + offset;
+		offset += size_t(header.stream_sizes[stream]);
+	}
+
+	// The five vertex streams, each rounded up to whole blocks
+	auto padded_count = RoundUpToBlock(vertex_count);
+	std::vector<std::int16_t> quantized(padded_count * 5);
+	for (int stream = 0; stream < 5; ++stream)
+	{
+		auto values = quantized.data() + stream * padded_count;
+		if (!DecodeBlocks16(stream_begin[stream], stream_begin[stream] + header.stream_sizes[stream], vertex_count, values))
+			return false;
+		ReconstructRows(values, vertex_count, width);
+	}
+
+	positions.resize(vertex_count);
+	normals.resize(vertex_count);
+	auto position_scale = header.extent / QuantizationMax(int(header.position_bits));
+	auto normal_scale = 1.f / QuantizationMax(int(header.normal_bits));
+
+	float x[codec_chunk_size], y[codec_chunk_size], z[codec_chunk_size], u[codec_chunk_size], v[codec_chunk_size];
+	for (size_t begin = 0; begin < vertex_count; begin += codec_chunk_size)
+	{
+		auto count = std::min(codec_chunk_size, vertex_count - begin);
+		DequantizeStream(&quantized[begin], count, position_scale, header.center[0], x);
+		DequantizeStream(&quantized[padded_count + begin], count, position_scale, header.center[1], y);
+		DequantizeStream(&quantized[padded_count * 2 + begin], count, position_scale, header.center[2], z);
+		for (size_t i = 0; i < count; ++i)
+			positions[begin + i] = glm::vec3(x[i], y[i], z[i]);
+
+		DequantizeStream(&quantized[padded_count * 3 + begin], count, normal_scale, 0, u);
+		DequantizeStream(&quantized[padded_count * 4 + begin], count, normal_scale, 0, v);
+		DecodeOctahedral(u, v, count, x, y, z);
+		for (size_t i = 0; i < count; ++i)
+			normals[begin + i] = glm::vec3(x[i], y[i], z[i]);
+	}
+
+	indices.resize(RoundUpToBlock(index_count));
+	if (!DecodeBlocks32(stream_begin[5], stream_begin[5] + header.stream_sizes[5], index_count, indices.data()))
+		return false;
+	indices.resize(index_count);
+
+	auto first_row = std::min(stride, index_count);
+	for (size_t i = 3; i < first_row; ++i)
+		indices[i] += indices[i - 3];
+
+	// Every index depends on one a whole row earlier, so the rows reconstruct four lanes at a time
+	auto row_delta = GLuint(header.index_row_delta);
+	size_t i = first_row;
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+	if (stride >= 4)
+	{
+		auto delta = _mm_set1_epi32(std::int32_t(row_delta));
+		for (; i + 4 <= index_count; i += 4)
+		{
+			auto predicted = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&indices[i - stride])), delta);
+			auto residual = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&indices[i]));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&indices[i]), _mm_add_epi32(predicted, residual));
+		}
+	}
+#endif
+	for (; i < index_count; ++i)
+		indices[i] += indices[i - stride] + row_delta;
+
+	return true;
+}
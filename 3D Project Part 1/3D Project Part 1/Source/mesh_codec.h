@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/*
+	Compact transfer format for meshes in the position, normal and index vector layout of the generators.
+
+	Positions are quantized to the mesh bounds and normals to octahedral coordinates. Every component is
+	one stream of residuals against a prediction, in blocks of 16 values that are 0, 4, 8, 16 or 32 bits wide:
+		vertices	grid meshes predict a vertex from the one before it plus the same step in the previous row,
+					that is exact for a plane, other meshes use the vertex before it
+		indices		the same corner one grid row earlier plus grid_width, that is exact for the VRtoIndex
+					pattern, other meshes use the same corner of the triangle before
+	The decoder unpacks the blocks and reconstructs whole rows on SSE2 lanes when the build has them.
+*/
+
+/* Mesh Codec */
+struct MeshCodecOptions
+{
+	// Quantization of the positions relative to the bounds, and of the two octahedral normal coordinates, at most 16
+	int position_bits = 16;
+	int normal_bits = 12;
+
+	// vertical_segments of a mesh from the grid generators, 0 for any other mesh
+	int grid_width = 0;
+};
+
+std::vector<std::uint8_t> EncodeMesh(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices,
+	const MeshCodecOptions& options = MeshCodecOptions()
+);
+
+// Replaces the contents of the vectors, false when data is not a complete encoded mesh
+bool DecodeMesh(
+	const std::uint8_t* data,
+	size_t size,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices
+);
@@ -1,230 +1,500 @@
 #include "mesh_generation.h"
+#include "parametric_generator.h"
 
-/* Generator Functions */
-void GenerateParametricShapeFrom2D(
-	std::vector<glm::vec3>& positions,
-	std::vector<glm::vec3>& normals,
-	std::vector<GLuint>& indices,
-	glm::dvec2(*parametric_line)(double),
-	int vertical_segments,
-	int rotation_segments
-)
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/* Generator Settings */
+static unsigned int mesh_generation_thread_count = 0;
+static bool mesh_generation_simd_enabled = true;
+
+void SetMeshGenerationThreadCount(unsigned int thread_count)
 {
-	auto parametric_surface = [parametric_line](double t, double r)
+	mesh_generation_thread_count = thread_count;
+}
+
+unsigned int GetMeshGenerationThreadCount()
+{
+	if (mesh_generation_thread_count != 0)
+		return mesh_generation_thread_count;
+
+	// hardware_concurrency may return 0 when it cannot be detected
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void SetMeshGenerationSimdEnabled(bool enabled)
+{
+	mesh_generation_simd_enabled = enabled;
+}
+
+bool GetMeshGenerationSimdEnabled()
+{
+	return mesh_generation_simd_enabled;
+}
+
+/* Worker Pool */
+// Threads that wait between the ParallelForRows calls instead of being created and joined by each of them. There is
+// one fewer than the thread count, the calling thread works as well. They are started on the first call and again
+// after SetMeshGenerationThreadCount changed the count.
+class RowWorkerPool
+{
+public:
+	~RowWorkerPool()
 	{
-		auto p = glm::dvec3(parametric_line(t), 0);
-		return glm::rotateY(p, r * glm::two_pi<double>());
-	};
+		Resize(0);
+	}
 
-	positions.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			positions.push_back(parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments)));
+	void Run(int worker_count, int row_count, const std::function<void(int, int)>& task)
+	{
+		// One call at a time, callers on other threads wait for the workers to be free
+		std::lock_guard<std::mutex> run_lock(run_mutex);
+		if (int(workers.size()) != worker_count)
+			Resize(worker_count);
 
-	normals.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
+		// Rows are handed out in small chunks so that uneven rows do not stall a single worker
 		{
-			auto nv = v / double(vertical_segments - 1);
-			auto nr = r / double(rotation_segments);
-			auto epsilonv = 1 / double(vertical_segments - 1);
-			auto epsilonr = 1 / double(rotation_segments);
+			std::lock_guard<std::mutex> lock(mutex);
+			current_task = &task;
+			current_row_count = row_count;
+			chunk_size = std::max(1, row_count / ((worker_count + 1) * 8));
+			next_row = 0;
+			busy_workers = worker_count;
+			++generation;
+		}
+		start.notify_all();
 
-			auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
-			auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
-			auto tangent_v = (to_next_v + from_prev_v) / 2.;
+		Work();
 
-			auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
-			auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
-			auto tangent_r = (to_next_r + from_prev_r) / 2.;
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return busy_workers == 0; });
+		current_task = NULL;
+	}
 
-			auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
-			normals.push_back(normal);
-		}
+	// Tasks that call ParallelForRows again run their rows on their own thread
+	static thread_local bool in_task;
 
-	auto VRtoIndex = [vertical_segments, rotation_segments](int v, int r)
+private:
+	void Work()
 	{
-		return (r % rotation_segments) * vertical_segments + v;
-	};
-	indices.reserve(rotation_segments * (vertical_segments - 1) * 6);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments - 1; ++v)
+		in_task = true;
+		for (int begin = next_row.fetch_add(chunk_size); begin < current_row_count; begin = next_row.fetch_add(chunk_size))
+			(*current_task)(begin, std::min(begin + chunk_size, current_row_count));
+		in_task = false;
+	}
+
+	void WorkerLoop(std::uint64_t seen_generation)
+	{
+		for (;;)
 		{
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v, r + 1));
-			indices.push_back(VRtoIndex(v, r));
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start.wait(lock, [&]() { return stop || generation != seen_generation; });
+				if (stop)
+					return;
+				seen_generation = generation;
+			}
+
+			Work();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy_workers == 0)
+				done.notify_one();
+		}
+	}
 
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v + 1, r + 1));
-			indices.push_back(VRtoIndex(v, r + 1));
+	void Resize(int worker_count)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
 		}
+		start.notify_all();
+		for (auto& worker : workers)
+			worker.join();
+		workers.clear();
+
+		stop = false;
+		workers.reserve(worker_count);
+		for (int i = 0; i < worker_count; ++i)
+			workers.emplace_back(&RowWorkerPool::WorkerLoop, this, generation);
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex run_mutex;
+
+	// Guards the fields below, the workers wait on start for the next generation and the caller on done
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable done;
+	std::uint64_t generation = 0;
+	int busy_workers = 0;
+	bool stop = false;
+
+	const std::function<void(int, int)>* current_task = NULL;
+	int current_row_count = 0;
+	int chunk_size = 1;
+	std::atomic<int> next_row{ 0 };
+};
+
+thread_local bool RowWorkerPool::in_task = false;
+
+void ParallelForRows(int row_count, const std::function<void(int, int)>& task)
+{
+	int thread_count = int(std::min<unsigned int>(GetMeshGenerationThreadCount(), std::max(row_count, 1)));
+	if (thread_count <= 1 || RowWorkerPool::in_task)
+	{
+		task(0, row_count);
+		return;
+	}
+
+	// The pool keeps the threads of the full count, calls with fewer rows leave the extra workers without rows
+	static RowWorkerPool pool;
+	pool.Run(int(GetMeshGenerationThreadCount()) - 1, row_count, task);
 }
 
-void GenerateParametricShapeFrom2Dv2(
-	std::vector<glm::vec3>& positions,
-	std::vector<glm::vec3>& normals,
-	std::vector<GLuint>& indices,
+// A strip repeats its first index to keep the winding of the triangle list, and ends with a restart index.
+// A pole drops one triangle per row: two indices at the start of a strip, or one at its end.
+static size_t GridIndicesPerRow(int vertical_segments, GLenum primitive, const GridPoles& poles)
+{
+	if (primitive == GL_TRIANGLE_STRIP)
+		return size_t(vertical_segments) * 2 + 2 - (poles.first ? 2 : 0) - (poles.last ? 1 : 0);
+	return size_t(vertical_segments - 1) * 6 - (poles.first ? 3 : 0) - (poles.last ? 3 : 0);
+}
+
+// One base-vertex draw per chunk of rows, chunked plans are the ones with a seam row
+static void PlanGridDrawRanges(GridMeshPlan& plan)
+{
+	plan.index_format.ranges.clear();
+	if (!plan.seam_row)
+		return;
+
+	for (int r = 0; r < plan.rotation_segments; r += plan.rows_per_chunk)
+	{
+		auto rows = std::min(plan.rows_per_chunk, plan.rotation_segments - r);
+		plan.index_format.ranges.push_back(DrawRange{ r * plan.indices_per_row, GLsizei(rows * plan.indices_per_row), r * plan.vertical_segments });
+	}
+}
+
+GridMeshPlan PlanGridMesh(int vertical_segments, int rotation_segments, const GridIndexOptions& options)
+{
+	GridMeshPlan plan;
+	plan.vertical_segments = vertical_segments;
+	plan.rotation_segments = rotation_segments;
+	plan.vertex_count = size_t(vertical_segments) * rotation_segments;
+
+	plan.index_format.primitive = options.strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+	plan.indices_per_row = GridIndicesPerRow(vertical_segments, plan.index_format.primitive, plan.poles);
+	plan.index_count = plan.indices_per_row * rotation_segments;
+
+	plan.seam_row = false;
+	plan.rows_per_chunk = rotation_segments;
+	plan.pole_fans = options.pole_fans;
+
+	// 0xFFFF is the restart index, so a short index reaches 0xFFFF vertices
+	const size_t max_short_vertices = 0xFFFF;
+	if (!options.short_indices)
+		return plan;
+
+	if (plan.vertex_count <= max_short_vertices)
+	{
+		plan.index_format.type = GL_UNSIGNED_SHORT;
+		return plan;
+	}
+
+	// A chunk of n rows of quads references n + 1 vertex rows
+	auto rows_per_chunk = int(max_short_vertices / vertical_segments) - 1;
+	if (rows_per_chunk < 1)
+		return plan;
+
+	plan.index_format.type = GL_UNSIGNED_SHORT;
+	plan.seam_row = true;
+	plan.rows_per_chunk = rows_per_chunk;
+	plan.vertex_count += vertical_segments;
+	PlanGridDrawRanges(plan);
+	return plan;
+}
+
+void SetGridPoles(GridMeshPlan& plan, const GridPoles& poles)
+{
+	if (!plan.pole_fans)
+		return;
+
+	plan.poles = poles;
+	plan.indices_per_row = GridIndicesPerRow(plan.vertical_segments, plan.index_format.primitive, poles);
+	plan.index_count = plan.indices_per_row * plan.rotation_segments;
+	PlanGridDrawRanges(plan);
+}
+
+size_t GridTriangleCount(const GridMeshPlan& plan)
+{
+	// Two per quad, a pole column keeps one per row
+	auto triangles_per_row = size_t(plan.vertical_segments - 1) * 2 - (plan.poles.first ? 1 : 0) - (plan.poles.last ? 1 : 0);
+	return triangles_per_row * plan.rotation_segments;
+}
+
+/* Generator Helpers */
+// Calls generate(kernel) with the kernel of one of the example profiles, false for any other function
+template <typename Generate>
+static bool FindLineKernel(glm::dvec2(*parametric_line)(double), const Generate& generate)
+{
+	if (parametric_line == ParametricHalfCircle)
+		generate(ParametricHalfCircleKernel());
+	else if (parametric_line == ParametricCircle)
+		generate(ParametricCircleKernel());
+	else if (parametric_line == ParametricSpikes)
+		generate(ParametricSpikesKernel());
+	else if (parametric_line == ParametricSpikyv2)
+		generate(ParametricSpikyv2Kernel());
+	else
+		return false;
+
+	return true;
+}
+
+// FindLineKernel for the SIMD lanes, false when they are disabled
+template <typename Generate>
+static bool DispatchLineKernel(glm::dvec2(*parametric_line)(double), const Generate& generate)
+{
+	return GetMeshGenerationSimdEnabled() && FindLineKernel(parametric_line, generate);
+}
+
+// Shared bodies of the vector and span versions of the generator functions
+template <typename Precision, typename Layout>
+static void GenerateFrom2D(
+	Layout& layout,
 	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	NormalMethod normal_method
 )
 {
-	auto parametric_surface = [parametric_line](double t, double r)
+	// The profile kernels run on dual numbers for the exact profile tangents
+	auto generate_dual = [&](auto line_kernel)
 	{
-		auto p = glm::dvec3(parametric_line(t), 0);
-
-		p *= (sin(r * 5 * glm::two_pi<double>()) + 3) / 4.;
-		p.y *= (pow(sin((r + 0.5) * 5 * glm::two_pi<double>()), 6) + 3) / 3;
-		auto xy_len = glm::length(glm::vec2(p));
-		p.y *= pow(xy_len, 1.3);
-		auto a = sin(xy_len * 1.2 * glm::two_pi<double>() * 0.4);
-
-		return glm::rotateY(p, a + r * glm::two_pi<double>());
+		GenerateRevolutionSurfaceMesh<Precision>(MakeBatchLine(line_kernel), vertical_segments, rotation_segments, layout, normal_method);
 	};
+	if (normal_method == NormalMethod::DualNumbers && FindLineKernel(parametric_line, generate_dual))
+		return;
 
-	positions.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			positions.push_back(parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments)));
-
-	normals.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-		{
-			auto nv = v / double(vertical_segments - 1);
-			auto nr = r / double(rotation_segments);
-			auto epsilonv = 1 / double(vertical_segments - 1);
-			auto epsilonr = 1 / double(rotation_segments);
+	if (normal_method == NormalMethod::SampledGrid || normal_method == NormalMethod::DualNumbers)
+	{
+		GenerateRevolutionSurfaceMesh<Precision>(parametric_line, vertical_segments, rotation_segments, layout, normal_method);
+		return;
+	}
 
-			auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
-			auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
-			auto tangent_v = (to_next_v + from_prev_v) / 2.;
+	auto parametric_surface = [parametric_line](double t, double r)
+	{
+		auto p = glm::dvec3(parametric_line(t), 0);
+		return glm::rotateY(p, r * glm::two_pi<double>());
+	};
 
-			auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
-			auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
-			auto tangent_r = (to_next_r + from_prev_r) / 2.;
+	GenerateParametricSurfaceMesh<Precision>(parametric_surface, vertical_segments, rotation_segments, layout, normal_method);
+}
 
-			auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
-			normals.push_back(normal);
-		}
+template <typename Precision, typename Layout>
+static void GenerateFrom2Dv2(
+	Layout& layout,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
+{
+	auto generate_batched = [&](auto line_kernel)
+	{
+		auto kernel = ParametricSurfacev2FromLineKernel<decltype(line_kernel)>{ line_kernel };
+		GenerateParametricSurfaceMesh<Precision>(MakeBatchSurface(kernel), vertical_segments, rotation_segments, layout, normal_method);
+	};
+	// Dual numbers need the kernel even when the SIMD lanes are disabled
+	auto found = normal_method == NormalMethod::DualNumbers ? FindLineKernel(parametric_line, generate_batched) : DispatchLineKernel(parametric_line, generate_batched);
+	if (found)
+		return;
 
-	auto VRtoIndex = [vertical_segments, rotation_segments](int v, int r)
+	auto parametric_surface = [parametric_line](double t, double r)
 	{
-		return (r % rotation_segments) * vertical_segments + v;
+		return ParametricSurfacev2(parametric_line(t), r);
 	};
-	indices.reserve(rotation_segments * (vertical_segments - 1) * 6);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments - 1; ++v)
-		{
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v, r + 1));
-			indices.push_back(VRtoIndex(v, r));
 
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v + 1, r + 1));
-			indices.push_back(VRtoIndex(v, r + 1));
-		}
+	GenerateParametricSurfaceMesh<Precision>(parametric_surface, vertical_segments, rotation_segments, layout, normal_method);
 }
 
-void GenerateParametricShapeFrom3D(
+static bool CheckMeshSpan(const MeshSpan& output, int vertical_segments, int rotation_segments)
+{
+	auto plan = PlanGridMesh(vertical_segments, rotation_segments, output.index_options);
+	if (output.vertex_capacity < plan.vertex_count || output.index_capacity < plan.index_count)
+	{
+		std::cout << "Error: Mesh span is too small for a " << vertical_segments << "x" << rotation_segments << " mesh" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/* Generator Functions */
+template <typename Precision>
+void GenerateParametricShapeFrom2D(
 	std::vector<glm::vec3>& positions,
 	std::vector<glm::vec3>& normals,
 	std::vector<GLuint>& indices,
-	glm::dvec3(*parametric_surface)(double, double),
+	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	NormalMethod normal_method
 )
 {
-	positions.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-			positions.push_back(parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments)));
-
-	normals.reserve(vertical_segments * rotation_segments);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments; ++v)
-		{
-			auto nv = v / double(vertical_segments - 1);
-			auto nr = r / double(rotation_segments);
-			auto epsilonv = 1 / double(vertical_segments - 1);
-			auto epsilonr = 1 / double(rotation_segments);
+	SeparateArraysLayout layout(positions, normals, indices);
+	GenerateFrom2D<Precision>(layout, parametric_line, vertical_segments, rotation_segments, normal_method);
+}
 
-			auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
-			auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
-			auto tangent_v = (to_next_v + from_prev_v) / 2.;
+template <typename Precision>
+bool GenerateParametricShapeFrom2D(
+	MeshSpan& output,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
+{
+	if (!CheckMeshSpan(output, vertical_segments, rotation_segments))
+		return false;
 
-			auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
-			auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
-			auto tangent_r = (to_next_r + from_prev_r) / 2.;
+	MeshSpanLayout layout{ output };
+	GenerateFrom2D<Precision>(layout, parametric_line, vertical_segments, rotation_segments, normal_method);
+	return true;
+}
 
-			auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
-			normals.push_back(normal);
-		}
+template <typename Precision>
+void GenerateParametricShapeFrom2Dv2(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
+{
+	SeparateArraysLayout layout(positions, normals, indices);
+	GenerateFrom2Dv2<Precision>(layout, parametric_line, vertical_segments, rotation_segments, normal_method);
+}
 
-	auto VRtoIndex = [vertical_segments, rotation_segments](int v, int r)
-	{
-		return (r % rotation_segments) * vertical_segments + v;
-	};
-	indices.reserve(rotation_segments * (vertical_segments - 1) * 6);
-	for (int r = 0; r < rotation_segments; ++r)
-		for (int v = 0; v < vertical_segments - 1; ++v)
-		{
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v, r + 1));
-			indices.push_back(VRtoIndex(v, r));
+template <typename Precision>
+bool GenerateParametricShapeFrom2Dv2(
+	MeshSpan& output,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
+{
+	if (!CheckMeshSpan(output, vertical_segments, rotation_segments))
+		return false;
 
-			indices.push_back(VRtoIndex(v + 1, r));
-			indices.push_back(VRtoIndex(v + 1, r + 1));
-			indices.push_back(VRtoIndex(v, r + 1));
-		}
+	MeshSpanLayout layout{ output };
+	GenerateFrom2Dv2<Precision>(layout, parametric_line, vertical_segments, rotation_segments, normal_method);
+	return true;
 }
 
-/* Example 2D Parametric Functions */
-glm::dvec2 ParametricHalfCircle(double t)
+template <typename Precision>
+void GenerateParametricShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec3(*parametric_surface)(double, double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
 {
-	// [0, 1]
-	t -= 0.5;
-	// [-0.5, 0.5]
-	t *= glm::pi<double>();
-	// [-PI*0.5, PI*0.5]
-	return glm::dvec2(cos(t), sin(t));
-};
+	SeparateArraysLayout layout(positions, normals, indices);
+	GenerateParametricSurfaceMesh<Precision>(parametric_surface, vertical_segments, rotation_segments, layout, normal_method);
+}
 
-glm::dvec2 ParametricCircle(double t)
+template <typename Precision>
+bool GenerateParametricShapeFrom3D(
+	MeshSpan& output,
+	glm::dvec3(*parametric_surface)(double, double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method
+)
 {
-	// [0, 1]
-	t -= 0.5;
-	// [-0.5, 0.5]
-	t *= glm::two_pi<double>();
-	// [-PI, PI]
+	if (!CheckMeshSpan(output, vertical_segments, rotation_segments))
+		return false;
 
-	auto c = glm::dvec2(0.7, 0);
-	auto r = 0.3;
-	return glm::dvec2(cos(t), sin(t)) * r + c;
-};
+	MeshSpanLayout layout{ output };
+	GenerateParametricSurfaceMesh<Precision>(parametric_surface, vertical_segments, rotation_segments, layout, normal_method);
+	return true;
+}
 
-glm::dvec2 ParametricSpikes(double t)
+/* Adaptive Generator Functions */
+template <typename Surface>
+static void GenerateAdaptive(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	const Surface& parametric_surface,
+	const AdaptiveSamplingOptions& options
+)
 {
-	// [0, 1]
-	t -= 0.5;
-	// [-0.5, 0.5]
-	t *= glm::two_pi<double>();
-	// [-PI, PI]
+	SeparateArraysLayout layout(positions, normals, indices);
+	GenerateAdaptiveSurfaceMesh(parametric_surface, PlanAdaptiveGrid(parametric_surface, options), layout);
+}
 
-	auto c = glm::dvec2(0.7, 0);
-	auto r = 0.3;
-	auto a = 2 + 4 * 2;
-	return (glm::dvec2(cos(t) + sin(a*t) / a, sin(t) + cos(a*t) / a)) * r + c;
-};
+void GenerateAdaptiveShapeFrom2D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec2(*parametric_line)(double),
+	const AdaptiveSamplingOptions& options
+)
+{
+	auto parametric_surface = [parametric_line](double t, double r)
+	{
+		auto p = glm::dvec3(parametric_line(t), 0);
+		return glm::rotateY(p, r * glm::two_pi<double>());
+	};
+	GenerateAdaptive(positions, normals, indices, parametric_surface, options);
+}
+
+void GenerateAdaptiveShapeFrom2Dv2(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec2(*parametric_line)(double),
+	const AdaptiveSamplingOptions& options
+)
+{
+	auto parametric_surface = [parametric_line](double t, double r)
+	{
+		return ParametricSurfacev2(parametric_line(t), r);
+	};
+	GenerateAdaptive(positions, normals, indices, parametric_surface, options);
+}
 
-glm::dvec2 ParametricSpikyv2(double t)
+void GenerateAdaptiveShapeFrom3D(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec3(*parametric_surface)(double, double),
+	const AdaptiveSamplingOptions& options
+)
 {
-	// [0, 1]
-	t -= 0.5;
-	// [-0.5, 0.5]
-	t *= glm::pi<double>();
-	// [-PI, PI]
+	GenerateAdaptive(positions, normals, indices, parametric_surface, options);
+}
 
-	auto a = 2 + 4 * 2;
-	return (glm::dvec2(cos(t) + sin(a*t) / a, sin(t) + cos(a*t) / a));
-};
\ No newline at end of file
+template void GenerateParametricShapeFrom2D<double>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec2(*)(double), int, int, NormalMethod);
+template void GenerateParametricShapeFrom2D<float>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec2(*)(double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom2D<double>(MeshSpan&, glm::dvec2(*)(double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom2D<float>(MeshSpan&, glm::dvec2(*)(double), int, int, NormalMethod);
+template void GenerateParametricShapeFrom2Dv2<double>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec2(*)(double), int, int, NormalMethod);
+template void GenerateParametricShapeFrom2Dv2<float>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec2(*)(double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom2Dv2<double>(MeshSpan&, glm::dvec2(*)(double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom2Dv2<float>(MeshSpan&, glm::dvec2(*)(double), int, int, NormalMethod);
+template void GenerateParametricShapeFrom3D<double>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec3(*)(double, double), int, int, NormalMethod);
+template void GenerateParametricShapeFrom3D<float>(std::vector<glm::vec3>&, std::vector<glm::vec3>&, std::vector<GLuint>&, glm::dvec3(*)(double, double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom3D<double>(MeshSpan&, glm::dvec3(*)(double, double), int, int, NormalMethod);
+template bool GenerateParametricShapeFrom3D<float>(MeshSpan&, glm::dvec3(*)(double, double), int, int, NormalMethod);
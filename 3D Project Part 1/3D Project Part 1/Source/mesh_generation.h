@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
 #include <vector>
 #include "GLM/glm.hpp"
@@ -7,7 +8,138 @@
 #include "GLM/gtx/rotate_vector.hpp"
 #include "GLAD/glad.h"
 
+#include "mesh_bounds.h"
+#include "parametric_kernels.h"
+#include "vertex_format.h"
+
+/* Generator Settings */
+// Number of worker threads the generators split their rows across, 0 uses every hardware thread. The workers are
+// kept between the calls, the next ParallelForRows starts the new count.
+void SetMeshGenerationThreadCount(unsigned int thread_count);
+unsigned int GetMeshGenerationThreadCount();
+
+// Evaluate the example parametric functions on SIMD lanes where the generator recognizes them, on by default
+void SetMeshGenerationSimdEnabled(bool enabled);
+bool GetMeshGenerationSimdEnabled();
+
+// Calls task(begin, end) on disjoint row ranges covering [0, row_count) from the worker threads. A task that calls it
+// again runs the inner rows on its own thread.
+void ParallelForRows(int row_count, const std::function<void(int, int)>& task);
+
+/* Generator Options */
+enum class NormalMethod
+{
+	SampledGrid,		// Central differences over the sampled position grid, one surface evaluation per grid point
+	FiniteDifference,	// Exact central differences, eight extra surface evaluations per vertex
+	DualNumbers			// Exact derivatives from one evaluation per vertex on dual numbers, for the example functions.
+						// Other functions fall back to central differences with a small step.
+};
+
+/* Index Options */
+struct GridIndexOptions
+{
+	// One triangle strip per row of quads, separated by primitive restart indices, instead of a triangle list
+	bool strips = false;
+
+	// GL_UNSIGNED_SHORT indices, split into base-vertex chunks when the mesh has more than 0xFFFF vertices
+	bool short_indices = false;
+
+	// Columns that collapse to a point, like the poles of ParametricHalfCircle, are drawn as triangle fans
+	// without the zero area triangles of their quads
+	bool pole_fans = true;
+};
+
+// First (t = 0) and last (t = 1) grid columns that the generators found collapsed to a single point
+struct GridPoles
+{
+	bool first = false;
+	bool last = false;
+};
+
+// Vertex and index counts of a vertical_segments x rotation_segments grid and how its indices are drawn
+struct GridMeshPlan
+{
+	int vertical_segments;
+	int rotation_segments;
+
+	size_t vertex_count;
+	size_t index_count;
+	size_t indices_per_row;
+
+	// Chunked meshes repeat vertex row 0 as row rotation_segments, so that every chunk
+	// references one contiguous range of rows, including the chunk that closes the seam
+	bool seam_row;
+	int rows_per_chunk;
+
+	// The counts above are for a grid without poles until SetGridPoles, which only shrinks them
+	bool pole_fans;
+	GridPoles poles;
+
+	IndexFormat index_format;
+};
+
+GridMeshPlan PlanGridMesh(int vertical_segments, int rotation_segments, const GridIndexOptions& options = GridIndexOptions());
+
+// Drops the zero area triangles of the pole columns from the index counts and draw ranges, when the plan has pole_fans
+void SetGridPoles(GridMeshPlan& plan, const GridPoles& poles);
+
+// Triangles the indices of the plan draw. Strips draw the same ones as triangle lists, their restart indices and the
+// zero area triangle of the repeated first index of every row are not counted.
+size_t GridTriangleCount(const GridMeshPlan& plan);
+
+/* Adaptive Sampling */
+// How the adaptive generators place their grid lines
+struct AdaptiveSamplingOptions
+{
+	// Largest distance between the triangles and the surface they span, in object units. It is checked by parameter
+	// at the edge midpoints, the diagonal midpoint and the triangle centroids of every quad.
+	double tolerance = 1e-3;
+
+	// Flat regions still get intervals no wider than 1 / initial_segments, and narrow features between them are not missed
+	int initial_segments = 16;
+
+	// Intervals are no narrower than 1 / max_segments, the curvature is sampled on a quarter of that
+	int max_segments = 4096;
+
+	// Grid lines of the other direction the chord error is measured along
+	int probe_count = 64;
+};
+
+// Grid line parameters of an adaptive mesh, t ascending in [0, 1] and r ascending in [0, 1)
+struct AdaptiveGrid
+{
+	std::vector<double> t;
+	std::vector<double> r;
+};
+
+/* Output Buffers */
+// Caller-owned output memory, for example mapped GL buffers, sized with PlanGridMesh(..., index_options).
+// Vertices are written in format, with its strides, interleaved spans point normals at positions + PositionSize().
+// Without indices only the vertices are written, the index count, format and poles are still filled in.
+struct MeshSpan
+{
+	void* positions;
+	void* normals;
+	void* indices;
+
+	size_t vertex_capacity;
+	size_t index_capacity;
+
+	VertexFormat format = {};
+	GridIndexOptions index_options = {};
+
+	// Written by the generators, Snorm16x4 positions are relative to these bounds.
+	// index_count is below index_capacity when pole fans dropped triangles.
+	MeshBounds bounds = {};
+	PositionQuantization quantization = {};
+	IndexFormat index_format = {};
+	size_t index_count = 0;
+	GridPoles poles = {};
+};
+
 /* Generator Functions */
+// Precision is double or float, the type the surface is sampled and the normals are computed in
+template <typename Precision = double>
 void GenerateParametricShapeFrom2D
 (
 	std::vector<glm::vec3>& positions,
@@ -15,9 +147,11 @@ void GenerateParametricShapeFrom2D
 	std::vector<GLuint>& indices,
 	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
 );
 
+template <typename Precision = double>
 void GenerateParametricShapeFrom2Dv2
 (
 	std::vector<glm::vec3>& positions,
@@ -25,9 +159,11 @@ void GenerateParametricShapeFrom2Dv2
 	std::vector<GLuint>& indices,
 	glm::dvec2(*parametric_line)(double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
 );
 
+template <typename Precision = double>
 void GenerateParametricShapeFrom3D
 (
 	std::vector<glm::vec3>& positions,
@@ -35,11 +171,108 @@ void GenerateParametricShapeFrom3D
 	std::vector<GLuint>& indices,
 	glm::dvec3(*parametric_surface)(double, double),
 	int vertical_segments,
-	int rotation_segments
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+);
+
+// Span versions write straight into output, they return false when it is too small for the mesh
+// and fill in output.bounds, output.quantization and output.index_format otherwise
+template <typename Precision = double>
+bool GenerateParametricShapeFrom2D
+(
+	MeshSpan& output,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+);
+
+template <typename Precision = double>
+bool GenerateParametricShapeFrom2Dv2
+(
+	MeshSpan& output,
+	glm::dvec2(*parametric_line)(double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+);
+
+template <typename Precision = double>
+bool GenerateParametricShapeFrom3D
+(
+	MeshSpan& output,
+	glm::dvec3(*parametric_surface)(double, double),
+	int vertical_segments,
+	int rotation_segments,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+);
+
+/* Adaptive Generator Functions */
+// Same output as the vector versions above, but the grid lines are placed by the curvature instead of at uniform
+// steps. The t and r intervals are sized to an equal chord error on the probe lines, then halved where a quad is still
+// further than options.tolerance from the surface, so flat regions get few rows and columns. Normals come from the
+// neighbouring grid points.
+void GenerateAdaptiveShapeFrom2D
+(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec2(*parametric_line)(double),
+	const AdaptiveSamplingOptions& options = AdaptiveSamplingOptions()
+);
+
+void GenerateAdaptiveShapeFrom2Dv2
+(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec2(*parametric_line)(double),
+	const AdaptiveSamplingOptions& options = AdaptiveSamplingOptions()
+);
+
+void GenerateAdaptiveShapeFrom3D
+(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	glm::dvec3(*parametric_surface)(double, double),
+	const AdaptiveSamplingOptions& options = AdaptiveSamplingOptions()
 );
 
 /* Example 2D Parametric Functions */
-glm::dvec2 ParametricHalfCircle(double);
-glm::dvec2 ParametricCircle(double);
-glm::dvec2 ParametricSpikes(double);
-glm::dvec2 ParametricSpikyv2(double);
\ No newline at end of file
+inline glm::dvec2 ParametricHalfCircle(double t)
+{
+	glm::dvec2 p;
+	ParametricHalfCircleKernel()(t, p.x, p.y);
+	return p;
+}
+
+inline glm::dvec2 ParametricCircle(double t)
+{
+	glm::dvec2 p;
+	ParametricCircleKernel()(t, p.x, p.y);
+	return p;
+}
+
+inline glm::dvec2 ParametricSpikes(double t)
+{
+	glm::dvec2 p;
+	ParametricSpikesKernel()(t, p.x, p.y);
+	return p;
+}
+
+inline glm::dvec2 ParametricSpikyv2(double t)
+{
+	glm::dvec2 p;
+	ParametricSpikyv2Kernel()(t, p.x, p.y);
+	return p;
+}
+
+/* Example 3D Parametric Functions */
+// Surface of GenerateParametricShapeFrom2Dv2, profile_point is the 2D profile sampled at t
+inline glm::dvec3 ParametricSurfacev2(glm::dvec2 profile_point, double r)
+{
+	glm::dvec3 p;
+	ParametricSurfacev2Kernel()(profile_point.x, profile_point.y, r, p.x, p.y, p.z);
+	return p;
+}
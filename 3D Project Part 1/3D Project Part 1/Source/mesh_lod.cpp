@@ -0,0 +1,81 @@
+#include "mesh_lod.h"
+
+#include <algorithm>
+
+// Fewer segments than this do not resemble the surface anymore
+static const int lod_min_segments = 4;
+
+/* Level of Detail Chains */
+std::vector<LodLevel> PlanLodChain(int vertical_segments, int rotation_segments, const std::vector<int>& reductions)
+{
+	std::vector<LodLevel> levels;
+	for (auto reduction : reductions)
+	{
+		LodLevel level;
+		level.vertical_segments = std::max(vertical_segments / reduction, std::min(vertical_segments, lod_min_segments));
+		level.rotation_segments = std::max(rotation_segments / reduction, std::min(rotation_segments, lod_min_segments));
+
+		if (!levels.empty() && levels.back().vertical_segments == level.vertical_segments && levels.back().rotation_segments == level.rotation_segments)
+			continue;
+		levels.push_back(level);
+	}
+	return levels;
+}
+
+double GridMidpointError(const std::vector<glm::vec3>& positions, int vertical_segments, int rotation_segments, bool along_rotation)
+{
+	auto PositionAt = [&](int v, int r) -> glm::dvec3
+	{
+		return glm::dvec3(positions[size_t(r) * vertical_segments + v]);
+	};
+
+	double error = 0;
+	for (int r = 0; r < rotation_segments; ++r)
+		for (int v = 0; v < vertical_segments; ++v)
+		{
+			glm::dvec3 midpoint;
+			if (along_rotation)
+			{
+				if (r % 2 == 0)
+					continue;
+				midpoint = (PositionAt(v, r - 1) + PositionAt(v, (r + 1) % rotation_segments)) / 2.;
+			}
+			else
+			{
+				if (v % 2 == 0 || v == vertical_segments - 1)
+					continue;
+				midpoint = (PositionAt(v - 1, r) + PositionAt(v + 1, r)) / 2.;
+			}
+			error = std::max(error, glm::distance(PositionAt(v, r), midpoint));
+		}
+	return error;
+}
+
+/* Level of Detail Selection */
+double ProjectedPixelsPerUnit(const glm::mat4& transform, const glm::vec2& viewport_size)
+{
+	// Clip space to pixels is half the viewport, after the division by w
+	auto w = std::max(double(transform[3].w), 1e-6);
+	auto half_viewport = glm::dvec2(viewport_size) / 2.;
+
+	double pixels = 0;
+	for (int axis = 0; axis < 3; ++axis)
+		pixels = std::max(pixels, glm::length(glm::dvec2(transform[axis]) * half_viewport) / w);
+	return pixels;
+}
+
+int SelectLodLevel(const std::vector<LodLevel>& levels, double pixels_per_unit, const LodSelectionOptions& options, int current_level)
+{
+	int selected = 0;
+	for (int i = 1; i < int(levels.size()); ++i)
+	{
+		// Staying at the current level or refining takes the plain threshold, only coarsening has the margin
+		auto threshold = options.pixel_error;
+		if (current_level >= 0 && i > current_level)
+			threshold *= 1 - options.hysteresis;
+
+		if (levels[i].geometric_error * pixels_per_unit <= threshold)
+			selected = i;
+	}
+	return selected;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/*
+	Level of detail chains of the grid meshes. Level 0 is the mesh at full resolution, the following levels
+	sample the same surface with fewer segments. Every level knows its geometric error, the largest distance
+	between its triangles and the surface in object units. The model transform projects that error to pixels,
+	and the renderer draws the coarsest level that stays below a pixel threshold.
+*/
+
+/* Level of Detail Chains */
+struct LodLevel
+{
+	int vertical_segments;
+	int rotation_segments;
+
+	// Object space distance between the level and its surface, 0 until MeasureLodErrors
+	double geometric_error = 0;
+};
+
+// Level i divides the segment counts by reductions[i], down to at least 4 segments.
+// Levels with the same segment counts as the level before them are left out.
+std::vector<LodLevel> PlanLodChain(int vertical_segments, int rotation_segments, const std::vector<int>& reductions = { 1, 2, 4, 16 });
+
+// Largest distance of the odd rows (along_rotation) or odd columns of a vertical_segments x rotation_segments grid
+// from the midpoint of their even neighbours. Rows wrap around, columns do not.
+double GridMidpointError(const std::vector<glm::vec3>& positions, int vertical_segments, int rotation_segments, bool along_rotation);
+
+// Estimates the error of every level from the surface halfway between its vertices.
+// generate(vertical_segments, rotation_segments, positions, normals, indices) is the generator of the chain, it is called
+// with twice the vertices of a level along one direction and probe_count samples along the other.
+template <typename Generate>
+void MeasureLodErrors(std::vector<LodLevel>& levels, const Generate& generate, int probe_count = 16)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+	auto Probe = [&](int vertical_segments, int rotation_segments)
+	{
+		// The generators append to the vectors
+		positions.clear();
+		normals.clear();
+		indices.clear();
+		generate(vertical_segments, rotation_segments, positions, normals, indices);
+	};
+
+	for (auto& level : levels)
+	{
+		// 2V - 1 columns put a column between every two columns of the level, and 2R rows a row between its rows
+		auto probe_vertical = level.vertical_segments * 2 - 1;
+		Probe(probe_vertical, probe_count);
+		auto vertical_error = GridMidpointError(positions, probe_vertical, probe_count, false);
+
+		auto probe_rotation = level.rotation_segments * 2;
+		Probe(probe_count, probe_rotation);
+		auto rotation_error = GridMidpointError(positions, probe_count, probe_rotation, true);
+
+		level.geometric_error = glm::max(vertical_error, rotation_error);
+	}
+}
+
+/* Level of Detail Selection */
+struct LodSelectionOptions
+{
+	// Largest projected error in pixels of the level that is drawn
+	double pixel_error = 1;
+
+	// A coarser level than the current one has to be this fraction below pixel_error, so that objects
+	// close to the threshold do not switch levels every frame, 0 disables it
+	double hysteresis = 0.25;
+};
+
+// Pixels one object space unit covers at the origin of transform, for a viewport of viewport_size pixels.
+// The longest projected axis counts, the change of perspective across the object is ignored.
+double ProjectedPixelsPerUnit(const glm::mat4& transform, const glm::vec2& viewport_size);
+
+// Coarsest level with a projected error within options.pixel_error, level 0 when there is none.
+// current_level is the level selected in the previous frame, -1 when there is none yet.
+int SelectLodLevel(const std::vector<LodLevel>& levels, double pixels_per_unit, const LodSelectionOptions& options, int current_level = -1);
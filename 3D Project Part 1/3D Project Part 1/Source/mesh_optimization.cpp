@@ -0,0 +1,608 @@
+#include "mesh_optimization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+/* Vertex Cache Analysis */
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, int cache_size)
+{
+	// A FIFO cache as a counter per vertex: it is still cached while its load is one of the last cache_size loads
+	std::vector<size_t> loaded_at(vertex_count, 0);
+	std::vector<bool> referenced(vertex_count, false);
+	size_t misses = 0;
+	size_t referenced_count = 0;
+
+	for (auto index : indices)
+	{
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			++referenced_count;
+		}
+		else if (misses - loaded_at[index] <= size_t(cache_size))
+		{
+			continue;
+		}
+
+		loaded_at[index] = misses++;
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.acmr = indices.empty() ? 0 : double(misses) / (indices.size() / 3);
+	statistics.atvr = referenced_count == 0 ? 0 : double(misses) / referenced_count;
+	return statistics;
+}
+
+/* Overdraw Analysis */
+OverdrawStatistics AnalyzeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices, int resolution)
+{
+	OverdrawStatistics statistics = {};
+	if (positions.empty() || indices.empty() || resolution <= 0)
+		return statistics;
+
+	// Every view sees the sphere around the middle of the box
+	glm::dvec3 min(positions[0]), max(positions[0]);
+	for (auto& position : positions)
+	{
+		min = glm::min(min, glm::dvec3(position));
+		max = glm::max(max, glm::dvec3(position));
+	}
+	auto center = (min + max) / 2.;
+	auto radius = std::max(glm::distance(min, max) / 2, std::numeric_limits<double>::min());
+	auto scale = resolution / (2 * radius);
+
+	std::vector<glm::dvec3> directions;
+	for (int axis = 0; axis < 3; ++axis)
+		for (auto sign : { -1., 1. })
+		{
+			glm::dvec3 direction(0);
+			direction[axis] = sign;
+			directions.push_back(direction);
+		}
+	for (int corner = 0; corner < 8; ++corner)
+		directions.push_back(glm::normalize(glm::dvec3(corner & 1 ? 1 : -1, corner & 2 ? 1 : -1, corner & 4 ? 1 : -1)));
+
+	std::vector<float> depth(size_t(resolution) * resolution);
+	std::vector<glm::dvec3> projected(positions.size());
+	for (auto& direction : directions)
+	{
+		auto up = std::abs(direction.y) < 0.9 ? glm::dvec3(0, 1, 0) : glm::dvec3(1, 0, 0);
+		auto right = glm::normalize(glm::cross(up, direction));
+		up = glm::cross(direction, right);
+		for (size_t v = 0; v < positions.size(); ++v)
+		{
+			auto offset = glm::dvec3(positions[v]) - center;
+			projected[v] = glm::dvec3((glm::dot(offset, right) + radius) * scale, (glm::dot(offset, up) + radius) * scale, glm::dot(offset, direction));
+		}
+
+		std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			auto a = projected[indices[i]];
+			auto b = projected[indices[i + 1]];
+			auto c = projected[indices[i + 2]];
+			auto area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+			if (area == 0)
+				continue;
+			if (area < 0)
+			{
+				std::swap(b, c);
+				area = -area;
+			}
+
+			// Pixel centers inside the triangle, by their barycentric weights
+			auto x_begin = std::max(0, int(std::ceil(std::min({ a.x, b.x, c.x }) - 0.5)));
+			auto x_end = std::min(resolution - 1, int(std::floor(std::max({ a.x, b.x, c.x }) - 0.5)));
+			auto y_begin = std::max(0, int(std::ceil(std::min({ a.y, b.y, c.y }) - 0.5)));
+			auto y_end = std::min(resolution - 1, int(std::floor(std::max({ a.y, b.y, c.y }) - 0.5)));
+			for (int y = y_begin; y <= y_end; ++y)
+				for (int x = x_begin; x <= x_end; ++x)
+				{
+					auto px = x + 0.5, py = y + 0.5;
+					auto wa = (b.x - px) * (c.y - py) - (b.y - py) * (c.x - px);
+					auto wb = (c.x - px) * (a.y - py) - (c.y - py) * (a.x - px);
+					auto wc = area - wa - wb;
+					if (wa < 0 || wb < 0 || wc < 0)
+						continue;
+
+					auto z = float((wa * a.z + wb * b.z + wc * c.z) / area);
+					auto& pixel = depth[size_t(y) * resolution + x];
+					if (z < pixel)
+					{
+						if (pixel == std::numeric_limits<float>::infinity())
+							++statistics.covered_pixels;
+						pixel = z;
+						++statistics.shaded_fragments;
+					}
+				}
+		}
+	}
+
+	statistics.overdraw = statistics.covered_pixels == 0 ? 0 : double(statistics.shaded_fragments) / statistics.covered_pixels;
+	return statistics;
+}
+
+/* Vertex Welding */
+// Cell of the spatial hash, the cells are twice as large as the position tolerance
+static glm::ivec3 WeldCell(const glm::vec3& position, float cell_size)
+{
+	return glm::ivec3(glm::floor(position / cell_size));
+}
+
+static std::uint64_t WeldCellKey(const glm::ivec3& cell)
+{
+	// Colliding cells only cost extra distance checks
+	return std::uint64_t(std::uint32_t(cell.x)) * 73856093u ^ std::uint64_t(std::uint32_t(cell.y)) * 19349663u
+		^ std::uint64_t(std::uint32_t(cell.z)) * 83492791u;
+}
+
+// End of a chain of kept vertices, or an empty slot of the cell table
+static const GLuint weld_none = 0xFFFFFFFF;
+
+// Open addressing table from cell key to the first kept vertex of the cell, std::unordered_map
+// spent most of the welding time allocating its nodes
+struct WeldCellTable
+{
+	std::vector<std::uint64_t> keys;
+	std::vector<GLuint> heads;
+	size_t mask;
+
+	explicit WeldCellTable(size_t cell_count)
+	{
+		size_t size = 16;
+		while (size < cell_count * 2)
+			size *= 2;
+		keys.resize(size);
+		heads.assign(size, weld_none);
+		mask = size - 1;
+	}
+
+	// Slot of key, or the empty slot where it would be inserted
+	size_t Find(std::uint64_t key) const
+	{
+		auto slot = size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+		while (heads[slot] != weld_none && keys[slot] != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+};
+
+WeldStatistics WeldVertices(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, const WeldTolerance& tolerance)
+{
+	WeldStatistics statistics;
+	statistics.vertices_before = positions.size();
+
+	// With cells of twice the tolerance, the vertices within it are in the cell or the neighbour on the nearer side
+	auto cell_size = std::max(2 * tolerance.position, std::numeric_limits<float>::min());
+	auto max_distance_squared = tolerance.position * tolerance.position;
+	auto min_normal_dot = std::cos(glm::radians(tolerance.normal_degrees));
+
+	// First kept vertex of every cell, the kept vertices of a cell are chained through next_in_cell
+	WeldCellTable cells(positions.size());
+	std::vector<GLuint> next_in_cell;
+	next_in_cell.reserve(positions.size());
+
+	std::vector<GLuint> remap(positions.size());
+	std::vector<GLuint> kept;
+	kept.reserve(positions.size());
+
+	auto find_match = [&](const glm::ivec3& cell, size_t v)
+	{
+		for (auto k = cells.heads[cells.Find(WeldCellKey(cell))]; k != weld_none; k = next_in_cell[k])
+		{
+			auto other = kept[k];
+			auto offset = positions[other] - positions[v];
+			if (glm::dot(offset, offset) <= max_distance_squared && glm::dot(normals[other], normals[v]) >= min_normal_dot)
+				return k;
+		}
+		return weld_none;
+	};
+
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		// A vertex within the tolerance is at most one cell away, on the side of the nearer cell border
+		auto scaled = positions[v] / cell_size;
+		auto cell = WeldCell(positions[v], cell_size);
+		glm::ivec3 side;
+		for (int axis = 0; axis < 3; ++axis)
+			side[axis] = scaled[axis] - float(cell[axis]) < 0.5f ? -1 : 1;
+
+		auto match = weld_none;
+		for (int corner = 0; corner < 8 && match == weld_none; ++corner)
+			match = find_match(cell + glm::ivec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1) * side, v);
+
+		if (match != weld_none)
+		{
+			remap[v] = match;
+			continue;
+		}
+
+		auto k = GLuint(kept.size());
+		kept.push_back(GLuint(v));
+		remap[v] = k;
+
+		auto key = WeldCellKey(cell);
+		auto slot = cells.Find(key);
+		cells.keys[slot] = key;
+		next_in_cell.push_back(cells.heads[slot]);
+		cells.heads[slot] = k;
+	}
+
+	for (auto& index : indices)
+		index = remap[index];
+
+	// Kept vertices are in input order, so compacting in place never overwrites a vertex that is still needed
+	for (size_t k = 0; k < kept.size(); ++k)
+	{
+		positions[k] = positions[kept[k]];
+		normals[k] = normals[kept[k]];
+	}
+	positions.resize(kept.size());
+	normals.resize(kept.size());
+
+	statistics.vertices_after = kept.size();
+	return statistics;
+}
+
+/* Degenerate Triangles */
+DegenerateStatistics RemoveDegenerateTriangles(const std::vector<glm::vec3>& positions, std::vector<GLuint>& indices, float height_tolerance)
+{
+	DegenerateStatistics statistics = { indices.size() / 3, 0, 0 };
+
+	size_t kept = 0;
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		auto a = indices[t], b = indices[t + 1], c = indices[t + 2];
+		if (a == b || b == c || c == a)
+		{
+			++statistics.repeated_index;
+			continue;
+		}
+
+		// |cross| is the longest edge times the height, a point or a line has no height
+		auto ab = positions[b] - positions[a];
+		auto ac = positions[c] - positions[a];
+		auto bc = positions[c] - positions[b];
+		auto longest_edge_squared = std::max({ glm::dot(ab, ab), glm::dot(ac, ac), glm::dot(bc, bc) });
+		if (glm::length(glm::cross(ab, ac)) <= height_tolerance * longest_edge_squared)
+		{
+			++statistics.zero_area;
+			continue;
+		}
+
+		indices[kept++] = a;
+		indices[kept++] = b;
+		indices[kept++] = c;
+	}
+
+	indices.resize(kept);
+	return statistics;
+}
+
+/* Mesh Optimization */
+// Entries of the LRU cache the triangle order is scored against, Forsyth's recommended size
+static const int forsyth_cache_size = 32;
+
+// Valences up to this size are looked up in a table, grid vertices have six triangles
+static const int forsyth_valence_table_size = 32;
+
+struct ForsythScoreTables
+{
+	float cache[forsyth_cache_size];
+	float valence[forsyth_valence_table_size];
+
+	ForsythScoreTables()
+	{
+		// The vertices of the last triangle are used by the next one anyway, they get a fixed score
+		for (int position = 0; position < forsyth_cache_size; ++position)
+			cache[position] = position < 3 ? 0.75f : std::pow(1.f - float(position - 3) / (forsyth_cache_size - 3), 1.5f);
+
+		// Boost vertices with few triangles left, so they are finished before they fall out of the cache
+		valence[0] = 0;
+		for (int remaining = 1; remaining < forsyth_valence_table_size; ++remaining)
+			valence[remaining] = 2.f / std::sqrt(float(remaining));
+	}
+};
+
+// Score of a vertex with remaining_triangles unemitted triangles at cache_position, -1 when it is not cached
+static float ForsythVertexScore(const ForsythScoreTables& tables, int cache_position, int remaining_triangles)
+{
+	if (remaining_triangles == 0)
+		return -1.f;
+
+	auto score = cache_position >= 0 ? tables.cache[cache_position] : 0.f;
+	if (remaining_triangles < forsyth_valence_table_size)
+		return score + tables.valence[remaining_triangles];
+	return score + 2.f / std::sqrt(float(remaining_triangles));
+}
+
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count)
+{
+	auto triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return;
+
+	// Triangles of every vertex, the first remaining_triangles[v] entries of a vertex are the unemitted ones
+	std::vector<size_t> adjacency_offsets(vertex_count + 1, 0);
+	for (auto index : indices)
+		++adjacency_offsets[index + 1];
+	for (size_t v = 0; v < vertex_count; ++v)
+		adjacency_offsets[v + 1] += adjacency_offsets[v];
+
+	std::vector<int> remaining_triangles(vertex_count, 0);
+	std::vector<GLuint> adjacency(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		auto v = indices[i];
+		adjacency[adjacency_offsets[v] + remaining_triangles[v]++] = GLuint(i / 3);
+	}
+
+	const ForsythScoreTables tables;
+	std::vector<int> cache_positions(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+		vertex_scores[v] = ForsythVertexScore(tables, -1, remaining_triangles[v]);
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool> emitted(triangle_count, false);
+	for (size_t t = 0; t < triangle_count; ++t)
+		triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+
+	// The first triangle is the best one overall, after that only triangles around the cache are considered
+	auto best_triangle = size_t(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+	size_t input_cursor = 0;
+
+	std::vector<GLuint> cache, next_cache;
+	cache.reserve(forsyth_cache_size + 3);
+	next_cache.reserve(forsyth_cache_size + 3);
+
+	std::vector<GLuint> output(indices.size());
+	for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count)
+	{
+		// Nothing around the cache is left, continue with the next unemitted triangle in input order
+		if (best_triangle == triangle_count)
+		{
+			while (emitted[input_cursor])
+				++input_cursor;
+			best_triangle = input_cursor;
+		}
+
+		auto triangle = &indices[best_triangle * 3];
+		std::copy(triangle, triangle + 3, output.begin() + emitted_count * 3);
+		emitted[best_triangle] = true;
+
+		// Take the triangle out of the adjacency of its vertices
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			auto v = triangle[corner];
+			auto begin = adjacency.begin() + adjacency_offsets[v];
+			auto end = begin + remaining_triangles[v];
+			auto found = std::find(begin, end, GLuint(best_triangle));
+			std::iter_swap(found, end - 1);
+			--remaining_triangles[v];
+		}
+
+		// The triangle's vertices move to the front of the LRU cache
+		next_cache.assign(triangle, triangle + 3);
+		for (auto v : cache)
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				next_cache.push_back(v);
+
+		// Rescore every vertex that was or is in the cache, the ones pushed out of it lose their cache score
+		for (size_t i = 0; i < next_cache.size(); ++i)
+		{
+			auto v = next_cache[i];
+			cache_positions[v] = i < size_t(forsyth_cache_size) ? int(i) : -1;
+
+			auto score = ForsythVertexScore(tables, cache_positions[v], remaining_triangles[v]);
+			auto score_change = score - vertex_scores[v];
+			vertex_scores[v] = score;
+
+			auto begin = adjacency.begin() + adjacency_offsets[v];
+			for (auto adjacent = begin; adjacent != begin + remaining_triangles[v]; ++adjacent)
+				triangle_scores[*adjacent] += score_change;
+		}
+
+		if (next_cache.size() > size_t(forsyth_cache_size))
+			next_cache.resize(forsyth_cache_size);
+		std::swap(cache, next_cache);
+
+		// The next triangle is the best one around the cache
+		best_triangle = triangle_count;
+		float best_score = -1;
+		for (auto v : cache)
+		{
+			auto begin = adjacency.begin() + adjacency_offsets[v];
+			for (auto adjacent = begin; adjacent != begin + remaining_triangles[v]; ++adjacent)
+				if (triangle_scores[*adjacent] > best_score)
+				{
+					best_score = triangle_scores[*adjacent];
+					best_triangle = *adjacent;
+				}
+		}
+	}
+
+	indices.swap(output);
+}
+
+void OptimizeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, float threshold)
+{
+	auto triangle_count = indices.size() / 3;
+	if (triangle_count == 0)
+		return;
+
+	// The FIFO cache of AnalyzeVertexCache, moving the time past every load empties it
+	const size_t cache_size = 16;
+	std::vector<size_t> loaded_at(positions.size(), 0);
+	size_t time = cache_size + 1;
+	auto Misses = [&](size_t triangle)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			auto v = indices[triangle * 3 + corner];
+			if (time - loaded_at[v] > cache_size)
+			{
+				loaded_at[v] = time++;
+				++misses;
+			}
+		}
+		return misses;
+	};
+	auto Flush = [&]()
+	{
+		time += cache_size + 1;
+	};
+
+	// The cache order jumps to another part of the mesh where a triangle misses all its vertices
+	std::vector<size_t> hard_boundaries;
+	for (size_t t = 0; t < triangle_count; ++t)
+		if (Misses(t) == 3 || t == 0)
+			hard_boundaries.push_back(t);
+	hard_boundaries.push_back(triangle_count);
+
+	// A cluster ends as soon as it reaches the ACMR its part of the list allows on its own
+	std::vector<size_t> cluster_starts;
+	for (size_t h = 0; h + 1 < hard_boundaries.size(); ++h)
+	{
+		auto start = hard_boundaries[h];
+		auto end = hard_boundaries[h + 1];
+
+		Flush();
+		size_t part_misses = 0;
+		for (auto t = start; t < end; ++t)
+			part_misses += Misses(t);
+		auto max_acmr = threshold * double(part_misses) / double(end - start);
+
+		Flush();
+		cluster_starts.push_back(start);
+		size_t misses = 0;
+		size_t triangles = 0;
+		for (auto t = start; t + 1 < end; ++t)
+		{
+			misses += Misses(t);
+			++triangles;
+			if (double(misses) <= max_acmr * double(triangles))
+			{
+				cluster_starts.push_back(t + 1);
+				Flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+	}
+	cluster_starts.push_back(triangle_count);
+
+	// Area weighted centroid and front facing normal of every cluster, and the centroid of the whole mesh
+	auto cluster_count = cluster_starts.size() - 1;
+	std::vector<glm::dvec3> centroids(cluster_count, glm::dvec3(0));
+	std::vector<glm::dvec3> cluster_normals(cluster_count, glm::dvec3(0));
+	std::vector<double> areas(cluster_count, 0);
+	glm::dvec3 mesh_centroid(0);
+	double mesh_area = 0;
+	for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+	{
+		for (auto t = cluster_starts[cluster]; t < cluster_starts[cluster + 1]; ++t)
+		{
+			auto a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+			glm::dvec3 pa(positions[a]), pb(positions[b]), pc(positions[c]);
+			auto normal = glm::cross(pb - pa, pc - pa);
+			auto area = glm::length(normal);
+			if (glm::dot(normal, glm::dvec3(normals[a] + normals[b] + normals[c])) < 0)
+				normal = -normal;
+
+			centroids[cluster] += (pa + pb + pc) * (area / 3);
+			cluster_normals[cluster] += normal;
+			areas[cluster] += area;
+		}
+		mesh_centroid += centroids[cluster];
+		mesh_area += areas[cluster];
+	}
+	if (mesh_area > 0)
+		mesh_centroid /= mesh_area;
+
+	std::vector<double> occlusion(cluster_count, 0);
+	for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+	{
+		auto length = glm::length(cluster_normals[cluster]);
+		if (areas[cluster] > 0 && length > 0)
+			occlusion[cluster] = glm::dot(centroids[cluster] / areas[cluster] - mesh_centroid, cluster_normals[cluster] / length);
+	}
+
+	std::vector<size_t> order(cluster_count);
+	for (size_t cluster = 0; cluster < cluster_count; ++cluster)
+		order[cluster] = cluster;
+	std::stable_sort(order.begin(), order.end(), [&occlusion](size_t a, size_t b)
+	{
+		return occlusion[a] > occlusion[b];
+	});
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	for (auto cluster : order)
+		output.insert(output.end(), indices.begin() + cluster_starts[cluster] * 3, indices.begin() + cluster_starts[cluster + 1] * 3);
+	indices.swap(output);
+}
+
+void OptimizeVertexFetch(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices)
+{
+	const GLuint unassigned = 0xFFFFFFFF;
+	std::vector<GLuint> remap(positions.size(), unassigned);
+
+	GLuint next_vertex = 0;
+	for (auto& index : indices)
+	{
+		if (remap[index] == unassigned)
+			remap[index] = next_vertex++;
+		index = remap[index];
+	}
+
+	for (auto& new_index : remap)
+		if (new_index == unassigned)
+			new_index = next_vertex++;
+
+	std::vector<glm::vec3> reordered_positions(positions.size());
+	std::vector<glm::vec3> reordered_normals(normals.size());
+	for (size_t v = 0; v < positions.size(); ++v)
+	{
+		reordered_positions[remap[v]] = positions[v];
+		reordered_normals[remap[v]] = normals[v];
+	}
+
+	positions.swap(reordered_positions);
+	normals.swap(reordered_normals);
+}
+
+void OptimizeMesh(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, bool print_statistics,
+	float overdraw_threshold)
+{
+	auto overdraw = overdraw_threshold > 0;
+	auto before = AnalyzeVertexCache(indices, positions.size());
+	OverdrawStatistics overdraw_before = {};
+	if (print_statistics && overdraw)
+		overdraw_before = AnalyzeOverdraw(positions, indices);
+
+	OptimizeVertexCache(indices, positions.size());
+	if (overdraw)
+		OptimizeOverdraw(positions, normals, indices, overdraw_threshold);
+	OptimizeVertexFetch(positions, normals, indices);
+
+	if (!print_statistics)
+		return;
+
+	auto after = AnalyzeVertexCache(indices, positions.size());
+	auto flags = std::cout.flags();
+	auto precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(3)
+		<< "Vertex cache optimization of " << indices.size() / 3 << " triangles: ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	if (overdraw)
+		std::cout << "Overdraw optimization of " << indices.size() / 3 << " triangles: " << overdraw_before.overdraw << " -> "
+			<< AnalyzeOverdraw(positions, indices).overdraw << " shaded fragments per pixel" << std::endl;
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
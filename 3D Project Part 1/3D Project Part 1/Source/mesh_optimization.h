@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/*
+	Post-generation passes over triangle list meshes, between the generators and VAO.
+	They work on the separate position, normal and index vectors the generators fill.
+*/
+
+/* Vertex Cache Analysis */
+struct VertexCacheStatistics
+{
+	double acmr;	// Average cache miss ratio, transformed vertices per triangle, 0.5 is the limit for a large grid
+	double atvr;	// Average transformed vertex ratio, transformed vertices per referenced vertex, 1 is ideal
+};
+
+// Simulates a FIFO post-transform cache of cache_size entries over the triangle list
+VertexCacheStatistics AnalyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, int cache_size = 16);
+
+/* Overdraw Analysis */
+struct OverdrawStatistics
+{
+	size_t covered_pixels;
+	size_t shaded_fragments;	// Fragments that passed the depth test when they were drawn
+	double overdraw;			// Shaded fragments per covered pixel, 1 is ideal
+};
+
+// Rasterizes the triangles in order with a depth test from the six axis directions and the eight diagonals,
+// orthographic at resolution x resolution over the bounds. Both sides are drawn, like the renderer does.
+OverdrawStatistics AnalyzeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<GLuint>& indices, int resolution = 256);
+
+/* Vertex Welding */
+// Vertices closer than position and with normals closer than normal_degrees are merged.
+// Vertices at the same position with different normals stay separate, they are shading seams.
+struct WeldTolerance
+{
+	float position = 1e-5f;
+	float normal_degrees = 1.f;
+};
+
+struct WeldStatistics
+{
+	size_t vertices_before;
+	size_t vertices_after;
+};
+
+// Merges coincident vertices with a spatial hash, like the t = 0 and t = 1 columns of closed profiles
+// and the pole rows of ParametricHalfCircle. Merged vertices keep the first vertex in the input order.
+// Triangles are kept, merging can leave some of them degenerate.
+WeldStatistics WeldVertices(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, const WeldTolerance& tolerance = WeldTolerance());
+
+/* Degenerate Triangles */
+struct DegenerateStatistics
+{
+	size_t triangles_before;
+	size_t repeated_index;	// Triangles that use one vertex twice
+	size_t zero_area;		// Triangles with three vertices on one point or line
+};
+
+// Removes the triangles without area from a triangle list, they cost rasterizer setup and still draw as lines
+// in wireframe. A triangle has no area when its height is at most height_tolerance times its longest edge.
+DegenerateStatistics RemoveDegenerateTriangles(const std::vector<glm::vec3>& positions, std::vector<GLuint>& indices, float height_tolerance = 1e-6f);
+
+/* Mesh Optimization */
+// Reorders the triangles for post-transform cache reuse, with Tom Forsyth's linear-speed algorithm
+void OptimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count);
+
+// Renumbers the vertices in the order the triangles first use them, so vertex fetches walk the buffers forward.
+// Vertices no triangle references are kept, after the referenced ones.
+void OptimizeVertexFetch(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices);
+
+// Reorders a vertex cache optimized triangle list so the triangles that hide others are drawn first, as in Sander,
+// Nehab and Barczak's fast triangle reordering. The list is cut into clusters where the cache starts over, and
+// again wherever a cluster drawn on its own keeps its ACMR within threshold times that of its part of the list.
+// The clusters are sorted by how far their surface faces out of the middle of the mesh, those occlude most of
+// the mesh from most directions. The fronts are the sides the vertex normals point to.
+void OptimizeOverdraw(const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, float threshold = 1.05f);
+
+// OptimizeVertexCache, then OptimizeOverdraw when overdraw_threshold is above 0, then OptimizeVertexFetch.
+// Prints ACMR and ATVR before and after when print_statistics is set.
+void OptimizeMesh(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices, bool print_statistics = false,
+	float overdraw_threshold = 0);
@@ -0,0 +1,474 @@
+#include "mesh_simplification.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include "mesh_generation.h"
+
+/* Quadrics */
+// Weighted sum of squared distances to planes, p^T A p + 2 b.p + c with the symmetric A as its upper triangle
+struct Quadric
+{
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+
+	// Total weight of the planes, the error divides by it to stay a distance
+	double weight;
+};
+
+// Plane through point with the unit normal, weighted by the area of its triangle
+static Quadric PlaneQuadric(const glm::dvec3& normal, const glm::dvec3& point, double weight)
+{
+	auto d = -glm::dot(normal, point);
+	Quadric quadric;
+	quadric.a00 = normal.x * normal.x * weight;
+	quadric.a01 = normal.x * normal.y * weight;
+	quadric.a02 = normal.x * normal.z * weight;
+	quadric.a11 = normal.y * normal.y * weight;
+	quadric.a12 = normal.y * normal.z * weight;
+	quadric.a22 = normal.z * normal.z * weight;
+	quadric.b0 = normal.x * d * weight;
+	quadric.b1 = normal.y * d * weight;
+	quadric.b2 = normal.z * d * weight;
+	quadric.c = d * d * weight;
+	quadric.weight = weight;
+	return quadric;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a00 += other.a00;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a11 += other.a11;
+	quadric.a12 += other.a12;
+	quadric.a22 += other.a22;
+	quadric.b0 += other.b0;
+	quadric.b1 += other.b1;
+	quadric.b2 += other.b2;
+	quadric.c += other.c;
+	quadric.weight += other.weight;
+}
+
+// Root mean square distance of point from the planes of both quadrics
+static double QuadricError(const Quadric& first, const Quadric& second, const glm::dvec3& point)
+{
+	auto x = point.x;
+	auto y = point.y;
+	auto z = point.z;
+	auto Evaluate = [x, y, z](const Quadric& q)
+	{
+		return q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+			+ 2 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+	};
+
+	auto weight = first.weight + second.weight;
+	if (weight <= 0)
+		return 0;
+	return std::sqrt(std::max(Evaluate(first) + Evaluate(second), 0.) / weight);
+}
+
+/* Adjacency */
+// Triangles around every vertex, those of vertex v are triangles[offsets[v]] up to triangles[offsets[v + 1]]
+static void BuildAdjacency(const std::vector<GLuint>& indices, size_t vertex_count, std::vector<GLuint>& offsets, std::vector<GLuint>& triangles)
+{
+	offsets.assign(vertex_count + 1, 0);
+	for (auto index : indices)
+		++offsets[index + 1];
+	for (size_t v = 0; v < vertex_count; ++v)
+		offsets[v + 1] += offsets[v];
+
+	// Counting sort, offsets[v] runs up to the end of the range of v and is moved back afterwards
+	triangles.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); ++i)
+		triangles[offsets[indices[i]]++] = GLuint(i / 3);
+	for (size_t v = vertex_count; v > 0; --v)
+		offsets[v] = offsets[v - 1];
+	offsets[0] = 0;
+}
+
+/* Collapse Passes */
+// Part of the mesh in its own vertex numbering
+struct SimplificationPart
+{
+	std::vector<GLuint> vertices;	// Vertex of the whole mesh of every local vertex
+	std::vector<glm::dvec3> positions;
+	std::vector<Quadric> quadrics;
+	std::vector<std::uint8_t> locked;
+	std::vector<GLuint> indices;
+
+	double error = 0;
+};
+
+struct EdgeCollapse
+{
+	double error;
+	GLuint from;
+	GLuint to;
+};
+
+// False when moving from onto the position of to turns one of the triangles around from that remain
+static bool KeepsOrientation(const SimplificationPart& part, const std::vector<GLuint>& offsets, const std::vector<GLuint>& adjacency, GLuint from, GLuint to)
+{
+	for (auto i = offsets[from]; i < offsets[from + 1]; ++i)
+	{
+		auto triangle = &part.indices[size_t(adjacency[i]) * 3];
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+			continue;
+
+		glm::dvec3 corners[3];
+		for (int k = 0; k < 3; ++k)
+			corners[k] = part.positions[triangle[k]];
+		auto before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+		for (int k = 0; k < 3; ++k)
+			if (triangle[k] == from)
+				corners[k] = part.positions[to];
+		auto after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+		if (glm::dot(before, after) <= 0)
+			return false;
+	}
+	return true;
+}
+
+// Collapses edges in passes until the part has target_triangles or no collapse within max_error is left.
+// A pass makes the cheapest collapses whose triangles no other collapse of the pass has touched.
+// The passes also stop once one removes fewer than min_removed triangles.
+static void SimplifyPart(SimplificationPart& part, size_t target_triangles, double max_error, size_t min_removed = 1)
+{
+	auto vertex_count = part.positions.size();
+	std::vector<GLuint> offsets;
+	std::vector<GLuint> adjacency;
+	std::vector<std::uint8_t> touched(vertex_count);
+	std::vector<GLuint> remap(vertex_count);
+	std::vector<EdgeCollapse> collapses;
+	auto error_limit = max_error > 0 ? max_error : std::numeric_limits<double>::max();
+	auto never = std::numeric_limits<double>::infinity();
+
+	while (part.indices.size() / 3 > target_triangles)
+	{
+		auto triangle_count = part.indices.size() / 3;
+		BuildAdjacency(part.indices, vertex_count, offsets, adjacency);
+
+		// Every inner edge is in two triangles, once in each direction, boundary edges only have locked vertices
+		collapses.clear();
+		for (size_t i = 0; i < part.indices.size(); ++i)
+		{
+			auto a = part.indices[i];
+			auto b = part.indices[i % 3 == 2 ? i - 2 : i + 1];
+			if (a > b || (part.locked[a] && part.locked[b]))
+				continue;
+
+			auto error_to_b = part.locked[a] ? never : QuadricError(part.quadrics[a], part.quadrics[b], part.positions[b]);
+			auto error_to_a = part.locked[b] ? never : QuadricError(part.quadrics[a], part.quadrics[b], part.positions[a]);
+			if (error_to_b <= error_to_a && error_to_b <= error_limit)
+				collapses.push_back(EdgeCollapse{ error_to_b, a, b });
+			else if (error_to_a < error_to_b && error_to_a <= error_limit)
+				collapses.push_back(EdgeCollapse{ error_to_a, b, a });
+		}
+
+		// A collapse removes about two triangles and many candidates touch an earlier one, the cheapest excess of them
+		// are enough for a pass
+		auto excess = triangle_count - target_triangles;
+		auto candidates = std::min(collapses.size(), excess);
+		auto by_error = [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.error < b.error; };
+		std::nth_element(collapses.begin(), collapses.begin() + candidates, collapses.end(), by_error);
+		std::sort(collapses.begin(), collapses.begin() + candidates, by_error);
+
+		std::fill(touched.begin(), touched.end(), std::uint8_t(0));
+		std::iota(remap.begin(), remap.end(), GLuint(0));
+		size_t removed = 0;
+		for (size_t c = 0; c < collapses.size() && removed < excess; ++c)
+		{
+			// Near the target the cheapest few can all turn triangles over, the others are sorted only then
+			if (c == candidates)
+			{
+				if (removed > 0)
+					break;
+				std::sort(collapses.begin() + candidates, collapses.end(), by_error);
+			}
+
+			auto& collapse = collapses[c];
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+			if (!KeepsOrientation(part, offsets, adjacency, collapse.from, collapse.to))
+				continue;
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(part.quadrics[collapse.to], part.quadrics[collapse.from]);
+			part.error = std::max(part.error, collapse.error);
+
+			// The triangles around from change, none of their vertices takes part in another collapse of this pass
+			for (auto i = offsets[collapse.from]; i < offsets[collapse.from + 1]; ++i)
+			{
+				auto triangle = &part.indices[size_t(adjacency[i]) * 3];
+				for (int k = 0; k < 3; ++k)
+					touched[triangle[k]] = 1;
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+					++removed;
+			}
+		}
+		if (removed == 0)
+			break;
+
+		size_t write = 0;
+		for (size_t i = 0; i < part.indices.size(); i += 3)
+		{
+			auto a = remap[part.indices[i]];
+			auto b = remap[part.indices[i + 1]];
+			auto c = remap[part.indices[i + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+			part.indices[write++] = a;
+			part.indices[write++] = b;
+			part.indices[write++] = c;
+		}
+		part.indices.resize(write);
+		if (removed < min_removed)
+			break;
+	}
+}
+
+/* Mesh Simplification */
+// The slabs stop at this multiple of target_triangles, the whole mesh makes the rest of the collapses
+static const size_t partition_slack = 4;
+
+// Error limit of the first round of the slabs, as a fraction of the bounding box diagonal
+static const double partition_first_error = 1e-5;
+
+// A round of a slab ends with a pass that removes fewer than this fraction of its triangles, the next round picks up
+// the collapses that are left
+static const size_t partition_min_progress = 64;
+
+// Locks the vertices of boundary edges, the edges that no other triangle shares
+static void LockBoundaries(const std::vector<GLuint>& indices, size_t vertex_count, std::vector<std::uint8_t>& locked)
+{
+	std::vector<GLuint> offsets;
+	std::vector<GLuint> adjacency;
+	BuildAdjacency(indices, vertex_count, offsets, adjacency);
+
+	for (size_t triangle = 0; triangle < indices.size() / 3; ++triangle)
+		for (int k = 0; k < 3; ++k)
+		{
+			auto a = indices[triangle * 3 + k];
+			auto b = indices[triangle * 3 + (k + 1) % 3];
+
+			bool shared = false;
+			for (auto i = offsets[b]; i < offsets[b + 1] && !shared; ++i)
+			{
+				auto other = &indices[size_t(adjacency[i]) * 3];
+				shared = adjacency[i] != triangle && (other[0] == a || other[1] == a || other[2] == a);
+			}
+			if (!shared)
+				locked[a] = locked[b] = 1;
+		}
+}
+
+// Locks vertices that have the same position as another vertex, seams that split normals and unwelded poles
+static void LockCoincidentVertices(const std::vector<glm::vec3>& positions, std::vector<std::uint8_t>& locked)
+{
+	std::vector<GLuint> order(positions.size());
+	std::iota(order.begin(), order.end(), GLuint(0));
+	auto less = [&positions](GLuint a, GLuint b)
+	{
+		auto& p = positions[a];
+		auto& q = positions[b];
+		return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+	};
+	std::sort(order.begin(), order.end(), less);
+
+	for (size_t i = 1; i < order.size(); ++i)
+		if (positions[order[i]] == positions[order[i - 1]])
+			locked[order[i]] = locked[order[i - 1]] = 1;
+}
+
+SimplificationStatistics SimplifyMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	const SimplificationOptions& options
+)
+{
+	SimplificationStatistics statistics;
+	statistics.triangles_before = indices.size() / 3;
+	statistics.vertices_before = positions.size();
+	statistics.triangles_after = statistics.triangles_before;
+	statistics.vertices_after = statistics.vertices_before;
+	statistics.error = 0;
+	statistics.partitions = 1;
+	if (options.target_triangles == 0 && options.max_error <= 0)
+		return statistics;
+
+	auto vertex_count = positions.size();
+	auto triangle_count = indices.size() / 3;
+
+	// Area weighted planes of the triangles around every vertex
+	std::vector<Quadric> quadrics(vertex_count, Quadric());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		glm::dvec3 a = positions[indices[i]];
+		auto normal = glm::cross(glm::dvec3(positions[indices[i + 1]]) - a, glm::dvec3(positions[indices[i + 2]]) - a);
+		auto length = glm::length(normal);
+		if (length == 0)
+			continue;
+
+		auto quadric = PlaneQuadric(normal / length, a, length / 2);
+		for (int k = 0; k < 3; ++k)
+			AddQuadric(quadrics[indices[i + k]], quadric);
+	}
+
+	std::vector<std::uint8_t> locked(vertex_count, 0);
+	LockBoundaries(indices, vertex_count, locked);
+	LockCoincidentVertices(positions, locked);
+
+	// Slabs of equal vertex counts along the longest axis, a triangle belongs to a slab when all its vertices do
+	auto partition_count = options.partitions > 0 ? options.partitions : int(GetMeshGenerationThreadCount());
+	partition_count = int(std::min<size_t>(partition_count, triangle_count / 1024 + 1));
+
+	std::vector<GLuint> remaining;
+	double error = 0;
+	if (partition_count > 1)
+	{
+		auto min = positions[0];
+		auto max = positions[0];
+		for (auto& position : positions)
+		{
+			min = glm::min(min, position);
+			max = glm::max(max, position);
+		}
+		auto size = max - min;
+		auto axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 : 2;
+
+		std::vector<GLuint> order(vertex_count);
+		std::iota(order.begin(), order.end(), GLuint(0));
+		std::sort(order.begin(), order.end(), [&](GLuint a, GLuint b) { return positions[a][axis] < positions[b][axis]; });
+
+		std::vector<SimplificationPart> parts(partition_count);
+		std::vector<int> slab_of(vertex_count);
+		std::vector<GLuint> local_index(vertex_count);
+		for (size_t i = 0; i < vertex_count; ++i)
+		{
+			auto vertex = order[i];
+			auto& part = parts[i * partition_count / vertex_count];
+			slab_of[vertex] = int(i * partition_count / vertex_count);
+			local_index[vertex] = GLuint(part.vertices.size());
+			part.vertices.push_back(vertex);
+			part.positions.push_back(glm::dvec3(positions[vertex]));
+			part.quadrics.push_back(quadrics[vertex]);
+			part.locked.push_back(locked[vertex]);
+		}
+
+		// Triangles across slabs wait for the whole mesh pass, their vertices stay where they are until then
+		std::vector<GLuint> border_triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			auto slab = slab_of[indices[i]];
+			if (slab_of[indices[i + 1]] == slab && slab_of[indices[i + 2]] == slab)
+			{
+				for (int k = 0; k < 3; ++k)
+					parts[slab].indices.push_back(local_index[indices[i + k]]);
+				continue;
+			}
+
+			for (int k = 0; k < 3; ++k)
+			{
+				auto vertex = indices[i + k];
+				parts[slab_of[vertex]].locked[local_index[vertex]] = 1;
+				border_triangles.push_back(vertex);
+			}
+		}
+
+		std::vector<size_t> part_triangles;
+		size_t inner_triangles = 0;
+		for (auto& part : parts)
+		{
+			part_triangles.push_back(part.indices.size() / 3);
+			inner_triangles += part.indices.size() / 3;
+		}
+
+		// The slabs share an error limit that grows every round, so that slabs with more curvature keep more triangles.
+		// The rounds end once the slabs are within partition_slack times their share of the target, the border
+		// triangles are only simplified with the whole mesh.
+		auto diagonal = glm::length(glm::dvec3(size));
+		auto limit = options.target_triangles > 0 ? diagonal * partition_first_error : options.max_error;
+		auto inner_target = options.target_triangles * inner_triangles / triangle_count;
+		auto previous_total = inner_triangles;
+		while (true)
+		{
+			if (options.max_error > 0)
+				limit = std::min(limit, options.max_error);
+
+			ParallelForRows(partition_count, [&](int begin, int end)
+			{
+				for (int p = begin; p < end; ++p)
+					SimplifyPart(parts[p], options.target_triangles * part_triangles[p] / triangle_count, limit, part_triangles[p] / partition_min_progress);
+			});
+
+			size_t total = 0;
+			for (auto& part : parts)
+				total += part.indices.size() / 3;
+			if (total <= inner_target * partition_slack || limit == options.max_error || limit >= diagonal)
+				break;
+
+			// Twice the error takes about half the triangles on curved surfaces. Once most triangles are gone, a round
+			// that takes less than a quarter means the slabs are down to their locked vertices.
+			if (total * 2 < inner_triangles && total * 4 > previous_total * 3)
+				break;
+			previous_total = total;
+			limit *= 2;
+		}
+
+		remaining = border_triangles;
+		for (auto& part : parts)
+		{
+			for (auto index : part.indices)
+				remaining.push_back(part.vertices[index]);
+			for (size_t i = 0; i < part.vertices.size(); ++i)
+				quadrics[part.vertices[i]] = part.quadrics[i];
+			error = std::max(error, part.error);
+		}
+	}
+	else
+	{
+		remaining = indices;
+	}
+
+	// The whole mesh, with only the boundaries and seams locked
+	SimplificationPart whole;
+	whole.positions.assign(positions.begin(), positions.end());
+	whole.quadrics = std::move(quadrics);
+	whole.locked = std::move(locked);
+	whole.indices = std::move(remaining);
+	SimplifyPart(whole, options.target_triangles, options.max_error);
+	error = std::max(error, whole.error);
+
+	// Drop the vertices no triangle uses anymore, the rest keeps its order
+	std::vector<GLuint> new_index(vertex_count, 0);
+	for (auto index : whole.indices)
+		new_index[index] = 1;
+	GLuint kept = 0;
+	for (size_t v = 0; v < vertex_count; ++v)
+	{
+		if (!new_index[v])
+			continue;
+		positions[kept] = positions[v];
+		normals[kept] = normals[v];
+		new_index[v] = kept++;
+	}
+	positions.resize(kept);
+	normals.resize(kept);
+
+	indices = std::move(whole.indices);
+	for (auto& index : indices)
+		index = new_index[index];
+
+	statistics.triangles_after = indices.size() / 3;
+	statistics.vertices_after = kept;
+	statistics.error = error;
+	statistics.partitions = partition_count > 1 ? partition_count : 1;
+	return statistics;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+/*
+	Quadric error simplification of triangle list meshes in the position, normal and index vectors of the generators.
+	Edges collapse into one of their two vertices, cheapest first. The cost of a collapse is the root mean square
+	distance of the kept vertex from the planes of the triangles both vertices stood for (Garland and Heckbert).
+	The kept vertex keeps its position and normal, so no new vertices are made.
+
+	Vertices on boundary edges, and vertices that share their position with another vertex, never move. For the grid
+	generators these are the seam and pole columns. The mesh is split into slabs along its longest axis, which are
+	simplified on the worker threads up to an error limit they share, with the vertices between slabs locked. The
+	remaining triangles are then simplified together.
+*/
+
+/* Mesh Simplification */
+struct SimplificationOptions
+{
+	// Stop at this many triangles, 0 stops only at max_error
+	size_t target_triangles = 0;
+
+	// Largest cost of a collapse in object units, 0 for no limit
+	double max_error = 0;
+
+	// Slabs simplified in parallel, 0 for one per mesh generation thread
+	int partitions = 0;
+};
+
+struct SimplificationStatistics
+{
+	size_t triangles_before;
+	size_t triangles_after;
+	size_t vertices_before;
+	size_t vertices_after;
+
+	// Largest cost of the collapses that were made
+	double error;
+
+	// Slabs the mesh was split into, 1 when it was simplified as a whole
+	int partitions;
+};
+
+// Simplifies until target_triangles or max_error is reached, nothing happens when both are 0.
+// Vertices without triangles are removed afterwards, the others keep their order.
+SimplificationStatistics SimplifyMesh(
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec3>& normals,
+	std::vector<GLuint>& indices,
+	const SimplificationOptions& options
+);
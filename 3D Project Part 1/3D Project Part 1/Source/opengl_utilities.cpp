@@ -2,41 +2,376 @@
 
 /* OpenGL Utility Structs */
 
+// Creates a buffer bound to target, data may be NULL to only allocate the storage
+static GLuint CreateBuffer(GLenum target, GLsizeiptr size, const void* data)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, size, data, GL_STATIC_DRAW);
+	return buffer;
+}
+
+// Creates the position and normal buffers of vertex_count vertices without data, one buffer for interleaved formats
+static void CreateVertexBuffers(GLsizei vertex_count, const VertexFormat& format, GLuint& position_buffer, GLuint& normals_buffer)
+{
+	if (format.interleaved)
+	{
+		position_buffer = CreateBuffer(GL_ARRAY_BUFFER, GLsizeiptr(vertex_count) * format.VertexSize(), NULL);
+		normals_buffer = position_buffer;
+	}
+	else
+	{
+		position_buffer = CreateBuffer(GL_ARRAY_BUFFER, GLsizeiptr(vertex_count) * format.PositionSize(), NULL);
+		normals_buffer = CreateBuffer(GL_ARRAY_BUFFER, GLsizeiptr(vertex_count) * format.NormalSize(), NULL);
+	}
+}
+
+// Points attributes position_location and normal_location of the bound VAO at the position and normal buffers
+static void SetVertexAttributes(const VertexFormat& format, GLuint position_buffer, GLuint normals_buffer, GLuint position_location = 0, GLuint normal_location = 1)
+{
+	auto normal_offset = format.interleaved ? format.PositionSize() : 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
+	switch (format.position)
+	{
+	case PositionFormat::Float3:
+		glVertexAttribPointer(position_location, 3, GL_FLOAT, GL_FALSE, format.PositionStride(), static_cast<void *>(0));
+		break;
+	case PositionFormat::Half4:
+		glVertexAttribPointer(position_location, 4, GL_HALF_FLOAT, GL_FALSE, format.PositionStride(), static_cast<void *>(0));
+		break;
+	case PositionFormat::Snorm16x4:
+		glVertexAttribPointer(position_location, 4, GL_SHORT, GL_TRUE, format.PositionStride(), static_cast<void *>(0));
+		break;
+	}
+	glEnableVertexAttribArray(position_location);
+
+
+	glBindBuffer(GL_ARRAY_BUFFER, normals_buffer);
+	switch (format.normal)
+	{
+	case NormalFormat::Float3:
+		glVertexAttribPointer(normal_location, 3, GL_FLOAT, GL_FALSE, format.NormalStride(), reinterpret_cast<void *>(size_t(normal_offset)));
+		break;
+	case NormalFormat::Int2101010:
+		glVertexAttribPointer(normal_location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, format.NormalStride(), reinterpret_cast<void *>(size_t(normal_offset)));
+		break;
+	}
+	glEnableVertexAttribArray(normal_location);
+}
+
+// Write-only and invalidated, so the driver never has to read the old contents back
+static const GLbitfield buffer_map_access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+
+// Maps the position and normal buffers of vertex_count vertices, interleaved normals point into the position buffer
+static void MapVertexBuffers(GLsizei vertex_count, const VertexFormat& format, GLuint position_buffer, GLuint normals_buffer, void*& positions, void*& normals)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
+	if (format.interleaved)
+	{
+		positions = glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(vertex_count) * format.VertexSize(), buffer_map_access);
+		normals = positions ? static_cast<char*>(positions) + format.PositionSize() : NULL;
+	}
+	else
+	{
+		positions = glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(vertex_count) * format.PositionSize(), buffer_map_access);
+
+		glBindBuffer(GL_ARRAY_BUFFER, normals_buffer);
+		normals = glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(vertex_count) * format.NormalSize(), buffer_map_access);
+	}
+}
+
+// Unmaps buffer when it is mapped, false when the driver lost its contents
+static bool UnmapBufferIfMapped(GLenum target, GLuint buffer)
+{
+	GLint mapped;
+	glBindBuffer(target, buffer);
+	glGetBufferParameteriv(target, GL_BUFFER_MAPPED, &mapped);
+	if (mapped)
+		return glUnmapBuffer(target) == GL_TRUE;
+	return true;
+}
+
+// GL_UNSIGNED_SHORT triangles when every vertex is reachable with 16 bits
+static IndexFormat ShortestIndexFormat(size_t vertex_count)
+{
+	IndexFormat index_format;
+	if (vertex_count <= 0xFFFF)
+		index_format.type = GL_UNSIGNED_SHORT;
+	return index_format;
+}
+
+// Copies the vertices and indices into the freshly allocated buffers of vao and sets its bounds and dequantization
+static void CopyMesh(VAO& vao, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& normals, const std::vector<GLuint>& indices)
+{
+	void* position_output;
+	void* normal_output;
+	void* index_output;
+	if (!vao.MapBuffers(position_output, normal_output, index_output))
+		return;
+
+	// The positions are at hand, the sphere around the middle of the box gets the radius of the furthest one
+	for (auto& position : positions)
+		ExtendBounds(vao.bounds, glm::dvec3(position));
+	if (!positions.empty())
+	{
+		vao.bounds.center = (vao.bounds.min + vao.bounds.max) / 2.;
+		vao.bounds.radius = 0;
+		for (auto& position : positions)
+			vao.bounds.radius = std::max(vao.bounds.radius, glm::distance(vao.bounds.center, glm::dvec3(position)));
+	}
+
+	PositionQuantization quantization;
+	if (vao.format.position == PositionFormat::Snorm16x4 && !positions.empty())
+	{
+		quantization = QuantizeBounds(vao.bounds.min, vao.bounds.max);
+		vao.dequantization = quantization.DequantizationTransform();
+	}
+
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		EncodePosition(vao.format.position, quantization, positions[i], static_cast<char*>(position_output) + i * vao.format.PositionStride());
+		EncodeNormal(vao.format.normal, normals[i], static_cast<char*>(normal_output) + i * vao.format.NormalStride());
+	}
+	if (vao.index_format.type == GL_UNSIGNED_SHORT)
+		std::copy(indices.begin(), indices.end(), static_cast<GLushort*>(index_output));
+	else
+		std::copy(indices.begin(), indices.end(), static_cast<GLuint*>(index_output));
+
+	if (!vao.UnmapBuffers())
+		std::cout << "Error: VAO buffer contents were lost while copying the mesh" << std::endl;
+}
+
 VAO::VAO(
 	const std::vector<glm::vec3>& positions,
 	const std::vector<glm::vec3>& normals,
-	const std::vector<GLuint>& indices
+	const std::vector<GLuint>& indices,
+	const VertexFormat& format
 )
+	: VAO(GLsizei(positions.size()), GLsizei(indices.size()), format, ShortestIndexFormat(positions.size()))
+{
+	CopyMesh(*this, positions, normals, indices);
+}
+
+VAO::VAO(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<glm::vec3>& normals,
+	const std::vector<GLuint>& indices,
+	const std::vector<DrawRange>& ranges,
+	const VertexFormat& format
+)
+	: VAO(GLsizei(positions.size()), GLsizei(indices.size()), format,
+		ShortestIndexFormat(indices.empty() ? 0 : size_t(*std::max_element(indices.begin(), indices.end())) + 1))
+{
+	index_format.ranges = ranges;
+	CopyMesh(*this, positions, normals, indices);
+}
+
+VAO::VAO(GLsizei vertex_count, GLsizei element_array_count, const VertexFormat& format, const IndexFormat& index_format, bool element_array)
+	: vertex_count(vertex_count), format(format), dequantization(1), bounds(EmptyBounds()), element_array_count(element_array_count),
+	element_array_buffer(0), index_format(index_format)
 {
 	glGenVertexArrays(1, &id);
 	glBindVertexArray(id);
 
-	vertex_count = GLsizei(positions.size());
+	CreateVertexBuffers(vertex_count, format, position_buffer, normals_buffer);
+	SetVertexAttributes(format, position_buffer, normals_buffer);
 
-	glGenBuffers(1, &position_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, position_buffer);
-	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-	glEnableVertexAttribArray(0);
+	if (element_array)
+		element_array_buffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(element_array_count) * index_format.IndexSize(), NULL);
+}
 
+VAO::VAO(GLsizei element_array_count, const IndexFormat& index_format, bool element_array)
+	: vertex_count(0), position_buffer(0), normals_buffer(0), dequantization(1), bounds(EmptyBounds()), element_array_count(element_array_count),
+	element_array_buffer(0), index_format(index_format)
+{
+	glGenVertexArrays(1, &id);
+	glBindVertexArray(id);
 
-	glGenBuffers(1, &normals_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, normals_buffer);
-	glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), normals.data(), GL_STATIC_DRAW);
+	if (element_array)
+		element_array_buffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(element_array_count) * index_format.IndexSize(), NULL);
+}
 
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, static_cast<void *>(0));
-	glEnableVertexAttribArray(1);
+bool VAO::MapBuffers(void*& positions, void*& normals, void*& indices)
+{
+	glBindVertexArray(id);
+	MapVertexBuffers(vertex_count, format, position_buffer, normals_buffer, positions, normals);
+
+	// A shared element array belongs to every VAO that attached to it
+	auto own_element_array = element_array_buffer != 0 && !shared_element_array;
+	indices = NULL;
+	if (own_element_array)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+		indices = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, GLsizeiptr(element_array_count) * index_format.IndexSize(), buffer_map_access);
+	}
+
+	if (positions == NULL || normals == NULL || (own_element_array && indices == NULL))
+	{
+		std::cout << "Error: Mapping the VAO buffers failed" << std::endl;
+		UnmapBuffers();
+		return false;
+	}
+
+	return true;
+}
+
+bool VAO::UnmapBuffers()
+{
+	glBindVertexArray(id);
+
+	auto intact = UnmapBufferIfMapped(GL_ARRAY_BUFFER, position_buffer);
+	intact &= UnmapBufferIfMapped(GL_ARRAY_BUFFER, normals_buffer);
+	if (element_array_buffer != 0 && !shared_element_array)
+		intact &= UnmapBufferIfMapped(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
+	return intact;
+}
+
+MorphVAO::MorphVAO(GLsizei vertex_count, GLsizei element_array_count, int target_count, const VertexFormat& format, const IndexFormat& index_format)
+	: vao(vertex_count, element_array_count, format, index_format), target_count(std::min(target_count, max_morph_targets))
+{
+	position_buffers[0] = vao.position_buffer;
+	normals_buffers[0] = vao.normals_buffer;
 
+	// Target 0 has attributes 0 and 1 from the VAO constructor
+	glBindVertexArray(vao.id);
+	for (int target = 1; target < this->target_count; ++target)
+	{
+		CreateVertexBuffers(vertex_count, format, position_buffers[target], normals_buffers[target]);
+		SetVertexAttributes(format, position_buffers[target], normals_buffers[target], GLuint(target * 2), GLuint(target * 2 + 1));
+	}
 
-	element_array_count = GLsizei(indices.size());
+	for (int target = 0; target < max_morph_targets; ++target)
+		dequantization[target] = glm::vec4(0, 0, 0, 1);
+}
+
+bool MorphVAO::MapTargetBuffers(int target, void*& positions, void*& normals)
+{
+	glBindVertexArray(vao.id);
+	MapVertexBuffers(vao.vertex_count, vao.format, position_buffers[target], normals_buffers[target], positions, normals);
 
-	glGenBuffers(1, &element_array_buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_array_buffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-};
+	if (positions == NULL || normals == NULL)
+	{
+		std::cout << "Error: Mapping the morph target buffers failed" << std::endl;
+		UnmapTargetBuffers(target);
+		return false;
+	}
+
+	return true;
+}
+
+bool MorphVAO::UnmapTargetBuffers(int target)
+{
+	glBindVertexArray(vao.id);
+
+	auto intact = UnmapBufferIfMapped(GL_ARRAY_BUFFER, position_buffers[target]);
+	intact &= UnmapBufferIfMapped(GL_ARRAY_BUFFER, normals_buffers[target]);
+	return intact;
+}
+
+void MorphVAO::SetQuantization(int target, const PositionQuantization& quantization)
+{
+	if (vao.format.position == PositionFormat::Snorm16x4)
+		dequantization[target] = glm::vec4(quantization.center, quantization.extent);
+}
 
 /* OpenGL Utility Functions */
+// Binds the VAO and sets primitive restart for its index format
+static void BindForDrawing(const VAO& vao)
+{
+	auto& index_format = vao.index_format;
+	glBindVertexArray(vao.id);
+
+	if (index_format.primitive == GL_TRIANGLE_STRIP)
+	{
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(index_format.RestartIndex());
+	}
+	else
+	{
+		glDisable(GL_PRIMITIVE_RESTART);
+	}
+}
+
+// Draws the ranges of the bound VAO that visible marks, every range when visible is NULL
+static void MultiDrawRanges(const VAO& vao, const std::vector<char>* visible)
+{
+	auto& index_format = vao.index_format;
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+	std::vector<GLint> base_vertices;
+	counts.reserve(index_format.ranges.size());
+	offsets.reserve(index_format.ranges.size());
+	base_vertices.reserve(index_format.ranges.size());
+
+	for (size_t i = 0; i < index_format.ranges.size(); ++i)
+	{
+		if (visible && !(*visible)[i])
+			continue;
+
+		auto& range = index_format.ranges[i];
+		counts.push_back(range.index_count);
+		offsets.push_back(reinterpret_cast<const void*>(range.first_index * index_format.IndexSize()));
+		base_vertices.push_back(range.base_vertex);
+	}
+
+	if (!counts.empty())
+		glMultiDrawElementsBaseVertex(index_format.primitive, counts.data(), index_format.type, offsets.data(), GLsizei(counts.size()), base_vertices.data());
+}
+
+void DrawVAO(const VAO& vao)
+{
+	BindForDrawing(vao);
+	if (vao.index_format.ranges.empty())
+		glDrawElements(vao.index_format.primitive, vao.element_array_count, vao.index_format.type, NULL);
+	else
+		MultiDrawRanges(vao, NULL);
+}
+
+void DrawVAORanges(const VAO& vao, const std::vector<char>& visible)
+{
+	BindForDrawing(vao);
+	MultiDrawRanges(vao, &visible);
+}
+
+void DrawMorphVAO(const MorphVAO& morph, const glm::vec4& weights, GLint u_morph_weights_location, GLint u_morph_dequantization_location)
+{
+	// Unused targets read the attribute defaults, their weights have to be 0
+	glm::vec4 used_weights(0);
+	for (int target = 0; target < morph.target_count; ++target)
+		used_weights[target] = weights[target];
+
+	glUniform4fv(u_morph_weights_location, 1, &used_weights[0]);
+	glUniform4fv(u_morph_dequantization_location, max_morph_targets, &morph.dequantization[0][0]);
+	DrawVAO(morph.vao);
+}
+
+void BeginOverdrawMeasurement()
+{
+	glEnable(GL_STENCIL_TEST);
+	glStencilMask(0xFF);
+	glStencilFunc(GL_ALWAYS, 0, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+}
+
+OverdrawStatistics ReadOverdrawMeasurement(const glm::ivec2& size)
+{
+	std::vector<GLubyte> counts(size_t(size.x) * size.y);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, size.x, size.y, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, counts.data());
+
+	OverdrawStatistics statistics = {};
+	for (auto count : counts)
+	{
+		statistics.shaded_fragments += count;
+		statistics.covered_pixels += count > 0 ? 1 : 0;
+	}
+	statistics.overdraw = statistics.covered_pixels == 0 ? 0 : double(statistics.shaded_fragments) / statistics.covered_pixels;
+	return statistics;
+}
+
 GLuint CreateShaderFromSource(const GLenum& shader_type, const GLchar * source)
 {
 	GLuint shader = glCreateShader(shader_type);
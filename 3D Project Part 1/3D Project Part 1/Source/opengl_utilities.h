@@ -1,33 +1,146 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "GLAD/glad.h"
 #include "GLM/glm.hpp"
 
+#include "mesh_bounds.h"
+#include "mesh_optimization.h"
+#include "vertex_format.h"
+
 /* OpenGL Utility Structs */
 
+// Element array buffer that several VAOs draw from, handed out by the topology registry
+struct SharedElementBuffer
+{
+	GLuint id;
+	GLsizeiptr size;
+};
+
 struct VAO
 {
 	GLuint id;
 
 	GLsizei vertex_count;
 	GLuint position_buffer;
-	GLuint normals_buffer;
+	GLuint normals_buffer;		// Same buffer as position_buffer for interleaved formats
+
+	VertexFormat format;
+	glm::mat4 dequantization;	// Premultiply into the model transform, identity unless positions are quantized
+
+	// Object space bounds of the positions before quantization, for culling. Empty when the VAO was created without
+	// vertices, whoever fills the buffers sets them.
+	MeshBounds bounds;
 
 	GLsizei element_array_count;
 	GLuint element_array_buffer;
+	IndexFormat index_format;
+
+	// Set when element_array_buffer is shared with other VAOs, the buffer must not be mapped or deleted then.
+	// element_array_buffer is 0 until a VAO created without its own element array gets one.
+	std::shared_ptr<SharedElementBuffer> shared_element_array;
+
+	// One per range of index_format when the ranges are meshlets, for culling them one by one. Empty otherwise.
+	std::vector<ClusterBounds> clusters;
 
+	// Other formats than the default are encoded while copying, Snorm16x4 is quantized to the bounds of positions.
+	// The triangles are stored with GL_UNSIGNED_SHORT indices when the vertex count allows.
 	VAO(
 		const std::vector<glm::vec3>& positions,
 		const std::vector<glm::vec3>& normals,
-		const std::vector<GLuint>& indices
+		const std::vector<GLuint>& indices,
+		const VertexFormat& format = VertexFormat()
 	);
+
+	// Meshlets, the indices of every range count from its base vertex. They are stored as GL_UNSIGNED_SHORT when the
+	// largest one allows.
+	VAO(
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec3>& normals,
+		const std::vector<GLuint>& indices,
+		const std::vector<DrawRange>& ranges,
+		const VertexFormat& format = VertexFormat()
+	);
+
+	// Allocates the buffers without data, fill them through MapBuffers. Without element_array only the vertex
+	// buffers are allocated, for VAOs that take a shared element array from the topology registry.
+	VAO(
+		GLsizei vertex_count,
+		GLsizei element_array_count,
+		const VertexFormat& format = VertexFormat(),
+		const IndexFormat& index_format = IndexFormat(),
+		bool element_array = true
+	);
+
+	// Only the element array, for vertex shaders that build their vertices from gl_VertexID. vertex_count is 0
+	// and no attribute is enabled. Without element_array no buffer is allocated at all.
+	VAO(GLsizei element_array_count, const IndexFormat& index_format, bool element_array = true);
+
+	// Maps every buffer for writing, the previous contents are discarded.
+	// Vertices are laid out as described by format, interleaved normals point into the position buffer,
+	// indices are GLushort or GLuint as index_format says, NULL when the VAO has no element array of its own.
+	bool MapBuffers(void*& positions, void*& normals, void*& indices);
+
+	// Returns false when the driver lost the mapped contents and the buffers have to be filled again
+	bool UnmapBuffers();
+};
+
+// Every morph target takes two of the 16 vertex attributes GL 3.3 guarantees, the weights fit in one vec4
+const int max_morph_targets = 4;
+
+// Several position and normal sets of the same vertex count, drawn with one element array and blended in the vertex
+// shader. Target 0 is vao at attributes 0 and 1, target i is at attributes 2i and 2i + 1, all in vao.format.
+struct MorphVAO
+{
+	VAO vao;
+	int target_count;
+
+	GLuint position_buffers[max_morph_targets];
+	GLuint normals_buffers[max_morph_targets];
+
+	// Every target has its own Snorm16x4 bounds, (center, extent) per target, (0, 0, 0, 1) for the other formats.
+	// vao.dequantization stays the identity.
+	glm::vec4 dequantization[max_morph_targets];
+
+	// target_count is clamped to max_morph_targets, the element array is filled like the one of a VAO
+	MorphVAO(
+		GLsizei vertex_count,
+		GLsizei element_array_count,
+		int target_count,
+		const VertexFormat& format = VertexFormat(),
+		const IndexFormat& index_format = IndexFormat()
+	);
+
+	// Maps the vertex buffers of one target for writing, as VAO::MapBuffers does
+	bool MapTargetBuffers(int target, void*& positions, void*& normals);
+	bool UnmapTargetBuffers(int target);
+
+	// Sets the dequantization of a target to the bounds its Snorm16x4 positions were written with
+	void SetQuantization(int target, const PositionQuantization& quantization);
 };
 
 /* OpenGL Utility Functions */
 
+// Draws every range of the VAO with its index type, primitive and restart index
+void DrawVAO(const VAO& vao);
+
+// Draws the ranges of the VAO with a non-zero entry in visible, one per range, with one glMultiDrawElementsBaseVertex
+void DrawVAORanges(const VAO& vao, const std::vector<char>& visible);
+
+// Draws the MorphVAO with the weights of its targets, weights beyond target_count are ignored.
+// The program declares uniform vec4 u_morph_weights and uniform vec4 u_morph_dequantization[max_morph_targets].
+void DrawMorphVAO(const MorphVAO& morph, const glm::vec4& weights, GLint u_morph_weights_location, GLint u_morph_dequantization_location);
+
+// Counts the fragments that pass the depth test per pixel in the stencil buffer of the bound framebuffer, which needs
+// stencil bits. The counts start at the stencil clear value and stop at 255.
+void BeginOverdrawMeasurement();
+
+// Reads the counts of the size x size pixels back, a stall, so not every frame
+OverdrawStatistics ReadOverdrawMeasurement(const glm::ivec2& size);
+
 GLuint CreateShaderFromSource(const GLenum& shader_type, const GLchar * source);
 
 GLuint CreateProgramFromSources(const GLchar * vertex_shader_source, const GLchar * fragment_shader_source);
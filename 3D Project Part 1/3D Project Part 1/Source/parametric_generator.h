@@ -0,0 +1,949 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLM/gtc/constants.hpp"
+#include "GLM/gtx/rotate_vector.hpp"
+#include "GLAD/glad.h"
+
+#include "mesh_generation.h"
+#include "dual_numbers.h"
+
+/*
+	Header-only generators that take any callable for the parametric line or surface,
+	so the function body can be inlined into the sampling loops.
+
+	The Layout policy decides where the vertices and indices end up. It has to provide:
+		GridMeshPlan Plan(int vertical_segments, int rotation_segments) const;
+		void Allocate(const GridMeshPlan& plan);
+		void SetBounds(const MeshBounds& bounds);
+		void WriteVertex(size_t vertex, const glm::dvec3& position, const glm::dvec3& normal);
+		void SetIndexCount(const GridMeshPlan& plan);
+		bool WritesIndices() const;
+		void WriteIndex(size_t index, GLuint value);
+	Plan picks the index options, SetBounds is called once before the first WriteVertex.
+	SetIndexCount is called once before the first WriteIndex, with the index count after the poles are known.
+	WriteIndex is not called at all when WritesIndices is false.
+	Write calls come from the worker threads, but never for the same vertex or index twice.
+*/
+
+/* Output Layout Policies */
+
+// Appends to separate position, normal and index arrays, the layout VAO consumes
+struct SeparateArraysLayout
+{
+	std::vector<glm::vec3>& positions;
+	std::vector<glm::vec3>& normals;
+	std::vector<GLuint>& indices;
+
+	// The indices are GLuint, short_indices is ignored
+	GridIndexOptions index_options;
+
+	size_t position_offset = 0;
+	size_t normal_offset = 0;
+	size_t index_offset = 0;
+
+	SeparateArraysLayout(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, std::vector<GLuint>& indices)
+		: positions(positions), normals(normals), indices(indices)
+	{
+	}
+
+	GridMeshPlan Plan(int vertical_segments, int rotation_segments) const
+	{
+		auto options = index_options;
+		options.short_indices = false;
+		return PlanGridMesh(vertical_segments, rotation_segments, options);
+	}
+
+	void Allocate(const GridMeshPlan& plan)
+	{
+		position_offset = positions.size();
+		normal_offset = normals.size();
+		index_offset = indices.size();
+		positions.resize(position_offset + plan.vertex_count);
+		normals.resize(normal_offset + plan.vertex_count);
+		indices.resize(index_offset + plan.index_count);
+	}
+
+	void SetBounds(const MeshBounds&)
+	{
+	}
+
+	void WriteVertex(size_t vertex, const glm::dvec3& position, const glm::dvec3& normal)
+	{
+		positions[position_offset + vertex] = position;
+		normals[normal_offset + vertex] = normal;
+	}
+
+	void SetIndexCount(const GridMeshPlan& plan)
+	{
+		indices.resize(index_offset + plan.index_count);
+	}
+
+	bool WritesIndices() const
+	{
+		return true;
+	}
+
+	void WriteIndex(size_t index, GLuint value)
+	{
+		indices[index_offset + index] = value;
+	}
+};
+
+// Writes into caller-owned memory in the span's vertex and index format, the caller sizes it with PlanGridMesh
+struct MeshSpanLayout
+{
+	MeshSpan& span;
+
+	GridMeshPlan Plan(int vertical_segments, int rotation_segments) const
+	{
+		return PlanGridMesh(vertical_segments, rotation_segments, span.index_options);
+	}
+
+	// The caller sized the span with PlanGridMesh
+	void Allocate(const GridMeshPlan&)
+	{
+	}
+
+	void SetBounds(const MeshBounds& bounds)
+	{
+		span.bounds = bounds;
+		span.quantization = QuantizeBounds(bounds.min, bounds.max);
+	}
+
+	void WriteVertex(size_t vertex, const glm::dvec3& position, const glm::dvec3& normal)
+	{
+		auto& format = span.format;
+		EncodePosition(format.position, span.quantization, position, static_cast<char*>(span.positions) + vertex * format.PositionStride());
+		EncodeNormal(format.normal, normal, static_cast<char*>(span.normals) + vertex * format.NormalStride());
+	}
+
+	void SetIndexCount(const GridMeshPlan& plan)
+	{
+		span.index_format = plan.index_format;
+		span.index_count = plan.index_count;
+		span.poles = plan.poles;
+	}
+
+	// Spans without indices take a shared element array
+	bool WritesIndices() const
+	{
+		return span.indices != NULL;
+	}
+
+	void WriteIndex(size_t index, GLuint value)
+	{
+		if (span.index_format.type == GL_UNSIGNED_SHORT)
+			static_cast<GLushort*>(span.indices)[index] = GLushort(value);
+		else
+			static_cast<GLuint*>(span.indices)[index] = value;
+	}
+};
+
+/* Grid Poles */
+// Rows of a pole column within this fraction of the mesh size count as one point, float grids round the rotations
+const double grid_pole_tolerance = 1e-6;
+
+// Sets the first and last column of the plan as poles when position(v, r) -> glm::dvec3 is the same point in every row
+template <typename Position>
+void DetectGridPoles(GridMeshPlan& plan, const MeshBounds& bounds, const Position& position)
+{
+	auto size = bounds.max - bounds.min;
+	auto tolerance = grid_pole_tolerance * std::max({ size.x, size.y, size.z });
+	auto is_pole = [&](int v)
+	{
+		auto point = position(v, 0);
+		for (int r = 1; r < plan.rotation_segments; ++r)
+			if (glm::distance(position(v, r), point) > tolerance)
+				return false;
+		return true;
+	};
+
+	GridPoles poles;
+	poles.first = is_pole(0);
+	poles.last = is_pole(plan.vertical_segments - 1);
+	SetGridPoles(plan, poles);
+}
+
+/* Batch Surfaces */
+
+// Wraps a kernel(t, r, x, y, z) that is a template over the number type, see parametric_kernels.h.
+// The generators sample it SimdDouble::lane_count points at a time, single points go through T = double.
+template <typename Kernel>
+struct BatchSurface
+{
+	Kernel kernel;
+
+	glm::dvec3 operator()(double t, double r) const
+	{
+		glm::dvec3 p;
+		kernel(t, r, p.x, p.y, p.z);
+		return p;
+	}
+};
+
+template <typename Kernel>
+BatchSurface<Kernel> MakeBatchSurface(const Kernel& kernel)
+{
+	return BatchSurface<Kernel>{ kernel };
+}
+
+// Wraps a profile kernel(t, x, y) for the revolution generator, single points go through T = double
+template <typename Kernel>
+struct BatchLine
+{
+	Kernel kernel;
+
+	glm::dvec2 operator()(double t) const
+	{
+		glm::dvec2 p;
+		kernel(t, p.x, p.y);
+		return p;
+	}
+};
+
+template <typename Kernel>
+BatchLine<Kernel> MakeBatchLine(const Kernel& kernel)
+{
+	return BatchLine<Kernel>{ kernel };
+}
+
+/* Derivatives */
+// Step of the central differences for functions without a kernel. The truncation error stays far below that of
+// the grid steps, and ParametricSurfacev2, which rounds to float on the way, does not turn the rounding into noise.
+const double derivative_step = 1e-4;
+
+// Derivative of parametric_line(t) -> glm::dvec2 at t
+template <typename Line>
+glm::dvec2 LineDerivative(const Line& parametric_line, double t)
+{
+	return (parametric_line(t + derivative_step) - parametric_line(t - derivative_step)) / (2 * derivative_step);
+}
+
+// The kernel runs once on a dual number, which carries the exact derivative
+template <typename Kernel>
+glm::dvec2 LineDerivative(const BatchLine<Kernel>& batch_line, double t)
+{
+	using Number = Dual<double, 1>;
+	Number x, y;
+	batch_line.kernel(Number::Parameter(t, 0), x, y);
+	return glm::dvec2(x.derivatives[0], y.derivatives[0]);
+}
+
+// Point of parametric_surface(t, r) -> glm::dvec3 and its partial derivatives d_t and d_r
+template <typename Surface>
+glm::dvec3 SurfaceDerivatives(const Surface& parametric_surface, double t, double r, glm::dvec3& d_t, glm::dvec3& d_r)
+{
+	d_t = (parametric_surface(t + derivative_step, r) - parametric_surface(t - derivative_step, r)) / (2 * derivative_step);
+	d_r = (parametric_surface(t, r + derivative_step) - parametric_surface(t, r - derivative_step)) / (2 * derivative_step);
+	return parametric_surface(t, r);
+}
+
+template <typename Kernel>
+glm::dvec3 SurfaceDerivatives(const BatchSurface<Kernel>& batch_surface, double t, double r, glm::dvec3& d_t, glm::dvec3& d_r)
+{
+	using Number = Dual<double, 2>;
+	Number x, y, z;
+	batch_surface.kernel(Number::Parameter(t, 0), Number::Parameter(r, 1), x, y, z);
+	d_t = glm::dvec3(x.derivatives[0], y.derivatives[0], z.derivatives[0]);
+	d_r = glm::dvec3(x.derivatives[1], y.derivatives[1], z.derivatives[1]);
+	return glm::dvec3(x.value, y.value, z.value);
+}
+
+// Samples t = v / (vertical_segments - 1) for v in [v_begin, v_end) at rotation r
+template <typename Surface, typename Precision>
+void SampleSurfaceRow(const Surface& parametric_surface, double r, int v_begin, int v_end, int vertical_segments, glm::vec<3, Precision>* output)
+{
+	for (int v = v_begin; v < v_end; ++v)
+		*output++ = glm::vec<3, Precision>(parametric_surface(v / double(vertical_segments - 1), r));
+}
+
+// The batch kernel runs on SimdDouble or SimdFloat lanes depending on Precision
+template <typename Kernel, typename Precision>
+void SampleSurfaceRow(const BatchSurface<Kernel>& batch_surface, double r, int v_begin, int v_end, int vertical_segments, glm::vec<3, Precision>* output)
+{
+	using Simd = typename SimdType<Precision>::type;
+	const int lanes = Simd::lane_count;
+	Precision t[lanes], x[lanes], y[lanes], z[lanes];
+	Simd rotation = Precision(r);
+
+	for (int v = v_begin; v < v_end; v += lanes)
+	{
+		// The last batch repeats its final sample in the unused lanes
+		int count = std::min(lanes, v_end - v);
+		for (int lane = 0; lane < lanes; ++lane)
+			t[lane] = Precision((v + std::min(lane, count - 1)) / double(vertical_segments - 1));
+
+		Simd px, py, pz;
+		batch_surface.kernel(Simd::Load(t), rotation, px, py, pz);
+		px.Store(x);
+		py.Store(y);
+		pz.Store(z);
+
+		for (int lane = 0; lane < count; ++lane)
+			*output++ = glm::vec<3, Precision>(x[lane], y[lane], z[lane]);
+	}
+}
+
+/* Generator Templates */
+// Writes the indices of the grid rows in plan order, rebased to the chunk of every row
+template <typename Layout>
+void GenerateGridIndices(Layout& layout, const GridMeshPlan& plan)
+{
+	auto vertical_segments = plan.vertical_segments;
+	auto rotation_segments = plan.rotation_segments;
+	auto restart_index = plan.index_format.RestartIndex();
+	auto& poles = plan.poles;
+	layout.SetIndexCount(plan);
+	if (!layout.WritesIndices())
+		return;
+
+	ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+	{
+		for (int r = r_begin; r < r_end; ++r)
+		{
+			// The next row wraps around to row 0, or to its copy when the mesh has a seam row
+			auto next_r = plan.seam_row ? r + 1 : (r + 1) % rotation_segments;
+			auto base_vertex = (r / plan.rows_per_chunk) * plan.rows_per_chunk * vertical_segments;
+			auto VRtoIndex = [vertical_segments, base_vertex](int v, int r)
+			{
+				return GLuint(r * vertical_segments + v - base_vertex);
+			};
+
+			auto index = r * plan.indices_per_row;
+			if (plan.index_format.primitive == GL_TRIANGLE_STRIP)
+			{
+				// The repeated first index flips the strip parity, so it winds like the triangle list below.
+				// At a pole the strip starts at (0, next_r) instead, its first triangle has the same parity then.
+				if (!poles.first)
+				{
+					layout.WriteIndex(index++, VRtoIndex(0, r));
+					layout.WriteIndex(index++, VRtoIndex(0, r));
+				}
+				layout.WriteIndex(index++, VRtoIndex(0, next_r));
+				for (int v = 1; v < vertical_segments; ++v)
+				{
+					layout.WriteIndex(index++, VRtoIndex(v, r));
+					if (v < vertical_segments - 1 || !poles.last)
+						layout.WriteIndex(index++, VRtoIndex(v, next_r));
+				}
+				layout.WriteIndex(index++, restart_index);
+			}
+			else
+			{
+				// The quads next to a pole keep only the triangle that is not collapsed, so they form a fan
+				for (int v = 0; v < vertical_segments - 1; ++v)
+				{
+					if (v > 0 || !poles.first)
+					{
+						layout.WriteIndex(index++, VRtoIndex(v + 1, r));
+						layout.WriteIndex(index++, VRtoIndex(v, next_r));
+						layout.WriteIndex(index++, VRtoIndex(v, r));
+					}
+
+					if (v < vertical_segments - 2 || !poles.last)
+					{
+						layout.WriteIndex(index++, VRtoIndex(v + 1, r));
+						layout.WriteIndex(index++, VRtoIndex(v + 1, next_r));
+						layout.WriteIndex(index++, VRtoIndex(v, next_r));
+					}
+				}
+			}
+		}
+	});
+}
+
+template <typename Layout>
+GridMeshPlan AllocateGrid(Layout& layout, int vertical_segments, int rotation_segments)
+{
+	auto plan = layout.Plan(vertical_segments, rotation_segments);
+	layout.Allocate(plan);
+	return plan;
+}
+
+// Writes the vertex at (v, r), and its copy in the seam row for r = 0
+template <typename Layout>
+void WriteGridVertex(Layout& layout, const GridMeshPlan& plan, int v, int r, const glm::dvec3& position, const glm::dvec3& normal)
+{
+	layout.WriteVertex(size_t(r) * plan.vertical_segments + v, position, normal);
+	if (r == 0 && plan.seam_row)
+		layout.WriteVertex(size_t(plan.rotation_segments) * plan.vertical_segments + v, position, normal);
+}
+
+// Surface with parametric_surface(t, r) -> glm::dvec3, t and r in [0, 1].
+// Precision (double or float) is the type the grid and the normals are computed in,
+// float runs the batch kernels on SimdFloat with twice the lanes.
+template <typename Precision = double, typename Surface, typename Layout>
+void GenerateParametricSurfaceMesh(
+	const Surface& parametric_surface,
+	int vertical_segments,
+	int rotation_segments,
+	Layout& layout,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+)
+{
+	// Every row writes to its own slice of the output, so the result does not depend on the thread count
+	auto plan = AllocateGrid(layout, vertical_segments, rotation_segments);
+
+	if (normal_method == NormalMethod::SampledGrid)
+	{
+		// Sample the surface once per grid point, plus one ring of border samples for the central differences
+		auto grid_width = vertical_segments + 2;
+		std::vector<glm::vec<3, Precision>> grid(size_t(grid_width) * (rotation_segments + 2));
+		auto GridAt = [&grid, grid_width](int v, int r) -> glm::vec<3, Precision>&
+		{
+			return grid[size_t(r + 1) * grid_width + (v + 1)];
+		};
+
+		// Bounds of every row, the border samples are not part of the mesh
+		std::vector<MeshBounds> row_bounds(rotation_segments, EmptyBounds());
+		ParallelForRows(rotation_segments + 2, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin - 1; r < r_end - 1; ++r)
+			{
+				SampleSurfaceRow(parametric_surface, r / double(rotation_segments), -1, vertical_segments + 1, vertical_segments, &GridAt(-1, r));
+				if (r >= 0 && r < rotation_segments)
+					for (int v = 0; v < vertical_segments; ++v)
+						ExtendBounds(row_bounds[r], glm::dvec3(GridAt(v, r)));
+			}
+		});
+		auto bounds = MergeBounds(row_bounds);
+		layout.SetBounds(bounds);
+		DetectGridPoles(plan, bounds, [&](int v, int r) { return glm::dvec3(GridAt(v, r)); });
+
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin; r < r_end; ++r)
+				for (int v = 0; v < vertical_segments; ++v)
+				{
+					auto p = GridAt(v, r);
+
+					auto to_next_v = GridAt(v + 1, r) - p;
+					auto from_prev_v = p - GridAt(v - 1, r);
+					auto tangent_v = (to_next_v + from_prev_v) / Precision(2);
+
+					auto to_next_r = GridAt(v, r + 1) - p;
+					auto from_prev_r = p - GridAt(v, r - 1);
+					auto tangent_r = (to_next_r + from_prev_r) / Precision(2);
+
+					auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
+					WriteGridVertex(layout, plan, v, r, glm::dvec3(p), glm::dvec3(normal));
+				}
+		});
+	}
+	else if (normal_method == NormalMethod::DualNumbers)
+	{
+		// One evaluation per vertex gives the point and both tangents, they are kept until the bounds are known
+		std::vector<glm::dvec3> points(size_t(vertical_segments) * rotation_segments);
+		std::vector<glm::dvec3> point_normals(points.size());
+		std::vector<MeshBounds> row_bounds(rotation_segments, EmptyBounds());
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin; r < r_end; ++r)
+				for (int v = 0; v < vertical_segments; ++v)
+				{
+					auto i = size_t(r) * vertical_segments + v;
+					glm::dvec3 tangent_v, tangent_r;
+					points[i] = SurfaceDerivatives(parametric_surface, v / double(vertical_segments - 1), r / double(rotation_segments), tangent_v, tangent_r);
+					point_normals[i] = glm::normalize(glm::cross(tangent_r, tangent_v));
+					ExtendBounds(row_bounds[r], points[i]);
+				}
+		});
+		auto bounds = MergeBounds(row_bounds);
+		layout.SetBounds(bounds);
+		DetectGridPoles(plan, bounds, [&](int v, int r) { return points[size_t(r) * vertical_segments + v]; });
+
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin; r < r_end; ++r)
+				for (int v = 0; v < vertical_segments; ++v)
+				{
+					auto i = size_t(r) * vertical_segments + v;
+					WriteGridVertex(layout, plan, v, r, points[i], point_normals[i]);
+				}
+		});
+	}
+	else
+	{
+		// The positions are not kept around in this mode, the bounds take one extra evaluation per vertex
+		std::vector<MeshBounds> row_bounds(rotation_segments, EmptyBounds());
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin; r < r_end; ++r)
+				for (int v = 0; v < vertical_segments; ++v)
+					ExtendBounds(row_bounds[r], parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments)));
+		});
+		auto bounds = MergeBounds(row_bounds);
+		layout.SetBounds(bounds);
+		DetectGridPoles(plan, bounds, [&](int v, int r)
+		{
+			return parametric_surface(v / double(vertical_segments - 1), r / double(rotation_segments));
+		});
+
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			for (int r = r_begin; r < r_end; ++r)
+				for (int v = 0; v < vertical_segments; ++v)
+				{
+					auto nv = v / double(vertical_segments - 1);
+					auto nr = r / double(rotation_segments);
+					auto epsilonv = 1 / double(vertical_segments - 1);
+					auto epsilonr = 1 / double(rotation_segments);
+
+					auto to_next_v = parametric_surface(nv + epsilonv, nr) - parametric_surface(nv, nr);
+					auto from_prev_v = parametric_surface(nv, nr) - parametric_surface(nv - epsilonv, nr);
+					auto tangent_v = (to_next_v + from_prev_v) / 2.;
+
+					auto to_next_r = parametric_surface(nv, nr + epsilonr) - parametric_surface(nv, nr);
+					auto from_prev_r = parametric_surface(nv, nr) - parametric_surface(nv, nr - epsilonr);
+					auto tangent_r = (to_next_r + from_prev_r) / 2.;
+
+					// The exact mode is the reference, it always runs in double
+					auto normal = glm::normalize(glm::cross(tangent_r, tangent_v));
+					WriteGridVertex(layout, plan, v, r, parametric_surface(nv, nr), normal);
+				}
+		});
+	}
+
+	GenerateGridIndices(layout, plan);
+}
+
+// Surface of revolution of parametric_line(t) -> glm::dvec2 around the Y axis.
+// It is separable: the profile only depends on v and the rotation only on r.
+// The O(V + R) profile and rotation samples stay in double, Precision applies to the grid.
+// NormalMethod::DualNumbers takes the profile tangents from LineDerivative, the other methods from the profile samples.
+template <typename Precision = double, typename Line, typename Layout>
+void GenerateRevolutionSurfaceMesh(
+	const Line& parametric_line,
+	int vertical_segments,
+	int rotation_segments,
+	Layout& layout,
+	NormalMethod normal_method = NormalMethod::SampledGrid
+)
+{
+	// Profile samples with one extra sample on each end for the central differences
+	std::vector<glm::dvec2> profile(vertical_segments + 2);
+	for (int v = -1; v <= vertical_segments; ++v)
+		profile[v + 1] = parametric_line(v / double(vertical_segments - 1));
+
+	// In-plane normal of the profile, rotated around Y it becomes the surface normal
+	std::vector<glm::dvec2> profile_normals(vertical_segments);
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		glm::dvec2 tangent;
+		if (normal_method == NormalMethod::DualNumbers)
+			tangent = LineDerivative(parametric_line, v / double(vertical_segments - 1));
+		else
+		{
+			auto to_next = profile[v + 2] - profile[v + 1];
+			auto from_prev = profile[v + 1] - profile[v];
+			tangent = (to_next + from_prev) / 2.;
+		}
+
+		// cross(tangent_r, tangent_v) flips with the side of the Y axis the profile is on
+		auto side = profile[v + 1].x < 0 ? -1. : 1.;
+		profile_normals[v] = glm::normalize(glm::dvec2(tangent.y, -tangent.x)) * side;
+	}
+
+	std::vector<glm::dvec2> rotation_basis(rotation_segments);
+	for (int r = 0; r < rotation_segments; ++r)
+	{
+		auto angle = r / double(rotation_segments) * glm::two_pi<double>();
+		rotation_basis[r] = glm::dvec2(cos(angle), sin(angle));
+	}
+
+	// Every rotation of the profile stays inside the cylinder of its largest radius, and inside the sphere around
+	// the middle of the cylinder axis that holds the profile
+	auto bounds = EmptyBounds();
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		auto p = profile[v + 1];
+		ExtendBounds(bounds, glm::dvec3(-std::abs(p.x), p.y, -std::abs(p.x)));
+		ExtendBounds(bounds, glm::dvec3(std::abs(p.x), p.y, std::abs(p.x)));
+	}
+	bounds.center = glm::dvec3(0, (bounds.min.y + bounds.max.y) / 2, 0);
+	bounds.radius = 0;
+	for (int v = 0; v < vertical_segments; ++v)
+		bounds.radius = std::max(bounds.radius, glm::length(profile[v + 1] - glm::dvec2(0, bounds.center.y)));
+
+	auto plan = AllocateGrid(layout, vertical_segments, rotation_segments);
+	layout.SetBounds(bounds);
+	DetectGridPoles(plan, bounds, [&](int v, int r)
+	{
+		auto p = profile[v + 1];
+		return glm::dvec3(p.x * rotation_basis[r].x, p.y, -p.x * rotation_basis[r].y);
+	});
+
+	ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+	{
+		for (int r = r_begin; r < r_end; ++r)
+		{
+			auto cos_r = Precision(rotation_basis[r].x);
+			auto sin_r = Precision(rotation_basis[r].y);
+			for (int v = 0; v < vertical_segments; ++v)
+			{
+				// Same arithmetic as glm::rotateY with z = 0
+				auto p = glm::vec<2, Precision>(profile[v + 1]);
+				auto n = glm::vec<2, Precision>(profile_normals[v]);
+				WriteGridVertex(
+					layout, plan, v, r,
+					glm::dvec3(p.x * cos_r, p.y, -p.x * sin_r),
+					glm::dvec3(n.x * cos_r, n.y, -n.x * sin_r)
+				);
+			}
+		}
+	});
+
+	GenerateGridIndices(layout, plan);
+}
+
+/* Adaptive Grids */
+// Distance of point from the segment between a and b
+inline double DistanceToSegment(const glm::dvec3& point, const glm::dvec3& a, const glm::dvec3& b)
+{
+	auto edge = b - a;
+	auto length_squared = glm::dot(edge, edge);
+	auto s = length_squared > 0 ? glm::clamp(glm::dot(point - a, edge) / length_squared, 0., 1.) : 0.;
+	return glm::distance(point, a + edge * s);
+}
+
+// Halves [a, b] until chord_error(a, b) is within tolerance or the interval is min_width wide,
+// appends the start of every interval
+template <typename ChordError>
+void RefineInterval(double a, double b, double min_width, const ChordError& chord_error, double tolerance, std::vector<double>& lines)
+{
+	if (b - a >= 2 * min_width && chord_error(a, b) > tolerance)
+	{
+		auto middle = (a + b) / 2;
+		RefineInterval(a, middle, min_width, chord_error, tolerance, lines);
+		RefineInterval(middle, b, min_width, chord_error, tolerance, lines);
+		return;
+	}
+	lines.push_back(a);
+}
+
+// Grid lines in [0, 1) that give every interval about the same chord error. Where a chord across two of
+// density_samples steps has the error e, a chord of length h has about e * (h / 2 step)^2, so one step takes
+// sqrt(e / tolerance) / 2 intervals. The lines are placed at equal parts of the running sum of that.
+template <typename ChordError>
+std::vector<double> DistributeGridLines(const ChordError& chord_error, const AdaptiveSamplingOptions& options, int density_samples)
+{
+	auto step = 1. / density_samples;
+	auto min_density = std::max(options.initial_segments, 1) * step;
+
+	// Chords across two steps, so that the error stays well above the rounding of the surface
+	std::vector<double> errors(density_samples);
+	ParallelForRows(density_samples, [&](int begin, int end)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			auto t = (i + 0.5) * step;
+			errors[i] = chord_error(t - step, t + step);
+		}
+	});
+
+	std::vector<double> chords(density_samples + 1, 0.);
+	for (int i = 0; i < density_samples; ++i)
+		chords[i + 1] = chords[i] + std::max(std::sqrt(errors[i] / options.tolerance) / 2, min_density);
+
+	auto segments = glm::clamp(int(std::ceil(chords.back())), std::max(options.initial_segments, 1), options.max_segments);
+	std::vector<double> lines;
+	lines.reserve(segments + 1);
+
+	int i = 0;
+	for (int k = 0; k < segments; ++k)
+	{
+		auto target = chords.back() * k / segments;
+		while (chords[i + 1] < target)
+			++i;
+		auto fraction = chords[i + 1] > chords[i] ? (target - chords[i]) / (chords[i + 1] - chords[i]) : 0.;
+		lines.push_back((i + fraction) * step);
+	}
+
+	// The density is measured locally, an interval that reaches into a sharper region can still be above tolerance
+	std::vector<double> refined;
+	refined.reserve(lines.size());
+	for (size_t k = 0; k < lines.size(); ++k)
+	{
+		auto end = k + 1 < lines.size() ? lines[k + 1] : 1.;
+		RefineInterval(lines[k], end, 1. / options.max_segments, chord_error, options.tolerance, refined);
+	}
+	return refined;
+}
+
+// Halves the intervals of the quads whose triangles are further than the tolerance from the surface, until none is
+// or the intervals reach 1 / max_segments. A quad is measured by parameter at its diagonal midpoint, the centroids of
+// its two triangles and the midpoints of its edges, where the error of a flat quad is largest. The interval along
+// the edge with the larger error is halved, both when the edges are within half the tolerance and only the interior,
+// the twist of the surface, is not. Only the quads of halved intervals are measured again.
+template <typename Surface>
+void RefineAdaptiveGrid(const Surface& parametric_surface, AdaptiveGrid& grid, const AdaptiveSamplingOptions& options)
+{
+	enum : std::uint8_t { split_t = 1, split_r = 2 };
+	auto min_width = 1. / options.max_segments;
+	std::vector<bool> fresh_t(grid.t.size() - 1, true);
+	std::vector<bool> fresh_r(grid.r.size(), true);
+
+	for (int pass = 0; pass < 16; ++pass)
+	{
+		auto vertical_segments = int(grid.t.size());
+		auto rotation_segments = int(grid.r.size());
+		auto RAt = [&grid, rotation_segments](int j)
+		{
+			return j < rotation_segments ? grid.r[j] : 1.;
+		};
+
+		// p00 to p11 are the corners, t_middle0 and t_middle1 the midpoints of the edges along t at r0 and r1, and
+		// r_middle0 and r_middle1 of the edges along r at t0 and t1
+		auto MeasureQuad = [&](int v, double r0, double r1, const glm::dvec3& p00, const glm::dvec3& p10,
+			const glm::dvec3& p01, const glm::dvec3& p11, const glm::dvec3& t_middle0, const glm::dvec3& t_middle1,
+			const glm::dvec3& r_middle0, const glm::dvec3& r_middle1) -> std::uint8_t
+		{
+			auto t0 = grid.t[v], t1 = grid.t[v + 1];
+			auto Error = [&parametric_surface](double t, double r, const glm::dvec3& point)
+			{
+				return glm::distance(parametric_surface(t, r), point);
+			};
+
+			// The diagonal runs from (v + 1, j) to (v, j + 1), as GenerateGridIndices splits the quads
+			auto interior = std::max({
+				Error((t0 + t1) / 2, (r0 + r1) / 2, (p10 + p01) / 2.),
+				Error((t1 + 2 * t0) / 3, (2 * r0 + r1) / 3, (p10 + p01 + p00) / 3.),
+				Error((2 * t1 + t0) / 3, (r0 + 2 * r1) / 3, (p10 + p11 + p01) / 3.)
+			});
+			auto t_edge = std::max(glm::distance(t_middle0, (p00 + p10) / 2.), glm::distance(t_middle1, (p01 + p11) / 2.));
+			auto r_edge = std::max(glm::distance(r_middle0, (p00 + p01) / 2.), glm::distance(r_middle1, (p10 + p11) / 2.));
+			if (std::max({ interior, t_edge, r_edge }) <= options.tolerance)
+				return 0;
+
+			std::uint8_t split = 0;
+			if (t_edge <= options.tolerance / 2 && r_edge <= options.tolerance / 2)
+				split = split_t | split_r;
+			else
+				split = t_edge >= r_edge ? split_t : split_r;
+			if (t1 - t0 < 2 * min_width)
+				split &= ~split_t;
+			if (r1 - r0 < 2 * min_width)
+				split &= ~split_r;
+			return split;
+		};
+
+		// Split flags of every quad, column j of the quads between r lines j and j + 1
+		std::vector<std::uint8_t> splits(size_t(vertical_segments - 1) * rotation_segments, 0);
+		ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+		{
+			// Surface points of a column of quads, at the t lines and the t midpoints along r0 and r1 and at the
+			// t lines along the r midpoint. The points along r1 are those along r0 of the next column.
+			std::vector<glm::dvec3> corners0, corners1, middles0, middles1, r_middles(vertical_segments);
+			auto corners0_r = -1.;
+			auto EvaluateColumn = [&](double r, std::vector<glm::dvec3>& corners, std::vector<glm::dvec3>& middles)
+			{
+				corners.resize(vertical_segments);
+				middles.resize(vertical_segments - 1);
+				for (int v = 0; v < vertical_segments; ++v)
+				{
+					corners[v] = parametric_surface(grid.t[v], r);
+					if (v + 1 < vertical_segments)
+						middles[v] = parametric_surface((grid.t[v] + grid.t[v + 1]) / 2, r);
+				}
+			};
+
+			for (int j = r_begin; j < r_end; ++j)
+			{
+				auto r0 = RAt(j), r1 = RAt(j + 1), r_middle = (r0 + r1) / 2;
+				auto quads = splits.begin() + size_t(j) * (vertical_segments - 1);
+				if (fresh_r[j])
+				{
+					if (corners0_r != r0)
+						EvaluateColumn(r0, corners0, middles0);
+					EvaluateColumn(r1, corners1, middles1);
+					for (int v = 0; v < vertical_segments; ++v)
+						r_middles[v] = parametric_surface(grid.t[v], r_middle);
+
+					for (int v = 0; v + 1 < vertical_segments; ++v)
+						quads[v] = MeasureQuad(v, r0, r1, corners0[v], corners0[v + 1], corners1[v], corners1[v + 1],
+							middles0[v], middles1[v], r_middles[v], r_middles[v + 1]);
+
+					corners0.swap(corners1);
+					middles0.swap(middles1);
+					corners0_r = r1;
+					continue;
+				}
+
+				for (int v = 0; v + 1 < vertical_segments; ++v)
+				{
+					if (!fresh_t[v])
+						continue;
+
+					auto t0 = grid.t[v], t1 = grid.t[v + 1], t_middle = (t0 + t1) / 2;
+					quads[v] = MeasureQuad(v, r0, r1,
+						parametric_surface(t0, r0), parametric_surface(t1, r0),
+						parametric_surface(t0, r1), parametric_surface(t1, r1),
+						parametric_surface(t_middle, r0), parametric_surface(t_middle, r1),
+						parametric_surface(t0, r_middle), parametric_surface(t1, r_middle));
+				}
+			}
+		});
+
+		std::vector<bool> split_t_intervals(vertical_segments - 1, false);
+		std::vector<bool> split_r_intervals(rotation_segments, false);
+		auto any_split = false;
+		for (int j = 0; j < rotation_segments; ++j)
+			for (int v = 0; v + 1 < vertical_segments; ++v)
+			{
+				auto split = splits[size_t(j) * (vertical_segments - 1) + v];
+				if (split & split_t)
+					split_t_intervals[v] = true;
+				if (split & split_r)
+					split_r_intervals[j] = true;
+				any_split |= split != 0;
+			}
+		if (!any_split)
+			return;
+
+		std::vector<double> t, r;
+		fresh_t.clear();
+		fresh_r.clear();
+		for (int v = 0; v + 1 < vertical_segments; ++v)
+		{
+			t.push_back(grid.t[v]);
+			fresh_t.push_back(split_t_intervals[v]);
+			if (split_t_intervals[v])
+			{
+				t.push_back((grid.t[v] + grid.t[v + 1]) / 2);
+				fresh_t.push_back(true);
+			}
+		}
+		t.push_back(grid.t.back());
+		for (int j = 0; j < rotation_segments; ++j)
+		{
+			r.push_back(grid.r[j]);
+			fresh_r.push_back(split_r_intervals[j]);
+			if (split_r_intervals[j])
+			{
+				r.push_back((grid.r[j] + RAt(j + 1)) / 2);
+				fresh_r.push_back(true);
+			}
+		}
+		grid.t.swap(t);
+		grid.r.swap(r);
+	}
+}
+
+// Grid lines for parametric_surface(t, r) -> glm::dvec3. The chord error along t is the largest of probe_count rows
+// and along r of probe_count columns, both directions keep one set of lines for the whole grid. Each direction is
+// planned for half the tolerance, the errors of the two add up inside the quads, and RefineAdaptiveGrid then
+// checks every quad.
+template <typename Surface>
+AdaptiveGrid PlanAdaptiveGrid(const Surface& parametric_surface, const AdaptiveSamplingOptions& options)
+{
+	auto probe_count = std::max(options.probe_count, 2);
+	auto density_samples = std::max(options.max_segments / 4, 16);
+
+	// Distance of the quarter points of [a, b] from the chord, on every probe line
+	auto vertical_error = [&](double a, double b)
+	{
+		double error = 0;
+		for (int i = 0; i < probe_count; ++i)
+		{
+			auto r = i / double(probe_count);
+			auto start = parametric_surface(a, r);
+			auto end = parametric_surface(b, r);
+			for (int quarter = 1; quarter < 4; ++quarter)
+				error = std::max(error, DistanceToSegment(parametric_surface(a + (b - a) * quarter / 4, r), start, end));
+		}
+		return error;
+	};
+
+	auto rotation_error = [&](double a, double b)
+	{
+		double error = 0;
+		for (int i = 0; i < probe_count; ++i)
+		{
+			auto t = i / double(probe_count - 1);
+			auto start = parametric_surface(t, a);
+			auto end = parametric_surface(t, b);
+			for (int quarter = 1; quarter < 4; ++quarter)
+				error = std::max(error, DistanceToSegment(parametric_surface(t, a + (b - a) * quarter / 4), start, end));
+		}
+		return error;
+	};
+
+	auto direction_options = options;
+	direction_options.tolerance = options.tolerance / 2;
+
+	AdaptiveGrid grid;
+	grid.t = DistributeGridLines(vertical_error, direction_options, density_samples);
+	grid.r = DistributeGridLines(rotation_error, direction_options, density_samples);
+
+	// r = 1 is the r = 0 row again, t = 1 is a column of its own
+	grid.t.push_back(1);
+	RefineAdaptiveGrid(parametric_surface, grid, options);
+	return grid;
+}
+
+// Derivative at the middle one of three samples spaced h_previous and h_next apart, exact for a parabola
+inline glm::dvec3 NonUniformDerivative(const glm::dvec3& previous, const glm::dvec3& point, const glm::dvec3& next, double h_previous, double h_next)
+{
+	return ((next - point) * (h_previous / h_next) + (point - previous) * (h_next / h_previous)) / (h_previous + h_next);
+}
+
+// Surface on the grid lines of grid, in the vertex and index order of the uniform generators
+template <typename Surface, typename Layout>
+void GenerateAdaptiveSurfaceMesh(const Surface& parametric_surface, const AdaptiveGrid& grid, Layout& layout)
+{
+	auto vertical_segments = int(grid.t.size());
+	auto rotation_segments = int(grid.r.size());
+
+	// One extra line on each side for the derivatives, t continues with the spacing of its end and r wraps around
+	std::vector<double> t(vertical_segments + 2);
+	std::vector<double> r(rotation_segments + 2);
+	std::copy(grid.t.begin(), grid.t.end(), t.begin() + 1);
+	std::copy(grid.r.begin(), grid.r.end(), r.begin() + 1);
+	t.front() = 2 * grid.t[0] - grid.t[1];
+	t.back() = 2 * grid.t[vertical_segments - 1] - grid.t[vertical_segments - 2];
+	r.front() = grid.r[rotation_segments - 1] - 1;
+	r.back() = grid.r[0] + 1;
+
+	auto grid_width = vertical_segments + 2;
+	std::vector<glm::dvec3> samples(size_t(grid_width) * (rotation_segments + 2));
+	auto SampleAt = [&samples, grid_width](int v, int r) -> glm::dvec3&
+	{
+		return samples[size_t(r + 1) * grid_width + (v + 1)];
+	};
+
+	std::vector<MeshBounds> row_bounds(rotation_segments, EmptyBounds());
+	ParallelForRows(rotation_segments + 2, [&](int r_begin, int r_end)
+	{
+		for (int j = r_begin - 1; j < r_end - 1; ++j)
+			for (int v = -1; v <= vertical_segments; ++v)
+			{
+				SampleAt(v, j) = parametric_surface(t[v + 1], r[j + 1]);
+				if (j >= 0 && j < rotation_segments && v >= 0 && v < vertical_segments)
+					ExtendBounds(row_bounds[j], SampleAt(v, j));
+			}
+	});
+
+	auto plan = AllocateGrid(layout, vertical_segments, rotation_segments);
+	auto bounds = MergeBounds(row_bounds);
+	layout.SetBounds(bounds);
+	DetectGridPoles(plan, bounds, SampleAt);
+
+	ParallelForRows(rotation_segments, [&](int r_begin, int r_end)
+	{
+		for (int j = r_begin; j < r_end; ++j)
+			for (int v = 0; v < vertical_segments; ++v)
+			{
+				auto tangent_v = NonUniformDerivative(SampleAt(v - 1, j), SampleAt(v, j), SampleAt(v + 1, j), t[v + 1] - t[v], t[v + 2] - t[v + 1]);
+				auto tangent_r = NonUniformDerivative(SampleAt(v, j - 1), SampleAt(v, j), SampleAt(v, j + 1), r[j + 1] - r[j], r[j + 2] - r[j + 1]);
+				WriteGridVertex(layout, plan, v, j, SampleAt(v, j), glm::normalize(glm::cross(tangent_r, tangent_v)));
+			}
+	});
+
+	GenerateGridIndices(layout, plan);
+}
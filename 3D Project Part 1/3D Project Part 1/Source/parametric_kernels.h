@@ -0,0 +1,122 @@
+#pragma once
+
+#include "GLM/glm.hpp"
+#include "GLM/gtc/constants.hpp"
+
+#include "simd_math.h"
+
+/*
+	The example parametric functions, written once as templates over the number type.
+	With T = double they are the scalar functions in mesh_generation.h, with T = SimdDouble
+	they evaluate SimdDouble::lane_count points at once in SoA form.
+*/
+
+/* 2D Parametric Kernels */
+struct ParametricHalfCircleKernel
+{
+	template <typename T>
+	void operator()(T t, T& x, T& y) const
+	{
+		// [0, 1]
+		t = t - 0.5;
+		// [-0.5, 0.5]
+		t = t * glm::pi<double>();
+		// [-PI*0.5, PI*0.5]
+		x = Cos(t);
+		y = Sin(t);
+	}
+};
+
+struct ParametricCircleKernel
+{
+	template <typename T>
+	void operator()(T t, T& x, T& y) const
+	{
+		// [0, 1]
+		t = t - 0.5;
+		// [-0.5, 0.5]
+		t = t * glm::two_pi<double>();
+		// [-PI, PI]
+
+		auto r = 0.3;
+		x = Cos(t) * r + 0.7;
+		y = Sin(t) * r + 0.;
+	}
+};
+
+struct ParametricSpikesKernel
+{
+	template <typename T>
+	void operator()(T t, T& x, T& y) const
+	{
+		// [0, 1]
+		t = t - 0.5;
+		// [-0.5, 0.5]
+		t = t * glm::two_pi<double>();
+		// [-PI, PI]
+
+		auto r = 0.3;
+		auto a = 2 + 4 * 2;
+		x = (Cos(t) + Sin(a * t) / a) * r + 0.7;
+		y = (Sin(t) + Cos(a * t) / a) * r + 0.;
+	}
+};
+
+struct ParametricSpikyv2Kernel
+{
+	template <typename T>
+	void operator()(T t, T& x, T& y) const
+	{
+		// [0, 1]
+		t = t - 0.5;
+		// [-0.5, 0.5]
+		t = t * glm::pi<double>();
+		// [-PI, PI]
+
+		auto a = 2 + 4 * 2;
+		x = Cos(t) + Sin(a * t) / a;
+		y = Sin(t) + Cos(a * t) / a;
+	}
+};
+
+/* 3D Parametric Kernels */
+// Twisted surface of GenerateParametricShapeFrom2Dv2 built from the profile point (px, py) at t
+struct ParametricSurfacev2Kernel
+{
+	template <typename T>
+	void operator()(T px, T py, T r, T& x, T& y, T& z) const
+	{
+		auto scale = (Sin(r * 5 * glm::two_pi<double>()) + 3) / 4.;
+		px = px * scale;
+		py = py * scale;
+		py = py * ((PowInt(Sin((r + 0.5) * 5 * glm::two_pi<double>()), 6) + 3) / 3);
+
+		// glm::length(glm::vec2(p)) runs in single precision, keep its rounding
+		auto px_float = RoundToFloat(px);
+		auto py_float = RoundToFloat(py);
+		auto xy_len = RoundToFloat(Sqrt(RoundToFloat(RoundToFloat(px_float * px_float) + RoundToFloat(py_float * py_float))));
+		py = py * Pow(xy_len, 1.3);
+		auto a = Sin(xy_len * 1.2 * glm::two_pi<double>() * 0.4);
+
+		// glm::rotateY with z = 0
+		auto angle = a + r * glm::two_pi<double>();
+		x = px * Cos(angle);
+		y = py;
+		z = -px * Sin(angle);
+	}
+};
+
+// Composes a 2D profile kernel with ParametricSurfacev2Kernel into a (t, r) surface kernel
+template <typename LineKernel>
+struct ParametricSurfacev2FromLineKernel
+{
+	LineKernel line_kernel;
+
+	template <typename T>
+	void operator()(T t, T r, T& x, T& y, T& z) const
+	{
+		T px, py;
+		line_kernel(t, px, py);
+		ParametricSurfacev2Kernel()(px, py, r, x, y, z);
+	}
+};
@@ -0,0 +1,320 @@
+#include "procedural_surface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parametric_generator.h"
+#include "topology_registry.h"
+
+/* Procedural Surfaces */
+bool CreateProceduralMesh(ProceduralMesh& mesh, ProceduralSurface surface, glm::dvec2(*parametric_line)(double), int vertical_segments, int rotation_segments)
+{
+	// The constants of the kernels in parametric_kernels.h
+	const float pi = glm::pi<float>();
+	const float two_pi = glm::two_pi<float>();
+	if (parametric_line == ParametricHalfCircle)
+	{
+		mesh.profile_name = "ParametricHalfCircle";
+		mesh.profile = { pi, 1, 0, 0 };
+	}
+	else if (parametric_line == ParametricCircle)
+	{
+		mesh.profile_name = "ParametricCircle";
+		mesh.profile = { two_pi, 0.3f, 0.7f, 0 };
+	}
+	else if (parametric_line == ParametricSpikes)
+	{
+		mesh.profile_name = "ParametricSpikes";
+		mesh.profile = { two_pi, 0.3f, 0.7f, 2 + 4 * 2 };
+	}
+	else if (parametric_line == ParametricSpikyv2)
+	{
+		mesh.profile_name = "ParametricSpikyv2";
+		mesh.profile = { pi, 1, 0, 2 + 4 * 2 };
+	}
+	else
+		return false;
+
+	mesh.surface = surface;
+	mesh.parametric_line = parametric_line;
+	mesh.vertical_segments = vertical_segments;
+	mesh.rotation_segments = rotation_segments;
+	return true;
+}
+
+// Bounds around the grid points as the CPU generators place them, the shader rounds them to float on top. They come
+// from the profile alone, every level of detail gets them without evaluating the surface at its grid points.
+static MeshBounds ProceduralBounds(const ProceduralMesh& mesh)
+{
+	auto vertical_segments = mesh.vertical_segments;
+	if (mesh.surface == ProceduralSurface::Revolution)
+	{
+		// Inside the cylinder of the largest profile radius and the sphere around the middle of its axis
+		std::vector<glm::dvec2> profile(vertical_segments);
+		auto bounds = EmptyBounds();
+		for (int v = 0; v < vertical_segments; ++v)
+		{
+			profile[v] = mesh.parametric_line(v / double(vertical_segments - 1));
+			ExtendBounds(bounds, glm::dvec3(-std::abs(profile[v].x), profile[v].y, -std::abs(profile[v].x)));
+			ExtendBounds(bounds, glm::dvec3(std::abs(profile[v].x), profile[v].y, std::abs(profile[v].x)));
+		}
+		bounds.center = glm::dvec3(0, (bounds.min.y + bounds.max.y) / 2, 0);
+		bounds.radius = 0;
+		for (auto& p : profile)
+			bounds.radius = std::max(bounds.radius, glm::length(p - glm::dvec2(0, bounds.center.y)));
+		return bounds;
+	}
+
+	// ParametricSurfacev2Kernel scales p.x by [0.5, 1] and p.y by [0.5, 4 / 3], then p.y by the scaled length to the
+	// power 1.3, at most (4 / 3 |p|)^1.3. The rotation keeps x and z within |p.x|. The kernel rounds the length to
+	// float, the factor has a little room for that.
+	std::vector<glm::dvec3> extents(vertical_segments);
+	auto bounds = EmptyBounds();
+	for (int v = 0; v < vertical_segments; ++v)
+	{
+		auto p = mesh.parametric_line(v / double(vertical_segments - 1));
+		auto y = p.y * 4. / 3. * std::pow(4. / 3. * glm::length(p), 1.3) * (1 + 1e-6);
+		extents[v] = glm::dvec3(std::abs(p.x), std::min(y, 0.), std::max(y, 0.));
+		ExtendBounds(bounds, glm::dvec3(-std::abs(p.x), extents[v].y, -std::abs(p.x)));
+		ExtendBounds(bounds, glm::dvec3(std::abs(p.x), extents[v].z, std::abs(p.x)));
+	}
+	bounds.center = glm::dvec3(0, (bounds.min.y + bounds.max.y) / 2, 0);
+	bounds.radius = 0;
+	for (auto& extent : extents)
+	{
+		auto y = std::max(std::abs(extent.y - bounds.center.y), std::abs(extent.z - bounds.center.y));
+		bounds.radius = std::max(bounds.radius, glm::length(glm::dvec2(extent.x, y)));
+	}
+	return bounds;
+}
+
+VAO CreateProceduralVAO(const ProceduralMesh& mesh, const GridIndexOptions& options, bool shared_topology)
+{
+	auto index_options = options;
+	index_options.pole_fans = false;
+	auto plan = PlanGridMesh(mesh.vertical_segments, mesh.rotation_segments, index_options);
+	VAO vao(static_cast<GLsizei>(plan.index_count), plan.index_format, false);
+	vao.bounds = ProceduralBounds(mesh);
+
+	// No vertex is ever written, the element array is the whole mesh
+	if (!CreateGridElementArray(vao, plan, shared_topology))
+		std::cout << "Error: Writing the indices of a procedural surface failed" << std::endl;
+	return vao;
+}
+
+/* Shaders */
+// The same arithmetic as GenerateRevolutionSurfaceMesh and ParametricSurfacev2Kernel, in single precision
+const GLchar* const procedural_surface_shader = R"PROCEDURAL(
+		uniform ivec2 u_grid;		// vertical_segments, rotation_segments
+		uniform vec4 u_profile;		// angle_span, radius, offset, spike_frequency
+		uniform int u_surface;		// 0 for ProceduralSurface::Revolution, 1 for ProceduralSurface::Surfacev2
+
+		const float procedural_two_pi = 6.28318530717958647692;
+
+		vec2 ProceduralProfile(float t)
+		{
+			float angle = (t - 0.5) * u_profile.x;
+			vec2 p = vec2(cos(angle), sin(angle));
+			if (u_profile.w > 0.0)
+				p += vec2(sin(u_profile.w * angle), cos(u_profile.w * angle)) / u_profile.w;
+			return p * u_profile.y + vec2(u_profile.z, 0.0);
+		}
+
+		// Grid column v may be -1 or u_grid.x for the central differences
+		vec2 ProceduralGridProfile(int v)
+		{
+			return ProceduralProfile(float(v) / float(u_grid.x - 1));
+		}
+
+		vec3 ProceduralSurfacev2(int v, int r)
+		{
+			vec2 p = ProceduralGridProfile(v);
+			float rotation = float(r) / float(u_grid.y);
+
+			p *= (sin(rotation * 5.0 * procedural_two_pi) + 3.0) / 4.0;
+			float wave = sin((rotation + 0.5) * 5.0 * procedural_two_pi);
+			float wave_squared = wave * wave;
+			p.y *= (wave_squared * wave_squared * wave_squared + 3.0) / 3.0;
+
+			float xy_len = length(p);
+			p.y *= pow(xy_len, 1.3);
+			float angle = sin(xy_len * 1.2 * procedural_two_pi * 0.4) + rotation * procedural_two_pi;
+			return vec3(p.x * cos(angle), p.y, -p.x * sin(angle));
+		}
+
+		// Position and normal of the grid vertex, the seam row of chunked meshes is row 0 again
+		void ProceduralVertex(int vertex_id, out vec3 position, out vec3 normal)
+		{
+			int v = vertex_id % u_grid.x;
+			int r = (vertex_id / u_grid.x) % u_grid.y;
+
+			if (u_surface == 0)
+			{
+				// The in-plane normal of the profile, rotated around Y it becomes the surface normal
+				vec2 p = ProceduralGridProfile(v);
+				vec2 tangent = (ProceduralGridProfile(v + 1) - ProceduralGridProfile(v - 1)) / 2.0;
+				vec2 profile_normal = normalize(vec2(tangent.y, -tangent.x)) * (p.x < 0.0 ? -1.0 : 1.0);
+
+				float angle = float(r) / float(u_grid.y) * procedural_two_pi;
+				float cos_r = cos(angle);
+				float sin_r = sin(angle);
+				position = vec3(p.x * cos_r, p.y, -p.x * sin_r);
+				normal = vec3(profile_normal.x * cos_r, profile_normal.y, -profile_normal.x * sin_r);
+				return;
+			}
+
+			position = ProceduralSurfacev2(v, r);
+			vec3 tangent_v = (ProceduralSurfacev2(v + 1, r) - ProceduralSurfacev2(v - 1, r)) / 2.0;
+			vec3 tangent_r = (ProceduralSurfacev2(v, r + 1) - ProceduralSurfacev2(v, r - 1)) / 2.0;
+			normal = normalize(cross(tangent_r, tangent_v));
+		}
+)PROCEDURAL";
+
+ProceduralUniforms GetProceduralUniforms(GLuint program)
+{
+	return { glGetUniformLocation(program, "u_grid"), glGetUniformLocation(program, "u_profile"), glGetUniformLocation(program, "u_surface") };
+}
+
+void SetProceduralUniforms(const ProceduralUniforms& uniforms, const ProceduralMesh& mesh)
+{
+	auto& profile = mesh.profile;
+	glUniform2i(uniforms.grid, mesh.vertical_segments, mesh.rotation_segments);
+	glUniform4f(uniforms.profile, profile.angle_span, profile.radius, profile.offset, profile.spike_frequency);
+	glUniform1i(uniforms.surface, mesh.surface == ProceduralSurface::Surfacev2 ? 1 : 0);
+}
+
+/* Validation */
+// Vertex shader only program that writes ProceduralVertex to the transform feedback buffer
+static GLuint CreateCaptureProgram()
+{
+	auto source = std::string("#version 330 core\n") + procedural_surface_shader + R"VERTEX(
+		out vec3 captured_position;
+		out vec3 captured_normal;
+
+		void main()
+		{
+			ProceduralVertex(gl_VertexID, captured_position, captured_normal);
+			gl_Position = vec4(captured_position, 1);
+		}
+		)VERTEX";
+
+	GLuint vertex_shader = CreateShaderFromSource(GL_VERTEX_SHADER, source.c_str());
+	if (vertex_shader == 0)
+		return 0;
+
+	// The varyings have to be known before linking
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	const GLchar* varyings[] = { "captured_position", "captured_normal" };
+	glTransformFeedbackVaryings(program, 2, varyings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(program);
+	glDeleteShader(vertex_shader);
+
+	int success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		std::cout << "Error: Program Linking failed" << std::endl;
+
+		char info_log[512];
+		glGetProgramInfoLog(program, 512, NULL, info_log);
+		std::cout << info_log << std::endl;
+
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+bool ValidateProceduralSurface(const ProceduralMesh& mesh, double tolerance)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+	if (mesh.surface == ProceduralSurface::Revolution)
+		GenerateParametricShapeFrom2D<double>(positions, normals, indices, mesh.parametric_line, mesh.vertical_segments, mesh.rotation_segments);
+	else
+		GenerateParametricShapeFrom2Dv2<double>(positions, normals, indices, mesh.parametric_line, mesh.vertical_segments, mesh.rotation_segments);
+
+	auto program = CreateCaptureProgram();
+	if (program == 0)
+		return false;
+
+	GLint previous_program;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous_program);
+
+	// The core profile draws nothing without a VAO, even when no attribute is read
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	auto vertex_count = static_cast<GLsizei>(positions.size());
+	auto capture_size = GLsizeiptr(vertex_count) * 2 * sizeof(glm::vec3);
+	GLuint capture_buffer;
+	glGenBuffers(1, &capture_buffer);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, capture_buffer);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, capture_size, NULL, GL_STATIC_READ);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, capture_buffer);
+
+	glUseProgram(program);
+	SetProceduralUniforms(GetProceduralUniforms(program), mesh);
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, vertex_count);
+	glEndTransformFeedback();
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	// Position and normal of every vertex, interleaved
+	std::vector<glm::vec3> captured(size_t(vertex_count) * 2);
+	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, capture_size, captured.data());
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glDeleteBuffers(1, &capture_buffer);
+	glDeleteVertexArrays(1, &vao);
+	glUseProgram(GLuint(previous_program));
+	glDeleteProgram(program);
+
+	glm::dvec3 min = positions[0], max = positions[0];
+	for (auto& position : positions)
+	{
+		min = glm::min(min, glm::dvec3(position));
+		max = glm::max(max, glm::dvec3(position));
+	}
+	auto size = max - min;
+	auto mesh_size = std::max({ size.x, size.y, size.z });
+
+	// On the Y axis the surfaces collapse to a point or fold onto themselves, the normals there point along whichever
+	// side of the axis rounding put the profile and are left out
+	auto axis_tolerance = grid_pole_tolerance * mesh_size;
+
+	double max_position_error = 0;
+	double max_normal_degrees = 0;
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		auto error = glm::distance(glm::dvec3(captured[i * 2]), glm::dvec3(positions[i]));
+		if (std::isnan(error))
+			error = HUGE_VAL;
+		max_position_error = std::max(max_position_error, error);
+
+		if (glm::length(glm::dvec2(positions[i].x, positions[i].z)) <= axis_tolerance)
+			continue;
+
+		auto cpu_normal = glm::dvec3(normals[i]);
+		auto gpu_normal = glm::dvec3(captured[i * 2 + 1]);
+		if (std::isfinite(glm::dot(cpu_normal, cpu_normal)) && std::isfinite(glm::dot(gpu_normal, gpu_normal)))
+		{
+			auto cosine = glm::clamp(glm::dot(glm::normalize(cpu_normal), glm::normalize(gpu_normal)), -1., 1.);
+			max_normal_degrees = std::max(max_normal_degrees, glm::degrees(std::acos(cosine)));
+		}
+	}
+
+	auto passed = max_position_error <= tolerance * mesh_size;
+	std::cout << "GPU procedural " << (mesh.surface == ProceduralSurface::Revolution ? "revolution" : "v2") << " surface of "
+		<< mesh.profile_name << " " << mesh.vertical_segments << "x" << mesh.rotation_segments << ": max position error " << max_position_error / mesh_size
+		<< " of the mesh size, max normal deviation " << max_normal_degrees << " degrees, " << (passed ? "passed" : "FAILED") << std::endl;
+	return passed;
+}
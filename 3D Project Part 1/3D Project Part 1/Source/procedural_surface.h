@@ -0,0 +1,78 @@
+#pragma once
+
+#include "GLM/glm.hpp"
+#include "GLAD/glad.h"
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/*
+	Grid meshes whose vertices are never stored. The vertex shader rebuilds every vertex from gl_VertexID and the
+	segment counts by evaluating the example surfaces of mesh_generation.h in GLSL, so only the element array of
+	the grid is uploaded. The normals are the central differences of the neighbouring grid points, like
+	NormalMethod::SampledGrid computes them on the CPU.
+
+	Every example profile belongs to one family of curves, the uniforms select the member:
+		a = (t - 0.5) * angle_span
+		p = (cos a + sin(f a) / f, sin a + cos(f a) / f) * radius + (offset, 0)
+	where the f terms are left out for spike_frequency f = 0.
+*/
+
+/* Procedural Surfaces */
+enum class ProceduralSurface
+{
+	Revolution,		// The profile rotated around Y, as GenerateParametricShapeFrom2D builds it
+	Surfacev2		// ParametricSurfacev2 of the profile, as GenerateParametricShapeFrom2Dv2 builds it
+};
+
+struct ProceduralProfile
+{
+	float angle_span;
+	float radius;
+	float offset;
+	float spike_frequency;
+};
+
+struct ProceduralMesh
+{
+	ProceduralSurface surface;
+	glm::dvec2(*parametric_line)(double);
+	const char* profile_name;
+	ProceduralProfile profile;
+
+	int vertical_segments;
+	int rotation_segments;
+};
+
+// Fills in mesh.profile for one of the example profiles, false for any other function
+bool CreateProceduralMesh(ProceduralMesh& mesh, ProceduralSurface surface, glm::dvec2(*parametric_line)(double), int vertical_segments, int rotation_segments);
+
+// Element array only VAO of the grid, see VAO(element_array_count, index_format). Pole fans are off, the shader
+// does not know where the poles are. Chunked short indices work, the seam row is row 0 again. The bounds hold the
+// grid points of the CPU generator, they are worked out from the profile without evaluating the surface.
+// With shared_topology the element array comes from the topology registry when an earlier grid registered it.
+VAO CreateProceduralVAO(const ProceduralMesh& mesh, const GridIndexOptions& options, bool shared_topology = false);
+
+/* Shaders */
+// GLSL declarations to insert after the #version line of a vertex shader. They declare the uniforms u_grid,
+// u_profile and u_surface and the function void ProceduralVertex(int vertex_id, out vec3 position, out vec3 normal).
+extern const GLchar* const procedural_surface_shader;
+
+// Locations of the uniforms of procedural_surface_shader in a program, look them up once after linking
+struct ProceduralUniforms
+{
+	GLint grid;
+	GLint profile;
+	GLint surface;
+};
+
+ProceduralUniforms GetProceduralUniforms(GLuint program);
+
+// Sets the uniforms of procedural_surface_shader in the current program, uniforms are the locations in it
+void SetProceduralUniforms(const ProceduralUniforms& uniforms, const ProceduralMesh& mesh);
+
+/* Validation */
+// Captures the shader positions and normals of every grid point with transform feedback and compares them with the
+// double precision CPU generator. Needs a current GL 3.3 context, a software driver like Mesa llvmpipe is enough.
+// Returns false when a position is further than tolerance times the mesh size from the CPU one.
+bool ValidateProceduralSurface(const ProceduralMesh& mesh, double tolerance = 1e-4);
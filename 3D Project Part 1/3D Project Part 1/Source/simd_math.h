@@ -0,0 +1,555 @@
+#pragma once
+
+#include <cmath>
+
+/*
+	SimdDouble holds SimdDouble::lane_count doubles and is evaluated one instruction for all lanes.
+	AVX2 gives 4 lanes, SSE2 gives 2 lanes, anything else falls back to a single scalar lane. The lanes are chosen
+	at compile time, AVX2 only for builds that target it with /arch:AVX2 or -mavx2. The project builds for the SSE2
+	baseline every x64 CPU has, so the executable runs on machines without AVX2.
+	SimdFloat is the same for floats with twice the lanes.
+
+	Sin, Cos, Log, Exp and Pow use Cephes style polynomials on the SIMD lanes, they stay within a few ulp
+	of the C library. The same function names are overloaded for double and float and call the C library,
+	so a kernel written as a template over the number type runs unchanged on all of them.
+*/
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_MATH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_MATH_SSE2
+#endif
+
+/* Scalar Functions */
+inline double Sin(double x) { return std::sin(x); }
+inline double Cos(double x) { return std::cos(x); }
+inline double Sqrt(double x) { return std::sqrt(x); }
+inline double Pow(double x, double y) { return std::pow(x, y); }
+inline double PowInt(double x, int n) { return std::pow(x, n); }
+
+// Rounds to the nearest float, for reproducing math that glm does in single precision
+inline double RoundToFloat(double x) { return double(float(x)); }
+
+inline float Sin(float x) { return std::sin(x); }
+inline float Cos(float x) { return std::cos(x); }
+inline float Sqrt(float x) { return std::sqrt(x); }
+inline float Pow(float x, float y) { return std::pow(x, y); }
+inline float PowInt(float x, int n) { return float(std::pow(x, n)); }
+inline float RoundToFloat(float x) { return x; }
+
+/* SIMD Types */
+#if defined(SIMD_MATH_AVX2)
+
+struct SimdDouble
+{
+	static const int lane_count = 4;
+
+	__m256d value;
+
+	SimdDouble() = default;
+	SimdDouble(__m256d value) : value(value) {}
+	SimdDouble(double scalar) : value(_mm256_set1_pd(scalar)) {}
+
+	static SimdDouble Load(const double* source) { return _mm256_loadu_pd(source); }
+	void Store(double* destination) const { _mm256_storeu_pd(destination, value); }
+};
+
+inline SimdDouble operator+(const SimdDouble& a, const SimdDouble& b) { return _mm256_add_pd(a.value, b.value); }
+inline SimdDouble operator-(const SimdDouble& a, const SimdDouble& b) { return _mm256_sub_pd(a.value, b.value); }
+inline SimdDouble operator*(const SimdDouble& a, const SimdDouble& b) { return _mm256_mul_pd(a.value, b.value); }
+inline SimdDouble operator/(const SimdDouble& a, const SimdDouble& b) { return _mm256_div_pd(a.value, b.value); }
+inline SimdDouble operator-(const SimdDouble& a) { return _mm256_xor_pd(a.value, _mm256_set1_pd(-0.0)); }
+
+// Comparisons return lane masks with every bit set where the comparison holds
+inline SimdDouble operator<(const SimdDouble& a, const SimdDouble& b) { return _mm256_cmp_pd(a.value, b.value, _CMP_LT_OQ); }
+inline SimdDouble operator>(const SimdDouble& a, const SimdDouble& b) { return _mm256_cmp_pd(a.value, b.value, _CMP_GT_OQ); }
+inline SimdDouble operator>=(const SimdDouble& a, const SimdDouble& b) { return _mm256_cmp_pd(a.value, b.value, _CMP_GE_OQ); }
+inline SimdDouble operator==(const SimdDouble& a, const SimdDouble& b) { return _mm256_cmp_pd(a.value, b.value, _CMP_EQ_OQ); }
+inline SimdDouble operator|(const SimdDouble& a, const SimdDouble& b) { return _mm256_or_pd(a.value, b.value); }
+
+inline SimdDouble Select(const SimdDouble& mask, const SimdDouble& if_true, const SimdDouble& if_false)
+{
+	return _mm256_blendv_pd(if_false.value, if_true.value, mask.value);
+}
+
+inline SimdDouble Min(const SimdDouble& a, const SimdDouble& b) { return _mm256_min_pd(a.value, b.value); }
+inline SimdDouble Max(const SimdDouble& a, const SimdDouble& b) { return _mm256_max_pd(a.value, b.value); }
+inline SimdDouble Sqrt(const SimdDouble& x) { return _mm256_sqrt_pd(x.value); }
+inline SimdDouble Round(const SimdDouble& x) { return _mm256_round_pd(x.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdDouble RoundToFloat(const SimdDouble& x) { return _mm256_cvtps_pd(_mm256_cvtpd_ps(x.value)); }
+
+// x = mantissa * 2^exponent with mantissa in [0.5, 1), for positive normal x
+inline void SplitExponent(const SimdDouble& x, SimdDouble& mantissa, SimdDouble& exponent)
+{
+	auto bits = _mm256_castpd_si256(x.value);
+	auto two_pow_52 = _mm256_set1_pd(4503599627370496.0);
+	auto exponent_bits = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(two_pow_52));
+	exponent = _mm256_sub_pd(_mm256_sub_pd(_mm256_castsi256_pd(exponent_bits), two_pow_52), _mm256_set1_pd(1022.0));
+
+	auto mantissa_bits = _mm256_and_si256(bits, _mm256_set1_epi64x(0x800FFFFFFFFFFFFFll));
+	mantissa = _mm256_castsi256_pd(_mm256_or_si256(mantissa_bits, _mm256_set1_epi64x(0x3FE0000000000000ll)));
+}
+
+// x * 2^n for integral n in [-1022, 1023]
+inline SimdDouble ScaleByPowerOfTwo(const SimdDouble& x, const SimdDouble& n)
+{
+	auto biased = _mm256_add_pd(n.value, _mm256_set1_pd(4503599627370496.0 + 1023.0));
+	auto power = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52));
+	return _mm256_mul_pd(x.value, power);
+}
+
+struct SimdFloat
+{
+	static const int lane_count = 8;
+
+	__m256 value;
+
+	SimdFloat() = default;
+	SimdFloat(__m256 value) : value(value) {}
+	SimdFloat(float scalar) : value(_mm256_set1_ps(scalar)) {}
+
+	static SimdFloat Load(const float* source) { return _mm256_loadu_ps(source); }
+	void Store(float* destination) const { _mm256_storeu_ps(destination, value); }
+};
+
+inline SimdFloat operator+(const SimdFloat& a, const SimdFloat& b) { return _mm256_add_ps(a.value, b.value); }
+inline SimdFloat operator-(const SimdFloat& a, const SimdFloat& b) { return _mm256_sub_ps(a.value, b.value); }
+inline SimdFloat operator*(const SimdFloat& a, const SimdFloat& b) { return _mm256_mul_ps(a.value, b.value); }
+inline SimdFloat operator/(const SimdFloat& a, const SimdFloat& b) { return _mm256_div_ps(a.value, b.value); }
+inline SimdFloat operator-(const SimdFloat& a) { return _mm256_xor_ps(a.value, _mm256_set1_ps(-0.f)); }
+
+inline SimdFloat operator<(const SimdFloat& a, const SimdFloat& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_LT_OQ); }
+inline SimdFloat operator>(const SimdFloat& a, const SimdFloat& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_GT_OQ); }
+inline SimdFloat operator>=(const SimdFloat& a, const SimdFloat& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_GE_OQ); }
+inline SimdFloat operator==(const SimdFloat& a, const SimdFloat& b) { return _mm256_cmp_ps(a.value, b.value, _CMP_EQ_OQ); }
+inline SimdFloat operator|(const SimdFloat& a, const SimdFloat& b) { return _mm256_or_ps(a.value, b.value); }
+
+inline SimdFloat Select(const SimdFloat& mask, const SimdFloat& if_true, const SimdFloat& if_false)
+{
+	return _mm256_blendv_ps(if_false.value, if_true.value, mask.value);
+}
+
+inline SimdFloat Min(const SimdFloat& a, const SimdFloat& b) { return _mm256_min_ps(a.value, b.value); }
+inline SimdFloat Max(const SimdFloat& a, const SimdFloat& b) { return _mm256_max_ps(a.value, b.value); }
+inline SimdFloat Sqrt(const SimdFloat& x) { return _mm256_sqrt_ps(x.value); }
+inline SimdFloat Round(const SimdFloat& x) { return _mm256_round_ps(x.value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+inline SimdFloat RoundToFloat(const SimdFloat& x) { return x; }
+
+// x = mantissa * 2^exponent with mantissa in [0.5, 1), for positive normal x
+inline void SplitExponent(const SimdFloat& x, SimdFloat& mantissa, SimdFloat& exponent)
+{
+	auto bits = _mm256_castps_si256(x.value);
+	exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+
+	auto mantissa_bits = _mm256_and_si256(bits, _mm256_set1_epi32(0x807FFFFF));
+	mantissa = _mm256_castsi256_ps(_mm256_or_si256(mantissa_bits, _mm256_set1_epi32(0x3F000000)));
+}
+
+// x * 2^n for integral n in [-126, 127]
+inline SimdFloat ScaleByPowerOfTwo(const SimdFloat& x, const SimdFloat& n)
+{
+	auto biased = _mm256_add_epi32(_mm256_cvtps_epi32(n.value), _mm256_set1_epi32(127));
+	return _mm256_mul_ps(x.value, _mm256_castsi256_ps(_mm256_slli_epi32(biased, 23)));
+}
+
+#elif defined(SIMD_MATH_SSE2)
+
+struct SimdDouble
+{
+	static const int lane_count = 2;
+
+	__m128d value;
+
+	SimdDouble() = default;
+	SimdDouble(__m128d value) : value(value) {}
+	SimdDouble(double scalar) : value(_mm_set1_pd(scalar)) {}
+
+	static SimdDouble Load(const double* source) { return _mm_loadu_pd(source); }
+	void Store(double* destination) const { _mm_storeu_pd(destination, value); }
+};
+
+inline SimdDouble operator+(const SimdDouble& a, const SimdDouble& b) { return _mm_add_pd(a.value, b.value); }
+inline SimdDouble operator-(const SimdDouble& a, const SimdDouble& b) { return _mm_sub_pd(a.value, b.value); }
+inline SimdDouble operator*(const SimdDouble& a, const SimdDouble& b) { return _mm_mul_pd(a.value, b.value); }
+inline SimdDouble operator/(const SimdDouble& a, const SimdDouble& b) { return _mm_div_pd(a.value, b.value); }
+inline SimdDouble operator-(const SimdDouble& a) { return _mm_xor_pd(a.value, _mm_set1_pd(-0.0)); }
+
+// Comparisons return lane masks with every bit set where the comparison holds
+inline SimdDouble operator<(const SimdDouble& a, const SimdDouble& b) { return _mm_cmplt_pd(a.value, b.value); }
+inline SimdDouble operator>(const SimdDouble& a, const SimdDouble& b) { return _mm_cmpgt_pd(a.value, b.value); }
+inline SimdDouble operator>=(const SimdDouble& a, const SimdDouble& b) { return _mm_cmpge_pd(a.value, b.value); }
+inline SimdDouble operator==(const SimdDouble& a, const SimdDouble& b) { return _mm_cmpeq_pd(a.value, b.value); }
+inline SimdDouble operator|(const SimdDouble& a, const SimdDouble& b) { return _mm_or_pd(a.value, b.value); }
+
+inline SimdDouble Select(const SimdDouble& mask, const SimdDouble& if_true, const SimdDouble& if_false)
+{
+	return _mm_or_pd(_mm_and_pd(mask.value, if_true.value), _mm_andnot_pd(mask.value, if_false.value));
+}
+
+inline SimdDouble Min(const SimdDouble& a, const SimdDouble& b) { return _mm_min_pd(a.value, b.value); }
+inline SimdDouble Max(const SimdDouble& a, const SimdDouble& b) { return _mm_max_pd(a.value, b.value); }
+inline SimdDouble Sqrt(const SimdDouble& x) { return _mm_sqrt_pd(x.value); }
+inline SimdDouble RoundToFloat(const SimdDouble& x) { return _mm_cvtps_pd(_mm_cvtpd_ps(x.value)); }
+
+// SSE2 has no round instruction, adding 1.5 * 2^52 pushes the fraction out of the mantissa
+inline SimdDouble Round(const SimdDouble& x)
+{
+	auto magic = _mm_set1_pd(6755399441055744.0);
+	return _mm_sub_pd(_mm_add_pd(x.value, magic), magic);
+}
+
+// x = mantissa * 2^exponent with mantissa in [0.5, 1), for positive normal x
+inline void SplitExponent(const SimdDouble& x, SimdDouble& mantissa, SimdDouble& exponent)
+{
+	auto bits = _mm_castpd_si128(x.value);
+	auto two_pow_52 = _mm_set1_pd(4503599627370496.0);
+	auto exponent_bits = _mm_or_si128(_mm_srli_epi64(bits, 52), _mm_castpd_si128(two_pow_52));
+	exponent = _mm_sub_pd(_mm_sub_pd(_mm_castsi128_pd(exponent_bits), two_pow_52), _mm_set1_pd(1022.0));
+
+	auto mantissa_bits = _mm_and_si128(bits, _mm_set1_epi64x(0x800FFFFFFFFFFFFFll));
+	mantissa = _mm_castsi128_pd(_mm_or_si128(mantissa_bits, _mm_set1_epi64x(0x3FE0000000000000ll)));
+}
+
+// x * 2^n for integral n in [-1022, 1023]
+inline SimdDouble ScaleByPowerOfTwo(const SimdDouble& x, const SimdDouble& n)
+{
+	auto biased = _mm_add_pd(n.value, _mm_set1_pd(4503599627370496.0 + 1023.0));
+	auto power = _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(biased), 52));
+	return _mm_mul_pd(x.value, power);
+}
+
+struct SimdFloat
+{
+	static const int lane_count = 4;
+
+	__m128 value;
+
+	SimdFloat() = default;
+	SimdFloat(__m128 value) : value(value) {}
+	SimdFloat(float scalar) : value(_mm_set1_ps(scalar)) {}
+
+	static SimdFloat Load(const float* source) { return _mm_loadu_ps(source); }
+	void Store(float* destination) const { _mm_storeu_ps(destination, value); }
+};
+
+inline SimdFloat operator+(const SimdFloat& a, const SimdFloat& b) { return _mm_add_ps(a.value, b.value); }
+inline SimdFloat operator-(const SimdFloat& a, const SimdFloat& b) { return _mm_sub_ps(a.value, b.value); }
+inline SimdFloat operator*(const SimdFloat& a, const SimdFloat& b) { return _mm_mul_ps(a.value, b.value); }
+inline SimdFloat operator/(const SimdFloat& a, const SimdFloat& b) { return _mm_div_ps(a.value, b.value); }
+inline SimdFloat operator-(const SimdFloat& a) { return _mm_xor_ps(a.value, _mm_set1_ps(-0.f)); }
+
+inline SimdFloat operator<(const SimdFloat& a, const SimdFloat& b) { return _mm_cmplt_ps(a.value, b.value); }
+inline SimdFloat operator>(const SimdFloat& a, const SimdFloat& b) { return _mm_cmpgt_ps(a.value, b.value); }
+inline SimdFloat operator>=(const SimdFloat& a, const SimdFloat& b) { return _mm_cmpge_ps(a.value, b.value); }
+inline SimdFloat operator==(const SimdFloat& a, const SimdFloat& b) { return _mm_cmpeq_ps(a.value, b.value); }
+inline SimdFloat operator|(const SimdFloat& a, const SimdFloat& b) { return _mm_or_ps(a.value, b.value); }
+
+inline SimdFloat Select(const SimdFloat& mask, const SimdFloat& if_true, const SimdFloat& if_false)
+{
+	return _mm_or_ps(_mm_and_ps(mask.value, if_true.value), _mm_andnot_ps(mask.value, if_false.value));
+}
+
+inline SimdFloat Min(const SimdFloat& a, const SimdFloat& b) { return _mm_min_ps(a.value, b.value); }
+inline SimdFloat Max(const SimdFloat& a, const SimdFloat& b) { return _mm_max_ps(a.value, b.value); }
+inline SimdFloat Sqrt(const SimdFloat& x) { return _mm_sqrt_ps(x.value); }
+inline SimdFloat RoundToFloat(const SimdFloat& x) { return x; }
+
+// Float to int conversion rounds to nearest, fine for the |x| < 2^31 the math functions need
+inline SimdFloat Round(const SimdFloat& x) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(x.value)); }
+
+// x = mantissa * 2^exponent with mantissa in [0.5, 1), for positive normal x
+inline void SplitExponent(const SimdFloat& x, SimdFloat& mantissa, SimdFloat& exponent)
+{
+	auto bits = _mm_castps_si128(x.value);
+	exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+
+	auto mantissa_bits = _mm_and_si128(bits, _mm_set1_epi32(0x807FFFFF));
+	mantissa = _mm_castsi128_ps(_mm_or_si128(mantissa_bits, _mm_set1_epi32(0x3F000000)));
+}
+
+// x * 2^n for integral n in [-126, 127]
+inline SimdFloat ScaleByPowerOfTwo(const SimdFloat& x, const SimdFloat& n)
+{
+	auto biased = _mm_add_epi32(_mm_cvtps_epi32(n.value), _mm_set1_epi32(127));
+	return _mm_mul_ps(x.value, _mm_castsi128_ps(_mm_slli_epi32(biased, 23)));
+}
+
+#else
+
+// Scalar fallback, a single lane that forwards to the C library
+struct SimdDouble
+{
+	static const int lane_count = 1;
+
+	double value;
+
+	SimdDouble() = default;
+	SimdDouble(double scalar) : value(scalar) {}
+
+	static SimdDouble Load(const double* source) { return *source; }
+	void Store(double* destination) const { *destination = value; }
+};
+
+inline SimdDouble operator+(const SimdDouble& a, const SimdDouble& b) { return a.value + b.value; }
+inline SimdDouble operator-(const SimdDouble& a, const SimdDouble& b) { return a.value - b.value; }
+inline SimdDouble operator*(const SimdDouble& a, const SimdDouble& b) { return a.value * b.value; }
+inline SimdDouble operator/(const SimdDouble& a, const SimdDouble& b) { return a.value / b.value; }
+inline SimdDouble operator-(const SimdDouble& a) { return -a.value; }
+
+inline SimdDouble Sin(const SimdDouble& x) { return std::sin(x.value); }
+inline SimdDouble Cos(const SimdDouble& x) { return std::cos(x.value); }
+inline SimdDouble Sqrt(const SimdDouble& x) { return std::sqrt(x.value); }
+inline SimdDouble Pow(const SimdDouble& x, const SimdDouble& y) { return std::pow(x.value, y.value); }
+inline SimdDouble PowInt(const SimdDouble& x, int n) { return std::pow(x.value, n); }
+inline SimdDouble RoundToFloat(const SimdDouble& x) { return double(float(x.value)); }
+
+struct SimdFloat
+{
+	static const int lane_count = 1;
+
+	float value;
+
+	SimdFloat() = default;
+	SimdFloat(float scalar) : value(scalar) {}
+
+	static SimdFloat Load(const float* source) { return *source; }
+	void Store(float* destination) const { *destination = value; }
+};
+
+inline SimdFloat operator+(const SimdFloat& a, const SimdFloat& b) { return a.value + b.value; }
+inline SimdFloat operator-(const SimdFloat& a, const SimdFloat& b) { return a.value - b.value; }
+inline SimdFloat operator*(const SimdFloat& a, const SimdFloat& b) { return a.value * b.value; }
+inline SimdFloat operator/(const SimdFloat& a, const SimdFloat& b) { return a.value / b.value; }
+inline SimdFloat operator-(const SimdFloat& a) { return -a.value; }
+
+inline SimdFloat Sin(const SimdFloat& x) { return std::sin(x.value); }
+inline SimdFloat Cos(const SimdFloat& x) { return std::cos(x.value); }
+inline SimdFloat Sqrt(const SimdFloat& x) { return std::sqrt(x.value); }
+inline SimdFloat Pow(const SimdFloat& x, const SimdFloat& y) { return std::pow(x.value, y.value); }
+inline SimdFloat PowInt(const SimdFloat& x, int n) { return float(std::pow(x.value, n)); }
+inline SimdFloat RoundToFloat(const SimdFloat& x) { return x; }
+
+#endif
+
+/* SIMD Functions */
+#if defined(SIMD_MATH_AVX2) || defined(SIMD_MATH_SSE2)
+
+inline SimdDouble Floor(const SimdDouble& x)
+{
+	auto rounded = Round(x);
+	return rounded - Select(rounded > x, 1., 0.);
+}
+
+inline void SinCos(const SimdDouble& x, SimdDouble& sin_x, SimdDouble& cos_x)
+{
+	// x = quadrant * PI/2 + reduced, PI/2 split in three parts so the reduction stays exact
+	auto quadrant = Round(x * 0.63661977236758134308);
+	auto reduced = ((x - quadrant * 1.57079625129699707031) - quadrant * 7.54978941586159635336E-8) - quadrant * 5.39030285815811905290E-15;
+
+	// Minimax polynomials on [-PI/4, PI/4]
+	auto z = reduced * reduced;
+	auto sin_polynomial = ((((1.58962301576546568060E-10 * z - 2.50507477628578072866E-8) * z + 2.75573136213857245213E-6) * z
+		- 1.98412698295895385996E-4) * z + 8.33333333332211858878E-3) * z - 1.66666666666666307295E-1;
+	auto cos_polynomial = ((((-1.13585365213876817300E-11 * z + 2.08757008419747316778E-9) * z - 2.75573141792967388112E-7) * z
+		+ 2.48015872888517045348E-5) * z - 1.38888888888730564116E-3) * z + 4.16666666666665929218E-2;
+	auto sin_reduced = reduced + reduced * z * sin_polynomial;
+	auto cos_reduced = 1. - 0.5 * z + z * z * cos_polynomial;
+
+	// Quadrant 0..3 picks which of the two results to use and its sign
+	auto quadrant_mod_4 = quadrant - 4. * Floor(quadrant * 0.25);
+	auto odd = (quadrant_mod_4 == 1.) | (quadrant_mod_4 == 3.);
+	auto sin_base = Select(odd, cos_reduced, sin_reduced);
+	auto cos_base = Select(odd, sin_reduced, cos_reduced);
+	sin_x = Select(quadrant_mod_4 >= 2., -sin_base, sin_base);
+	cos_x = Select((quadrant_mod_4 == 1.) | (quadrant_mod_4 == 2.), -cos_base, cos_base);
+}
+
+inline SimdDouble Sin(const SimdDouble& x)
+{
+	SimdDouble sin_x, cos_x;
+	SinCos(x, sin_x, cos_x);
+	return sin_x;
+}
+
+inline SimdDouble Cos(const SimdDouble& x)
+{
+	SimdDouble sin_x, cos_x;
+	SinCos(x, sin_x, cos_x);
+	return cos_x;
+}
+
+// Natural logarithm for positive normal x
+inline SimdDouble Log(const SimdDouble& x)
+{
+	SimdDouble mantissa, exponent;
+	SplitExponent(x, mantissa, exponent);
+
+	// Keep the mantissa in [sqrt(0.5), sqrt(2)) so the polynomial sees a small argument
+	auto small = mantissa < 0.70710678118654752440;
+	exponent = exponent - Select(small, 1., 0.);
+	auto m = Select(small, mantissa + mantissa, mantissa) - 1.;
+
+	auto z = m * m;
+	auto p = ((((1.01875663804580931796E-4 * m + 4.97494994976747001425E-1) * m + 4.70579119878881725854E0) * m
+		+ 1.44989225341610930846E1) * m + 1.79368678507819816313E1) * m + 7.70838733755885391666E0;
+	auto q = ((((m + 1.12873587189167450590E1) * m + 4.52279145837532221105E1) * m + 8.29875266912776603211E1) * m
+		+ 7.11544750618563894466E1) * m + 2.31251620126765340583E1;
+
+	auto y = m * (z * p / q);
+	y = y - exponent * 2.121944400546905827679E-4;
+	y = y - 0.5 * z;
+	return (m + y) + exponent * 0.693359375;
+}
+
+inline SimdDouble Exp(const SimdDouble& x)
+{
+	auto clamped = Min(Max(x, -708.), 709.);
+
+	// x = n * ln(2) + reduced, ln(2) split in two parts
+	auto n = Round(clamped * 1.4426950408889634073599);
+	auto reduced = (clamped - n * 6.93145751953125E-1) - n * 1.42860682030941723212E-6;
+
+	auto z = reduced * reduced;
+	auto p = reduced * ((1.26177193074810590878E-4 * z + 3.02994407707441961300E-2) * z + 9.99999999999999999910E-1);
+	auto q = ((3.00198505138664455042E-6 * z + 2.52448340349684104192E-3) * z + 2.27265548208155028766E-1) * z + 2.00000000000000000009E0;
+	auto result = ScaleByPowerOfTwo(1. + 2. * (p / (q - p)), n);
+
+	// Below the clamp the result underflows to zero
+	return Select(x < -708., 0., result);
+}
+
+// x^y for x >= 0
+inline SimdDouble Pow(const SimdDouble& x, const SimdDouble& y)
+{
+	return Select(x == 0., 0., Exp(y * Log(x)));
+}
+
+inline SimdDouble PowInt(const SimdDouble& x, int n)
+{
+	SimdDouble result = 1.;
+	SimdDouble power = x;
+	for (int e = n < 0 ? -n : n; e != 0; e >>= 1)
+	{
+		if (e & 1)
+			result = result * power;
+		power = power * power;
+	}
+	return n < 0 ? 1. / result : result;
+}
+
+inline SimdFloat Floor(const SimdFloat& x)
+{
+	auto rounded = Round(x);
+	return rounded - Select(rounded > x, 1.f, 0.f);
+}
+
+inline void SinCos(const SimdFloat& x, SimdFloat& sin_x, SimdFloat& cos_x)
+{
+	// x = quadrant * PI/2 + reduced, PI/2 split in three parts so the reduction stays exact
+	auto quadrant = Round(x * 0.63661977236758134308f);
+	auto reduced = ((x - quadrant * 1.5703125f) - quadrant * 4.837512969970703125E-4f) - quadrant * 7.54978995489188216E-8f;
+
+	// Minimax polynomials on [-PI/4, PI/4]
+	auto z = reduced * reduced;
+	auto sin_reduced = reduced + reduced * z * ((-1.9515295891E-4f * z + 8.3321608736E-3f) * z - 1.6666654611E-1f);
+	auto cos_reduced = 1.f - 0.5f * z + z * z * ((2.443315711809948E-5f * z - 1.388731625493765E-3f) * z + 4.166664568298827E-2f);
+
+	// Quadrant 0..3 picks which of the two results to use and its sign
+	auto quadrant_mod_4 = quadrant - 4.f * Floor(quadrant * 0.25f);
+	auto odd = (quadrant_mod_4 == 1.f) | (quadrant_mod_4 == 3.f);
+	auto sin_base = Select(odd, cos_reduced, sin_reduced);
+	auto cos_base = Select(odd, sin_reduced, cos_reduced);
+	sin_x = Select(quadrant_mod_4 >= 2.f, -sin_base, sin_base);
+	cos_x = Select((quadrant_mod_4 == 1.f) | (quadrant_mod_4 == 2.f), -cos_base, cos_base);
+}
+
+inline SimdFloat Sin(const SimdFloat& x)
+{
+	SimdFloat sin_x, cos_x;
+	SinCos(x, sin_x, cos_x);
+	return sin_x;
+}
+
+inline SimdFloat Cos(const SimdFloat& x)
+{
+	SimdFloat sin_x, cos_x;
+	SinCos(x, sin_x, cos_x);
+	return cos_x;
+}
+
+// Natural logarithm for positive normal x
+inline SimdFloat Log(const SimdFloat& x)
+{
+	SimdFloat mantissa, exponent;
+	SplitExponent(x, mantissa, exponent);
+
+	auto small = mantissa < 0.70710678118654752440f;
+	exponent = exponent - Select(small, 1.f, 0.f);
+	auto m = Select(small, mantissa + mantissa, mantissa) - 1.f;
+
+	auto z = m * m;
+	auto p = (((((((7.0376836292E-2f * m - 1.1514610310E-1f) * m + 1.1676998740E-1f) * m - 1.2420140846E-1f) * m
+		+ 1.4249322787E-1f) * m - 1.6668057665E-1f) * m + 2.0000714765E-1f) * m - 2.4999993993E-1f) * m + 3.3333331174E-1f;
+
+	auto y = m * z * p;
+	y = y - exponent * 2.12194440E-4f;
+	y = y - 0.5f * z;
+	return (m + y) + exponent * 0.693359375f;
+}
+
+inline SimdFloat Exp(const SimdFloat& x)
+{
+	auto clamped = Min(Max(x, -87.f), 88.f);
+
+	// x = n * ln(2) + reduced, ln(2) split in two parts
+	auto n = Round(clamped * 1.44269504088896341f);
+	auto reduced = (clamped - n * 0.693359375f) + n * 2.12194440E-4f;
+
+	auto z = reduced * reduced;
+	auto p = (((((1.9875691500E-4f * reduced + 1.3981999507E-3f) * reduced + 8.3334519073E-3f) * reduced
+		+ 4.1665795894E-2f) * reduced + 1.6666665459E-1f) * reduced + 5.0000001201E-1f) * z + reduced + 1.f;
+	auto result = ScaleByPowerOfTwo(p, n);
+
+	// Below the clamp the result underflows to zero
+	return Select(x < -87.f, 0.f, result);
+}
+
+// x^y for x >= 0
+inline SimdFloat Pow(const SimdFloat& x, const SimdFloat& y)
+{
+	return Select(x == 0.f, 0.f, Exp(y * Log(x)));
+}
+
+inline SimdFloat PowInt(const SimdFloat& x, int n)
+{
+	SimdFloat result = 1.f;
+	SimdFloat power = x;
+	for (int e = n < 0 ? -n : n; e != 0; e >>= 1)
+	{
+		if (e & 1)
+			result = result * power;
+		power = power * power;
+	}
+	return n < 0 ? 1.f / result : result;
+}
+
+#endif
+
+/* SIMD Type Selection */
+// SimdType<double>::type is SimdDouble, SimdType<float>::type is SimdFloat
+template <typename T>
+struct SimdType;
+
+template <>
+struct SimdType<double>
+{
+	using type = SimdDouble;
+};
+
+template <>
+struct SimdType<float>
+{
+	using type = SimdFloat;
+};
@@ -0,0 +1,123 @@
+#include "topology_registry.h"
+
+#include <map>
+#include <tuple>
+
+#include "parametric_generator.h"
+
+/* Topology Keys */
+bool operator<(const TopologyKey& a, const TopologyKey& b)
+{
+	return std::make_tuple(a.vertical_segments, a.rotation_segments, a.poles.first, a.poles.last, a.primitive, a.type, a.element_array_count)
+		< std::make_tuple(b.vertical_segments, b.rotation_segments, b.poles.first, b.poles.last, b.primitive, b.type, b.element_array_count);
+}
+
+TopologyKey GridTopologyKey(const GridMeshPlan& plan)
+{
+	TopologyKey key;
+	key.vertical_segments = plan.vertical_segments;
+	key.rotation_segments = plan.rotation_segments;
+	key.poles = plan.poles;
+	key.primitive = plan.index_format.primitive;
+	key.type = plan.index_format.type;
+	key.element_array_count = GLsizei(plan.index_count);
+	return key;
+}
+
+/* Shared Element Buffers */
+// The registry holds one reference itself, the VAOs hold the others
+static std::map<TopologyKey, std::shared_ptr<SharedElementBuffer>> topology_registry;
+static TopologyStatistics topology_statistics = {};
+
+bool HasSharedTopology(const TopologyKey& key)
+{
+	return topology_registry.count(key) != 0;
+}
+
+bool AttachSharedTopology(VAO& vao, const TopologyKey& key)
+{
+	auto registered = topology_registry.find(key);
+	if (registered == topology_registry.end())
+		return false;
+
+	// The element array buffer binding is part of the VAO state
+	glBindVertexArray(vao.id);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, registered->second->id);
+
+	vao.element_array_buffer = registered->second->id;
+	vao.shared_element_array = registered->second;
+	++topology_statistics.attached_vaos;
+	topology_statistics.bytes_saved += size_t(registered->second->size);
+	return true;
+}
+
+void RegisterSharedTopology(VAO& vao, const TopologyKey& key)
+{
+	if (vao.shared_element_array || topology_registry.count(key) != 0)
+		return;
+
+	auto size = GLsizeiptr(key.element_array_count) * vao.index_format.IndexSize();
+	vao.shared_element_array = std::make_shared<SharedElementBuffer>(SharedElementBuffer{ vao.element_array_buffer, size });
+	topology_registry[key] = vao.shared_element_array;
+	++topology_statistics.element_buffers;
+}
+
+bool CreateGridElementArray(VAO& vao, const GridMeshPlan& plan, bool shared)
+{
+	vao.element_array_count = GLsizei(plan.index_count);
+	vao.index_format = plan.index_format;
+	auto key = GridTopologyKey(plan);
+	if (shared && AttachSharedTopology(vao, key))
+		return true;
+
+	// The grid indices go straight into the mapped element array
+	auto size = GLsizeiptr(plan.index_count) * plan.index_format.IndexSize();
+	glBindVertexArray(vao.id);
+	glGenBuffers(1, &vao.element_array_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vao.element_array_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, NULL, GL_STATIC_DRAW);
+
+	MeshSpan span = { NULL, NULL, NULL, plan.vertex_count, plan.index_count };
+	MeshSpanLayout layout{ span };
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		span.indices = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (span.indices == NULL)
+			break;
+
+		GenerateGridIndices(layout, plan);
+		if (glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE)
+		{
+			if (shared)
+				RegisterSharedTopology(vao, key);
+			return true;
+		}
+	}
+
+	std::cout << "Error: Writing the grid indices of a " << plan.vertical_segments << "x" << plan.rotation_segments << " mesh failed" << std::endl;
+	return false;
+}
+
+size_t ReleaseUnusedTopologies()
+{
+	size_t released = 0;
+	for (auto entry = topology_registry.begin(); entry != topology_registry.end();)
+	{
+		if (entry->second.use_count() > 1)
+		{
+			++entry;
+			continue;
+		}
+
+		glDeleteBuffers(1, &entry->second->id);
+		entry = topology_registry.erase(entry);
+		--topology_statistics.element_buffers;
+		++released;
+	}
+	return released;
+}
+
+TopologyStatistics GetTopologyStatistics()
+{
+	return topology_statistics;
+}
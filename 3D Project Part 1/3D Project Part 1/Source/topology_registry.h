@@ -0,0 +1,62 @@
+#pragma once
+
+#include "opengl_utilities.h"
+#include "mesh_generation.h"
+
+/*
+	Element array buffers shared between grid meshes of the same topology. The indices the grid generators write
+	only depend on the segment counts, the index format and which columns are poles, so every mesh with the same
+	TopologyKey has byte-identical indices, whatever its parametric function is. The sphere and the torus of the
+	scene differ in their poles, the levels of detail of the torus and the spikes share their coarser levels.
+
+	The key is known from the GridMeshPlan once the generator found the poles, before any index is written. The
+	first VAO of a key writes its indices and registers its element array buffer, later VAOs are created without
+	one and attach to it, they neither generate, copy nor allocate indices. Every VAO that attached holds a
+	reference, ReleaseUnusedTopologies deletes the buffers once none does.
+*/
+
+/* Topology Keys */
+struct TopologyKey
+{
+	int vertical_segments;
+	int rotation_segments;
+	GridPoles poles;
+
+	// Of the indices that are drawn, the buffer can be larger
+	GLenum primitive;
+	GLenum type;
+	GLsizei element_array_count;
+};
+
+bool operator<(const TopologyKey& a, const TopologyKey& b);
+
+// Key of the indices of plan, after SetGridPoles
+TopologyKey GridTopologyKey(const GridMeshPlan& plan);
+
+/* Shared Element Buffers */
+struct TopologyStatistics
+{
+	size_t element_buffers;		// Registered buffers
+	size_t attached_vaos;		// VAOs that draw from a buffer of an earlier VAO
+	size_t bytes_saved;			// Element array memory they did not allocate
+};
+
+// True when an earlier VAO registered the element array buffer of key
+bool HasSharedTopology(const TopologyKey& key);
+
+// Gives vao, which has no element array buffer of its own, the buffer registered for key.
+// Returns false when key has none, vao is left as it is then.
+bool AttachSharedTopology(VAO& vao, const TopologyKey& key);
+
+// Registers the element array buffer of vao for key, later VAOs of the key attach to it
+void RegisterSharedTopology(VAO& vao, const TopologyKey& key);
+
+// Gives vao, which has no element array buffer yet, the indices of plan. With shared they come from the registry
+// when it has them, otherwise they are written into a new buffer of vao, which is registered. Returns false when
+// the indices could not be written.
+bool CreateGridElementArray(VAO& vao, const GridMeshPlan& plan, bool shared);
+
+// Deletes the registered buffers that no VAO holds anymore, returns how many
+size_t ReleaseUnusedTopologies();
+
+TopologyStatistics GetTopologyStatistics();
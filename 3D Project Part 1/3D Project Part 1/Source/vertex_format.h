@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "GLM/glm.hpp"
+#include "GLM/gtc/packing.hpp"
+#include "GLM/gtx/transform.hpp"
+#include "GLAD/glad.h"
+
+/* Vertex Formats */
+enum class PositionFormat
+{
+	Float3,		// 12 bytes, GL_FLOAT x3
+	Half4,		// 8 bytes, GL_HALF_FLOAT x4 with w = 1, four components keep the attribute 4 byte aligned
+	Snorm16x4	// 8 bytes, normalized GL_SHORT x4 relative to the mesh bounds, see PositionQuantization
+};
+
+enum class NormalFormat
+{
+	Float3,		// 12 bytes, GL_FLOAT x3
+	Int2101010	// 4 bytes, normalized GL_INT_2_10_10_10_REV
+};
+
+// How VAO stores the vertices, the default is the original two separate GL_FLOAT x3 buffers
+struct VertexFormat
+{
+	PositionFormat position = PositionFormat::Float3;
+	NormalFormat normal = NormalFormat::Float3;
+
+	// One buffer with the normal right after the position instead of one buffer per attribute
+	bool interleaved = false;
+
+	GLsizei PositionSize() const
+	{
+		return position == PositionFormat::Float3 ? 12 : 8;
+	}
+
+	GLsizei NormalSize() const
+	{
+		return normal == NormalFormat::Float3 ? 12 : 4;
+	}
+
+	GLsizei VertexSize() const
+	{
+		return PositionSize() + NormalSize();
+	}
+
+	GLsizei PositionStride() const
+	{
+		return interleaved ? VertexSize() : PositionSize();
+	}
+
+	GLsizei NormalStride() const
+	{
+		return interleaved ? VertexSize() : NormalSize();
+	}
+};
+
+/* Position Quantization */
+// Snorm16x4 positions store (position - center) / extent. The extent is the same on every axis,
+// so the dequantization transform is a uniform scale and normals go through it unchanged.
+struct PositionQuantization
+{
+	glm::vec3 center = glm::vec3(0);
+	float extent = 1;
+
+	// Premultiply into the model transform: transform * DequantizationTransform()
+	glm::mat4 DequantizationTransform() const
+	{
+		return glm::translate(center) * glm::scale(glm::vec3(extent));
+	}
+};
+
+inline PositionQuantization QuantizeBounds(const glm::dvec3& min, const glm::dvec3& max)
+{
+	auto half_size = (max - min) / 2.;
+	auto extent = std::max({ half_size.x, half_size.y, half_size.z });
+
+	PositionQuantization quantization;
+	quantization.center = glm::vec3((min + max) / 2.);
+	quantization.extent = extent > 0 ? float(extent) : 1.f;
+	return quantization;
+}
+
+/* Vertex Encoding */
+// output does not have to be aligned, interleaved half positions sit at 4 byte boundaries
+inline void EncodePosition(PositionFormat format, const PositionQuantization& quantization, const glm::vec3& position, void* output)
+{
+	switch (format)
+	{
+	case PositionFormat::Float3:
+		std::memcpy(output, &position, sizeof(position));
+		break;
+	case PositionFormat::Half4:
+	{
+		auto packed = glm::packHalf4x16(glm::vec4(position, 1));
+		std::memcpy(output, &packed, sizeof(packed));
+		break;
+	}
+	case PositionFormat::Snorm16x4:
+	{
+		auto packed = glm::packSnorm4x16(glm::vec4((position - quantization.center) / quantization.extent, 1));
+		std::memcpy(output, &packed, sizeof(packed));
+		break;
+	}
+	}
+}
+
+inline void EncodeNormal(NormalFormat format, const glm::vec3& normal, void* output)
+{
+	switch (format)
+	{
+	case NormalFormat::Float3:
+		std::memcpy(output, &normal, sizeof(normal));
+		break;
+	case NormalFormat::Int2101010:
+	{
+		auto packed = glm::packSnorm3x10_1x2(glm::vec4(normal, 0));
+		std::memcpy(output, &packed, sizeof(packed));
+		break;
+	}
+	}
+}
+
+/* Index Formats */
+// One base-vertex draw, first_index counts indices, not bytes
+struct DrawRange
+{
+	size_t first_index;
+	GLsizei index_count;
+	GLint base_vertex;
+};
+
+// How the element array of a VAO is drawn, the default is a single GL_TRIANGLES draw of GLuint indices
+struct IndexFormat
+{
+	GLenum primitive = GL_TRIANGLES;	// GL_TRIANGLES, or GL_TRIANGLE_STRIP with strips separated by RestartIndex()
+	GLenum type = GL_UNSIGNED_INT;		// GL_UNSIGNED_INT or GL_UNSIGNED_SHORT
+
+	// Base-vertex draws for meshes with more vertices than 16 bit indices reach or split in meshlets, empty draws
+	// everything at once
+	std::vector<DrawRange> ranges;
+
+	GLsizei IndexSize() const
+	{
+		return type == GL_UNSIGNED_SHORT ? 2 : 4;
+	}
+
+	GLuint RestartIndex() const
+	{
+		return type == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF;
+	}
+};